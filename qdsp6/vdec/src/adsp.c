@@ -49,7 +49,10 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "qutility.h"
 
 #if PROFILE_DECODER
+/* Submit to frame done as seen by the ARM, i.e. DSP decode time */
 QPERF_INIT(dsp_decode);
+/* ARM time spent in the frame done callbacks on the adsp thread */
+QPERF_INIT(adsp_frame_done);
 #endif
 
 #define DEBUG 0         // TEST
@@ -166,10 +169,14 @@ void *adsp_thread(void *_mod)
          if (vdec_frame.status != VDEC_FLUSH_DONE) {
             QPERF_END_AND_START(dsp_decode);
          }
+         QPERF_START(adsp_frame_done);
 #endif
          mod->frame_done(mod->ctxt, &vdec_frame,
                vdecMsg.vfr_info.data2,
                vdecMsg.vfr_info.offset);
+#if PROFILE_DECODER
+         QPERF_END(adsp_frame_done);
+#endif
       } else {
          QTV_MSG_PRIO(QTVDIAG_GENERAL, QTVDIAG_PRIO_MED,
                  "adsp_thread:VDEC_IOCTL_GETMSG Unknown Msg ID\n");
@@ -186,6 +193,8 @@ void adsp_close(struct adsp_module *mod)
 #if PROFILE_DECODER
     QPERF_TERMINATE(dsp_decode);
     QPERF_RESET(dsp_decode);
+    QPERF_TERMINATE(adsp_frame_done);
+    QPERF_RESET(adsp_frame_done);
 #endif
 #ifndef T_WINNT
    int ret;
@@ -58,6 +58,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "adsp.h"
 #include "omx_vdec.h"
 #include "MP4_Utils.h"
+#include "qutility.h"
 
 #define H264_START_CODE             0x00000001
 #define H264_START_CODE_MASK        0x00FFFFFF
@@ -78,6 +79,8 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define EGL_BUFFER_HANDLE_QCOM 0x4F00
 #define EGL_BUFFER_OFFSET_QCOM 0x4F01
 
+/* Arbitrary-bytes frame assembly, ARM only */
+QPERF_INIT(get_one_frame);
 
 genericQueue::genericQueue()
 {
@@ -560,9 +563,12 @@ void omx_vdec::frame_done_cb(struct vdec_context *ctxt,
             }
                else {
                  pBufHdr->nFilledLen = pThis->get_output_buffer_size();
-                 // Invalidate the cache for the size of the decoded frame
+                 // Invalidate the cache for the decoded picture only, the
+                 // extradata space behind it is not written by the DSP
                   #ifdef USE_PMEM_ADSP_CACHED
-                  vdec_cachemaint(frame->buffer.pmem_id, pBufHdr->pBuffer, pBufHdr->nFilledLen, PMEM_CACHE_INVALIDATE);
+                  vdec_cachemaint(ctxt, frame->buffer.pmem_id, pBufHdr->pBuffer,
+                                  pBufHdr->nFilledLen - getExtraDataSize(),
+                                  PMEM_CACHE_INVALIDATE);
                   #endif
                 }
             }
@@ -1178,6 +1184,13 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
        QTV_MSG_PRIO(QTVDIAG_GENERAL, QTVDIAG_PRIO_MED, "OMX_VDEC:: Comp Init failed in \
            getting value for the Android property [persist.omxvideo.accsubframe]");
    }
+
+#ifdef PROFILE_DECODER
+   if(0 != property_get("persist.omxvideo.qperf", property_value, NULL))
+   {
+       qperf_enabled = strcmp(property_value, "false") ? 1 : 0;
+   }
+#endif
 #endif
 
    m_vdec_cfg.buffer_done = buffer_done_cb_stub;
@@ -6856,6 +6869,15 @@ OMX_ERRORTYPE omx_vdec::component_deinit(OMX_IN OMX_HANDLETYPE hComp) {
 #endif // _ANDROID_
 omx_vdec_free_output_port_memory();
 
+   QPERF_TERMINATE(get_one_frame);
+#if defined(_ANDROID_) && defined(PROFILE_DECODER)
+   {
+      char qperf_file[PROPERTY_VALUE_MAX];
+      // Appends every profiling region of the process to the file
+      if (0 != property_get("persist.omxvideo.qperf.dump", qperf_file, NULL))
+         QPERF_DUMP(qperf_file);
+   }
+#endif
    return OMX_ErrorNone;
 }
 /* ======================================================================
@@ -8657,6 +8679,7 @@ OMX_ERRORTYPE omx_vdec::get_one_frame(OMX_OUT OMX_BUFFERHEADERTYPE * dest,
    printf("\n");
 #endif
 
+   QPERF_START(get_one_frame);
    if (m_bStartCode) {
       get_one_frame_using_start_code(dest, source, isPartialFrame);
    } else {
@@ -8668,6 +8691,7 @@ OMX_ERRORTYPE omx_vdec::get_one_frame(OMX_OUT OMX_BUFFERHEADERTYPE * dest,
          get_one_frame_sp_mp_vc1(dest, source, isPartialFrame);
       }
    }
+   QPERF_END(get_one_frame);
 
    QTV_MSG_PRIO(QTVDIAG_GENERAL, QTVDIAG_PRIO_MED,
            "After get_one_frame\n");
@@ -196,5 +196,38 @@ void pmem_cachemaint(int pmem_id, void *addr, unsigned size, PMEM_CACHE_OP op)
       break;
    }
 }
+
+int pmem_is_cached(int pmem_id)
+{
+   int flags = fcntl(pmem_id, F_GETFL);
+   return (flags != -1) && !(flags & O_SYNC);
+}
+
+void pmem_cachemaint_range(int pmem_id, void *addr, unsigned size,
+                           PMEM_CACHE_OP op, struct pmem_cache_stats *stats)
+{
+   if (!size || op >= PMEM_CACHE_INVALID_OP)
+      return;
+
+   if (!pmem_is_cached(pmem_id)) {
+      if (stats)
+         stats->skipped++;
+      return;
+   }
+
+   pmem_cachemaint(pmem_id, addr, size, op);
+   if (!stats)
+      return;
+   if (op != PMEM_CACHE_INVALIDATE) {
+      stats->clean_frames++;
+      stats->last_clean_bytes = size;
+      stats->clean_bytes += size;
+   }
+   if (op != PMEM_CACHE_FLUSH) {
+      stats->inv_frames++;
+      stats->last_inv_bytes = size;
+      stats->inv_bytes += size;
+   }
+}
 #endif
 #endif //QLE_BUILD
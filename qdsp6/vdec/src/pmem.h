@@ -71,5 +71,46 @@ typedef enum {
   *     Cache operation to perform as defined by PMEM_CACHE_OP
   */
 void pmem_cachemaint(int pmem_id, void *addr, unsigned size, PMEM_CACHE_OP op);
+
+//Bytes of cache maintenance done for one decoder. Cleaning happens at
+//ETB and invalidation at FBD, so each half has a single writer.
+struct pmem_cache_stats {
+   unsigned clean_frames;
+   unsigned last_clean_bytes;   //bytes cleaned for the last ETB
+   unsigned long long clean_bytes;
+   unsigned inv_frames;
+   unsigned last_inv_bytes;     //bytes invalidated for the last FBD
+   unsigned long long inv_bytes;
+   unsigned skipped;            //operations skipped on uncached regions
+};
+
+/**
+  * Returns nonzero if the pmem region is mapped cached. Regions opened
+  * with O_SYNC are mapped uncached and need no cache maintenance.
+  */
+int pmem_is_cached(int pmem_id);
+
+/**
+  * Performs a cache operation on exactly the bytes [addr, addr + size)
+  * that were written or are to be read, and counts them in stats.
+  * Nothing is done for an empty range or an uncached region.
+  *
+  *  @param[in] pmem_id
+  *     id of the pmem region the range belongs to
+  *
+  *  @param[in] addr
+  *     The virtual addr of the first byte touched
+  *
+  *  @param[in] size
+  *     Number of bytes touched
+  *
+  *  @param[in] op
+  *     Cache operation to perform as defined by PMEM_CACHE_OP
+  *
+  *  @param[inout] stats
+  *     Counters to update, may be NULL
+  */
+void pmem_cachemaint_range(int pmem_id, void *addr, unsigned size,
+                           PMEM_CACHE_OP op, struct pmem_cache_stats *stats);
 #endif
 #endif
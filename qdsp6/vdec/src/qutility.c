@@ -90,3 +90,217 @@ int fwritex(const void *ptr, int count, FILE * stream)
    } while (count);
    return total_bytes;
 }
+
+#ifdef PROFILE_DECODER
+#include <string.h>
+#include <pthread.h>
+#ifndef T_WINNT
+#include <time.h>
+#endif
+
+volatile int qperf_enabled = 1;
+
+static pthread_mutex_t qperf_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct qperf_region *qperf_regions = NULL;
+
+usecs_t qperf_now_us(void)
+{
+#ifndef T_WINNT
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (usecs_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (usecs_t) tv.tv_sec * 1000000 + tv.tv_usec;
+#endif
+}
+
+/* Two buckets per power of two: [2^n, 1.5*2^n) and [1.5*2^n, 2^(n+1)) */
+static unsigned int qperf_bucket(unsigned int value)
+{
+   unsigned int msb = 0;
+   if (value < 2)
+      return value;
+#ifdef __GNUC__
+   msb = 31 - __builtin_clz(value);
+#else
+   while (value >> (msb + 1))
+      msb++;
+#endif
+   return (msb << 1) + ((value >> (msb - 1)) & 1);
+}
+
+/* Largest duration that falls in bucket index */
+static unsigned int qperf_bucket_limit(unsigned int index)
+{
+   unsigned int msb = index >> 1;
+   if (index < 2)
+      return index;
+   return (unsigned int)((((usecs_t) 3 + (index & 1)) << (msb - 1)) - 1);
+}
+
+static void qperf_register(struct qperf_region *region)
+{
+   pthread_mutex_lock(&qperf_lock);
+   if (!region->registered) {
+      region->next = qperf_regions;
+      qperf_regions = region;
+      region->registered = 1;
+   }
+   pthread_mutex_unlock(&qperf_lock);
+}
+
+void qperf_start(struct qperf_region *region)
+{
+   if (!region->registered)
+      qperf_register(region);
+   if (__sync_fetch_and_add(&region->n_running, 1) == 0)
+      region->start_us = qperf_now_us();
+}
+
+void qperf_end(struct qperf_region *region, int restart)
+{
+   usecs_t now = qperf_now_us();
+   usecs_t start = region->start_us;
+
+   if (region->n_running <= 0)
+      return;
+   if (restart)
+      region->start_us = now;
+   __sync_fetch_and_sub(&region->n_running, 1);
+   qperf_record(region, now > start ? now - start : 0);
+}
+
+void qperf_record(struct qperf_region *region, usecs_t duration_us)
+{
+   unsigned int us = duration_us > 0xFFFFFFFF ?
+       0xFFFFFFFF : (unsigned int)duration_us;
+
+   if (!region->registered)
+      qperf_register(region);
+   if (!region->samples || us < region->min_us)
+      region->min_us = us;
+   if (us > region->max_us)
+      region->max_us = us;
+   region->total_us += us;
+   region->hist[qperf_bucket(us)]++;
+   region->samples++;
+   region->iterations++;
+}
+
+void qperf_reset(struct qperf_region *region)
+{
+   region->total_us = 0;
+   region->iterations = 0;
+   region->samples = 0;
+   region->min_us = 0;
+   region->max_us = 0;
+   memset(region->hist, 0, sizeof(region->hist));
+}
+
+static unsigned int qperf_percentile(struct qperf_region *region,
+                                     const unsigned int *hist,
+                                     unsigned int samples, unsigned int pct)
+{
+   unsigned int rank = (samples * pct + 99) / 100, seen = 0, i, limit;
+   for (i = 0; i < QPERF_NUM_BUCKETS; i++) {
+      seen += hist[i];
+      if (seen >= rank && hist[i]) {
+         limit = qperf_bucket_limit(i);
+         // The bucket bound can overshoot what was actually measured
+         if (limit > region->max_us)
+            limit = region->max_us;
+         if (limit < region->min_us)
+            limit = region->min_us;
+         return limit;
+      }
+   }
+   return region->max_us;
+}
+
+void qperf_get_region_stats(struct qperf_region *region,
+                            struct qperf_stats *stats)
+{
+   unsigned int hist[QPERF_NUM_BUCKETS];
+   unsigned int samples = 0, i;
+
+   // The writer may be running; work on a copy so ranks stay consistent
+   memcpy(hist, region->hist, sizeof(hist));
+   for (i = 0; i < QPERF_NUM_BUCKETS; i++)
+      samples += hist[i];
+
+   memset(stats, 0, sizeof(*stats));
+   stats->name = region->name;
+   stats->iterations = region->iterations;
+   stats->samples = samples;
+   stats->total_us = region->total_us;
+   if (!samples)
+      return;
+   stats->min_us = region->min_us;
+   stats->max_us = region->max_us;
+   stats->avg_us = stats->iterations ?
+       (unsigned int)(stats->total_us / stats->iterations) : 0;
+   stats->p50_us = qperf_percentile(region, hist, samples, 50);
+   stats->p90_us = qperf_percentile(region, hist, samples, 90);
+   stats->p99_us = qperf_percentile(region, hist, samples, 99);
+}
+
+int qperf_get_stats(const char *name, struct qperf_stats *stats)
+{
+   struct qperf_region *region;
+   int ret = -1;
+
+   if (!name || !stats)
+      return -1;
+   pthread_mutex_lock(&qperf_lock);
+   for (region = qperf_regions; region; region = region->next) {
+      if (!strcmp(region->name, name)) {
+         qperf_get_region_stats(region, stats);
+         ret = 0;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&qperf_lock);
+   return ret;
+}
+
+static int qperf_format(struct qperf_region *region, char *buf, int size)
+{
+   struct qperf_stats stats;
+   qperf_get_region_stats(region, &stats);
+   return snprintf(buf, size,
+                   "%-16s n %u total %llu us avg %u min %u p50 %u p90 %u "
+                   "p99 %u max %u us",
+                   stats.name, stats.iterations, stats.total_us,
+                   stats.avg_us, stats.min_us, stats.p50_us, stats.p90_us,
+                   stats.p99_us, stats.max_us);
+}
+
+void qperf_report(struct qperf_region *region)
+{
+   char line[256];
+   qperf_format(region, line, sizeof(line));
+   QTV_PERF_MSG_PRIO1(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "%s\n", line);
+}
+
+int qperf_dump(const char *path)
+{
+   struct qperf_region *region;
+   char line[256];
+   FILE *fp;
+
+   fp = path ? fopen(path, "a") : stderr;
+   if (!fp)
+      return -1;
+   pthread_mutex_lock(&qperf_lock);
+   for (region = qperf_regions; region; region = region->next) {
+      qperf_format(region, line, sizeof(line));
+      fprintf(fp, "%s\n", line);
+   }
+   pthread_mutex_unlock(&qperf_lock);
+   if (fp != stderr)
+      fclose(fp);
+   return 0;
+}
+#endif //PROFILE_DECODER
@@ -76,34 +76,77 @@ extern "C" {
 
 #ifdef PROFILE_DECODER
 
+/*
+ * Named profiling regions. Each region keeps a log-scale histogram of
+ * its durations (two buckets per power of two microseconds) along with
+ * min/max/total, so percentiles can be reported next to the average.
+ * Regions register themselves on first use and can be dumped together
+ * with qperf_dump() or read back by name with qperf_get_stats().
+ *
+ * QPERF_START may be issued from any thread; nested starts only count
+ * the outermost one, as before. The statistics are written by the
+ * thread that calls QPERF_END, so each region must be ended from a
+ * single thread. Everything is skipped while qperf_enabled is zero.
+ */
+#define QPERF_NUM_BUCKETS 64
+
+   struct qperf_region {
+      const char *name;
+      struct qperf_region *next;
+      volatile int registered;
+      volatile int n_running;
+      usecs_t start_us;
+      usecs_t total_us;
+      unsigned int iterations;
+      unsigned int samples;
+      unsigned int min_us;
+      unsigned int max_us;
+      unsigned int hist[QPERF_NUM_BUCKETS];
+   };
+
+   struct qperf_stats {
+      const char *name;
+      unsigned int iterations;
+      unsigned int samples;
+      usecs_t total_us;
+      unsigned int min_us;
+      unsigned int max_us;
+      unsigned int avg_us;
+      unsigned int p50_us;
+      unsigned int p90_us;
+      unsigned int p99_us;
+   };
+
+   extern volatile int qperf_enabled;
+
+   usecs_t qperf_now_us(void);
+   void qperf_start(struct qperf_region *region);
+   void qperf_end(struct qperf_region *region, int restart);
+   void qperf_record(struct qperf_region *region, usecs_t duration_us);
+   void qperf_reset(struct qperf_region *region);
+   void qperf_get_region_stats(struct qperf_region *region,
+                               struct qperf_stats *stats);
+   int qperf_get_stats(const char *name, struct qperf_stats *stats);
+   void qperf_report(struct qperf_region *region);
+   int qperf_dump(const char *path);
+
 #define QPERF_INIT(PREFIX) \
-usecs_t PREFIX ## _total_time_us = 0;\
-int PREFIX ## _n_running_timer = 0;\
-struct timeval PREFIX ## _tv1, PREFIX ## _tv2;\
-struct timezone PREFIX ## _tz1, PREFIX ## _tz2;\
-int PREFIX ## _total_iterations = 0
+struct qperf_region PREFIX ## _qperf = { #PREFIX }
+
+#define QPERF_EXTERN(PREFIX) \
+extern struct qperf_region PREFIX ## _qperf
 
 #define QPERF_RESET(PREFIX) \
-PREFIX ## _total_time_us = 0;\
-PREFIX ## _total_iterations = 0
+   qperf_reset(&PREFIX ## _qperf)
 
 #define QPERF_START(PREFIX) \
-   if (PREFIX ## _n_running_timer == 0) gettimeofday(&PREFIX ## _tv1, &PREFIX ## _tz1);\
-   PREFIX ## _n_running_timer++
+   do { if (qperf_enabled) qperf_start(&PREFIX ## _qperf); } while (0)
 
 #define QPERF_END(PREFIX) \
-   gettimeofday(&PREFIX ## _tv2, &PREFIX ## _tz2);\
-   PREFIX ## _total_time_us += ((PREFIX ## _tv2.tv_sec - PREFIX ## _tv1.tv_sec) * 1000000 + (PREFIX ## _tv2.tv_usec - PREFIX ## _tv1.tv_usec));\
-   PREFIX ## _total_iterations++;\
-   PREFIX ## _n_running_timer--
+   do { if (qperf_enabled) qperf_end(&PREFIX ## _qperf, 0); } while (0)
 
 #define QPERF_END_AND_START(PREFIX) \
-   gettimeofday(&PREFIX ## _tv2, &PREFIX ## _tz2);\
-   PREFIX ## _total_time_us += ((PREFIX ## _tv2.tv_sec - PREFIX ## _tv1.tv_sec) * 1000000 + (PREFIX ## _tv2.tv_usec - PREFIX ## _tv1.tv_usec));\
-   PREFIX ## _total_iterations++;\
-   PREFIX ## _tv1 = PREFIX ## _tv2;\
-   PREFIX ## _tz1 = PREFIX ## _tz2;\
-   PREFIX ## _n_running_timer--
+   do { if (qperf_enabled) qperf_end(&PREFIX ## _qperf, 1); } while (0)
 
 #define QPERF_TIME(PREFIX, FN)\
   QPERF_START(PREFIX); \
@@ -111,19 +154,16 @@ PREFIX ## _total_iterations = 0
   QPERF_END(PREFIX)
 
 #define QPERF_SET_ITERATION(PREFIX, N)  \
-  PREFIX ## _total_iterations = N
+  PREFIX ## _qperf.iterations = N
 
 #define QPERF_TERMINATE(PREFIX) \
-  QTV_PERF_MSG_PRIO1(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "Statistic of %s\n", #PREFIX);\
-  QTV_PERF_MSG_PRIO(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "============================================================\n");\
-  QTV_PERF_MSG_PRIO1(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "Total number of iteration          %d\n", PREFIX ## _total_iterations);\
-  QTV_PERF_MSG_PRIO2(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "%s total_time(us):             %30lld\n",#PREFIX, (PREFIX ## _total_time_us));\
-  if (0 != PREFIX ## _total_iterations) {QTV_PERF_MSG_PRIO2(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "%s average_time/iteration(us): %30lld\n",#PREFIX, (PREFIX ## _total_time_us)/(PREFIX ## _total_iterations));}\
-  if (0 != PREFIX ## _total_time_us) {QTV_PERF_MSG_PRIO2(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "%s frame per second:           %.2f\n",#PREFIX, (double)(PREFIX ## _total_iterations)/(PREFIX ## _total_time_us)*1000000);}\
-  QTV_PERF_MSG_PRIO(QTVDIAG_STATISTICS, QTVDIAG_PRIO_DEBUG, "============================================================\n");
+  qperf_report(&PREFIX ## _qperf)
+
+#define QPERF_DUMP(PATH) qperf_dump(PATH)
 
 #else
 #define QPERF_INIT(PREFIX)
+#define QPERF_EXTERN(PREFIX)
 #define QPERF_RESET(PREFIX) do {} while (0)
 #define QPERF_START(PREFIX) do {} while (0)
 #define QPERF_END(PREFIX) do {} while (0)
@@ -131,6 +171,7 @@ PREFIX ## _total_iterations = 0
 #define QPERF_END_AND_START(PREFIX) do {} while (0)
 #define QPERF_SET_ITERATION(PREFIX, N) do {} while (0)
 #define QPERF_TERMINATE(PREFIX) do {} while (0)
+#define QPERF_DUMP(PATH) do {} while (0)
 #endif
 
 #ifdef __cplusplus
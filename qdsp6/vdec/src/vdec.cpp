@@ -72,6 +72,7 @@ struct Vdec_pthread_info {
    sem_t flush_sem;
 } Vdec_pthread_info;
 
+/* ARM time to hand one input buffer to the DSP */
 QPERF_INIT(arm_decode);
 
 #if LOG_YUV_FRAMES
@@ -325,6 +326,21 @@ Vdec_ReturnType vdec_close(struct VDecoder *dec)
    }
 #endif
    dec->is_commit_memory = 0;
+#ifdef USE_PMEM_ADSP_CACHED
+   if (dec->ctxt) {
+      struct pmem_cache_stats *cs = &dec->ctxt->cacheStats;
+      QTV_MSG_PRIO3(QTVDIAG_GENERAL, QTVDIAG_PRIO_HIGH,
+               "vdec: cache clean %llu bytes in %u ETBs, last %u\n",
+               cs->clean_bytes, cs->clean_frames, cs->last_clean_bytes);
+      QTV_MSG_PRIO3(QTVDIAG_GENERAL, QTVDIAG_PRIO_HIGH,
+               "vdec: cache invalidate %llu bytes in %u FBDs, last %u\n",
+               cs->inv_bytes, cs->inv_frames, cs->last_inv_bytes);
+      QTV_MSG_PRIO1(QTVDIAG_GENERAL, QTVDIAG_PRIO_HIGH,
+               "vdec: cache maintenance skipped %u times, uncached\n",
+               cs->skipped);
+   }
+#endif
+   QPERF_TERMINATE(arm_decode);
    adsp_close((struct adsp_module *)dec->adsp_module);
    free(dec->ctxt->inputBuffer);
    free(dec->ctxt->outputBuffer);
@@ -1115,8 +1131,11 @@ Vdec_ReturnType vdec_post_input_buffer(struct VDecoder * dec,
    //input.avsync_state
 
 #ifdef USE_PMEM_ADSP_CACHED
-   //Flush/clean the cache (bit-stream data sent to driver)
-   vdec_cachemaint(input.pmem_id, dec->ctxt->inputBuffer[buf_index].base, copy_size, PMEM_CACHE_FLUSH);
+   //Flush/clean only the bit-stream bytes sent to driver
+   vdec_cachemaint(dec->ctxt, input.pmem_id,
+                   is_pmem ? (byte *) frame->data :
+                   dec->ctxt->inputBuffer[buf_index].base,
+                   copy_size, PMEM_CACHE_FLUSH);
 #endif
 
    QTV_MSG_PRIO1(QTVDIAG_GENERAL, QTVDIAG_PRIO_MED,
@@ -1163,6 +1182,7 @@ Vdec_ReturnType vdec_post_input_buffer(struct VDecoder * dec,
 
    if (adsp_post_input_buffer
        ((struct adsp_module *)dec->adsp_module, input, 0) < 0) {
+      QPERF_END(arm_decode);
       QTV_MSG_PRIO(QTVDIAG_GENERAL, QTVDIAG_PRIO_LOW,
               "vdec: Post Input Buffer Failed\n");
       pthread_mutex_lock(&pthread_info->in_buf_lock);
@@ -1171,6 +1191,7 @@ Vdec_ReturnType vdec_post_input_buffer(struct VDecoder * dec,
       dec->ctxt->buffer_done(dec->ctxt,cookie);
       return VDEC_EFAILED;
    }
+   QPERF_END(arm_decode);
 
    if (frame->flags & FRAME_FLAG_EOS) {
       if (adsp_post_input_buffer
@@ -1247,9 +1268,10 @@ Vdec_ReturnType vdec_release_frame(struct VDecoder * dec,
 }
 
 #ifdef USE_PMEM_ADSP_CACHED
-void vdec_cachemaint(int pmem_id, void *addr, unsigned size, PMEM_CACHE_OP op)
+void vdec_cachemaint(struct vdec_context *ctxt, int pmem_id, void *addr,
+                     unsigned size, PMEM_CACHE_OP op)
 {
-   pmem_cachemaint(pmem_id,addr,size, op);
+   pmem_cachemaint_range(pmem_id, addr, size, op, &ctxt->cacheStats);
 }
 #endif
 
@@ -317,6 +317,11 @@ typedef enum PostProc_Flags{
       * use
       */
       void (*buffer_done) (struct vdec_context * ctxt, void *cookie);
+
+#ifdef USE_PMEM_ADSP_CACHED
+      /* Cache maintenance done by vdec_cachemaint */
+      struct pmem_cache_stats cacheStats;
+#endif
    } vdec_context;
 
    struct Vdec_Input_BufferInfo {
@@ -505,10 +510,15 @@ int getExtraDataSize(void);
 
 #ifdef USE_PMEM_ADSP_CACHED
 /**
-  * This method is used to perform cache operations on the pmem region in the decoder.
+  * This method is used to perform cache operations on the bytes of a pmem
+  * region the decoder actually touched. Uncached regions are skipped, and
+  * the bytes are counted in ctxt->cacheStats.
   *
   * Prerequisite: vdec_open should have been called.
   *
+  *  @param[in] ctxt
+  *     Decoder context whose counters are updated
+  *
   *  @param[in] pmem_id
   *     id of the pmem region to use
   *
@@ -516,12 +526,13 @@ int getExtraDataSize(void);
   *     The virtual addr of the pmem region
   *
   *  @param[in] size
-  *     The size of the region
+  *     Number of bytes written or to be read
   *
   *  @param[in] op
   *     Cache operation to perform as defined by PMEM_CACHE_OP
   */
-  void vdec_cachemaint(int pmem_id, void *addr, unsigned size, PMEM_CACHE_OP op);
+  void vdec_cachemaint(struct vdec_context *ctxt, int pmem_id, void *addr,
+                       unsigned size, PMEM_CACHE_OP op);
 #endif
 
 #ifdef __cplusplus
@@ -26,6 +26,7 @@ include $(CLEAR_VARS)
 libmm-venc-inc += $(LOCAL_PATH)/omx/inc
 libmm-venc-inc += $(LOCAL_PATH)/device/inc
 libmm-venc-inc += $(LOCAL_PATH)/common/inc
+libmm-venc-inc += $(LOCAL_PATH)/../../vidc/common/inc
 libmm-venc-inc += $(TARGET_OUT_HEADERS)/mm-core/omxcore
 
 LOCAL_MODULE := libOmxVidEnc
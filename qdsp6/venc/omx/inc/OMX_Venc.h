@@ -38,6 +38,7 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "OMX_QCOMExtns.h"
 
 #include "venc_device.h"
+#include "vidc_stats.h"
 #include <pthread.h>
 #include <linux/msm_q6venc.h>
 #include <semaphore.h>
@@ -332,6 +333,29 @@ class Venc : public qc_omx_component
     static void *reader_thread_entry(void *);
     void reader_thread();
 
+    /**********************************************************************//**
+     * @brief log CPU time and wakeups of the component and reader threads
+     *************************************************************************/
+    void report_thread_usage();
+
+    struct ThreadUsage;
+
+    /**********************************************************************//**
+     * @brief name the calling thread and mark it running
+     *************************************************************************/
+    void thread_usage_start(ThreadUsage* pUsage, const char* pName);
+
+    /**********************************************************************//**
+     * @brief latch the CPU time of an exiting thread; called by the thread
+     *************************************************************************/
+    void thread_usage_exit(ThreadUsage* pUsage);
+
+    /**********************************************************************//**
+     * @brief fill QOMX_VIDEO_THREAD_STATS for the component and reader
+     *        threads, reading the CPU time of running threads live
+     *************************************************************************/
+    OMX_ERRORTYPE get_thread_stats(QOMX_VIDEO_THREAD_STATS* pStats);
+
 
     OMX_ERRORTYPE translate_profile(unsigned int* pDriverProfile,
         OMX_U32 eProfile,
@@ -456,6 +480,29 @@ class Venc : public qc_omx_component
     /// thread object
     pthread_t m_ReaderThread;
 
+    /// CPU time and wakeups of one thread. The CPU time is latched by the
+    /// thread on exit and read through its CPU-time clock while it runs.
+    struct ThreadUsage
+    {
+      char cName[QOMX_VIDEO_THREAD_NAME_MAX];
+      bool bRunning;
+      clockid_t nClock;
+      long long nCpuTimeUs;
+      unsigned long nWakeups;
+    };
+
+    /// guards the name, running state and clock of the ThreadUsage members
+    pthread_mutex_t m_ThreadUsageLock;
+
+    /// component_thread usage
+    ThreadUsage m_sComponentThreadUsage;
+
+    /// reader_thread usage
+    ThreadUsage m_sReaderThreadUsage;
+
+    /// monotonic time at component_init, in microseconds
+    long long m_nInitTimeUs;
+
     /// Input buffer manager
     VencBufferManager* m_pInBufferMgr;
 
@@ -45,6 +45,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <sys/ioctl.h>
 #include <linux/android_pmem.h>
 #include <fcntl.h>
+#include <time.h>
+#include <stddef.h>
+#include <sys/prctl.h>
 
 #include "OMX_Venc.h"
 
@@ -165,6 +168,10 @@ Venc::Venc() :
   memset(&m_pPrivateInPortData, 0, sizeof(m_pPrivateInPortData));
   memset(&m_pPrivateOutPortData, 0, sizeof(m_pPrivateOutPortData));
   memset(&m_sErrorCorrection, 0, sizeof(m_sErrorCorrection));
+  memset(&m_sComponentThreadUsage, 0, sizeof(m_sComponentThreadUsage));
+  memset(&m_sReaderThreadUsage, 0, sizeof(m_sReaderThreadUsage));
+  m_nInitTimeUs = 0;
+  pthread_mutex_init(&m_ThreadUsageLock, NULL);
   sem_init(&m_cmd_lock,0,0);
 }
 
@@ -173,9 +180,20 @@ Venc::~Venc()
   g_pVencInstance = NULL;
   QC_OMX_MSG_HIGH("deconstructor (closing driver)");
   sem_destroy(&m_cmd_lock);
+  pthread_mutex_destroy(&m_ThreadUsageLock);
   ven_device_close(m_pDevice);
 }
 
+static long long clock_microsec(clockid_t clock)
+{
+  struct timespec ts;
+  if (clock_gettime(clock, &ts) != 0)
+  {
+    return 0;
+  }
+  return (long long) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 int roundingup( double val )
 {
    int ret = (int) val;
@@ -500,6 +518,7 @@ OMX_ERRORTYPE Venc::component_init(OMX_IN OMX_STRING pComponentName)
     goto bail;
   }
 
+  m_nInitTimeUs = clock_microsec(CLOCK_MONOTONIC);
   QC_OMX_MSG_MEDIUM("creating component thread");
   if (pthread_create(&m_ComponentThread,
         NULL,
@@ -2792,6 +2811,7 @@ OMX_ERRORTYPE Venc::get_config(OMX_IN  OMX_HANDLETYPE hComponent,
   // OMX_IndexConfigVideoBitrate      OMX_VIDEO_CONFIG_BITRATETYPE
   // OMX_IndexConfigVideoFramerate    OMX_CONFIG_FRAMERATETYPE
   // OMX_IndexConfigCommonRotate      OMX_CONFIG_ROTATIONTYPE
+  // QOMX_IndexConfigVideoThreadStats QOMX_VIDEO_THREAD_STATS
   ////////////////////////////////////////////////////////////////
 
   if (pCompConfig == NULL)
@@ -2882,6 +2902,12 @@ OMX_ERRORTYPE Venc::get_config(OMX_IN  OMX_HANDLETYPE hComponent,
         memcpy(pParam, &m_sConfigNAL, sizeof(m_sConfigNAL));
         break;
       }
+    case QOMX_IndexConfigVideoThreadStats:
+      {
+        QOMX_VIDEO_THREAD_STATS* pParam = reinterpret_cast<QOMX_VIDEO_THREAD_STATS*>(pCompConfig);
+        QC_OMX_MSG_LOW("QOMX_IndexConfigVideoThreadStats");
+        return get_thread_stats(pParam);
+      }
     default:
       QC_OMX_MSG_ERROR("unsupported index %d", (int) nIndex);
       return OMX_ErrorUnsupportedIndex;
@@ -3289,6 +3315,19 @@ OMX_ERRORTYPE Venc::get_extension_index(OMX_IN  OMX_HANDLETYPE hComponent,
                                         OMX_IN  OMX_STRING cParameterName,
                                         OMX_OUT OMX_INDEXTYPE* pIndexType)
 {
+  (void) hComponent;
+  if (cParameterName == NULL || pIndexType == NULL)
+  {
+    QC_OMX_MSG_ERROR("param is null");
+    return OMX_ErrorBadParameter;
+  }
+
+  if (!strcmp(cParameterName, OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS))
+  {
+    *pIndexType = (OMX_INDEXTYPE) QOMX_IndexConfigVideoThreadStats;
+    return OMX_ErrorNone;
+  }
+
   return OMX_ErrorNotImplemented;
 }
 
@@ -4045,6 +4084,7 @@ OMX_ERRORTYPE Venc::component_deinit(OMX_IN  OMX_HANDLETYPE hComponent)
   {
     QC_OMX_MSG_ERROR("error killing reader thread");
   }
+  report_thread_usage();
 
   if (m_pMsgQ)
     delete m_pMsgQ;
@@ -4101,6 +4141,10 @@ void *Venc::component_thread(void *pClassObj)
   Venc* pVenc = reinterpret_cast<Venc*>(pClassObj);
 
   QC_OMX_MSG_MEDIUM("component thread has started");
+  if (pVenc != NULL)
+  {
+    pVenc->thread_usage_start(&pVenc->m_sComponentThreadUsage, "VencComponent");
+  }
 
   if (pVenc == NULL)
   {
@@ -4116,6 +4160,7 @@ void *Venc::component_thread(void *pClassObj)
     {
       QC_OMX_MSG_ERROR("failed to pop msg");
     }
+    ++pVenc->m_sComponentThreadUsage.nWakeups;
 
     QC_OMX_MSG_LOW("Component thread got msg");
 
@@ -4164,6 +4209,7 @@ void *Venc::component_thread(void *pClassObj)
         break;
     }
   }
+  pVenc->thread_usage_exit(&pVenc->m_sComponentThreadUsage);
   QC_OMX_MSG_HIGH("component thread is exiting");
   return 0;
 }
@@ -4187,6 +4233,7 @@ void Venc::reader_thread()
 {
   int bExecute = OMX_TRUE;
 
+  thread_usage_start(&m_sReaderThreadUsage, "VencReader");
   while (bExecute == OMX_TRUE)
   {
     int driverRet;
@@ -4207,6 +4254,7 @@ void Venc::reader_thread()
     driverRet = DeviceIoControl(m_nFd,
         VENC_IOCTL_CMD_READ_NEXT_MSG,
         &msg);
+    ++m_sReaderThreadUsage.nWakeups;
 
     if (!driverRet)
     {
@@ -4228,6 +4276,74 @@ void Venc::reader_thread()
       bExecute = OMX_FALSE;
     }
   }
+  thread_usage_exit(&m_sReaderThreadUsage);
+}
+
+void Venc::thread_usage_start(ThreadUsage* pUsage, const char* pName)
+{
+  prctl(PR_SET_NAME, (unsigned long) pName, 0, 0, 0);
+  pthread_mutex_lock(&m_ThreadUsageLock);
+  strlcpy(pUsage->cName, pName, sizeof(pUsage->cName));
+  if (pthread_getcpuclockid(pthread_self(), &pUsage->nClock) != 0)
+  {
+    pUsage->nClock = CLOCK_THREAD_CPUTIME_ID;
+  }
+  pUsage->bRunning = true;
+  pthread_mutex_unlock(&m_ThreadUsageLock);
+}
+
+void Venc::thread_usage_exit(ThreadUsage* pUsage)
+{
+  // the per-thread clock is gone once the thread is, so latch it here
+  pthread_mutex_lock(&m_ThreadUsageLock);
+  pUsage->nCpuTimeUs = clock_microsec(CLOCK_THREAD_CPUTIME_ID);
+  pUsage->bRunning = false;
+  pthread_mutex_unlock(&m_ThreadUsageLock);
+}
+
+OMX_ERRORTYPE Venc::get_thread_stats(QOMX_VIDEO_THREAD_STATS* pStats)
+{
+  ThreadUsage* pUsage[QOMX_VIDEO_THREAD_ROLE_MAX];
+
+  // component_thread pops OMX messages, reader_thread reads the driver
+  pUsage[QOMX_VIDEO_THREAD_MESSAGE] = &m_sComponentThreadUsage;
+  pUsage[QOMX_VIDEO_THREAD_CALLBACK] = &m_sReaderThreadUsage;
+
+  memset(&pStats->nSessionUs, 0,
+      sizeof(*pStats) - offsetof(QOMX_VIDEO_THREAD_STATS, nSessionUs));
+  if (m_nInitTimeUs)
+  {
+    pStats->nSessionUs = clock_microsec(CLOCK_MONOTONIC) - m_nInitTimeUs;
+  }
+  pthread_mutex_lock(&m_ThreadUsageLock);
+  for (int r = 0; r < QOMX_VIDEO_THREAD_ROLE_MAX; r++)
+  {
+    QOMX_VIDEO_THREAD_USAGE* pThread = &pStats->sThread[r];
+    memcpy(pThread->cName, pUsage[r]->cName, sizeof(pThread->cName));
+    pThread->bRunning = pUsage[r]->bRunning ? OMX_TRUE : OMX_FALSE;
+    pThread->nCpuTimeUs = pUsage[r]->nCpuTimeUs;
+    // the fallback clock would measure the caller, not the thread
+    if (pUsage[r]->bRunning && pUsage[r]->nClock != CLOCK_THREAD_CPUTIME_ID)
+    {
+      pThread->nCpuTimeUs = clock_microsec(pUsage[r]->nClock);
+    }
+    pThread->nWakeups = pUsage[r]->nWakeups;
+    pStats->nCpuTimeUs += pThread->nCpuTimeUs;
+  }
+  pthread_mutex_unlock(&m_ThreadUsageLock);
+  return OMX_ErrorNone;
+}
+
+void Venc::report_thread_usage()
+{
+  QC_OMX_MSG_PROFILE("%s threads: %lld us CPU in %lld us",
+      (char *) m_cRole,
+      m_sComponentThreadUsage.nCpuTimeUs + m_sReaderThreadUsage.nCpuTimeUs,
+      clock_microsec(CLOCK_MONOTONIC) - m_nInitTimeUs);
+  QC_OMX_MSG_PROFILE("  component_thread: %lld us CPU, %lu wakeups",
+      m_sComponentThreadUsage.nCpuTimeUs, m_sComponentThreadUsage.nWakeups);
+  QC_OMX_MSG_PROFILE("  reader_thread: %lld us CPU, %lu wakeups",
+      m_sReaderThreadUsage.nCpuTimeUs, m_sReaderThreadUsage.nWakeups);
 }
 
 void Venc::process_state_change(OMX_STATETYPE eState)
@@ -42,34 +42,23 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 extern "C"{
 #include<utils/Log.h>
 }
-#ifdef ENABLE_DEBUG_LOW
-#define DEBUG_PRINT_LOW LOGE
-#else
-#define DEBUG_PRINT_LOW
-#endif
-#ifdef ENABLE_DEBUG_HIGH
-#define DEBUG_PRINT_HIGH LOGE
-#else
-#define DEBUG_PRINT_HIGH
-#endif
-#ifdef ENABLE_DEBUG_ERROR
-#define DEBUG_PRINT_ERROR LOGE
-#else
-#define DEBUG_PRINT_ERROR
-#endif
-
-#else //_ANDROID_
-#define DEBUG_PRINT_LOW printf
-#define DEBUG_PRINT_HIGH printf
-#define DEBUG_PRINT_ERROR printf
 #endif // _ANDROID_
+#include "vidc_log.h"
 
 #define SEI_PAYLOAD_FRAME_PACKING_ARRANGEMENT 0x2D
 #define H264_START_CODE 0x01
+#define NAL_TYPE_SLICE 0x01
+#define NAL_TYPE_IDR 0x05
 #define NAL_TYPE_SEI 0x06
 #define VDEC_OMX_SEI 0x7F000007
 #define FRAME_PACK_SIZE 18
 #define H264_EMULATION_BYTE 0x03
+#define RBSP_BUF_SIZE 100
+// Largest frame packing SEI NAL including start code and emulation bytes
+#define SEI_NAL_MAX_SIZE 64
+#ifndef OMX_SPEC_VERSION
+#define OMX_SPEC_VERSION 0x00000101
+#endif
 class extra_data_handler 
 {
 public:
@@ -79,6 +68,7 @@ public:
   OMX_U32 create_extra_data(OMX_BUFFERHEADERTYPE *buf_hdr);
   OMX_U32 get_frame_pack_data(OMX_QCOM_FRAME_PACK_ARRANGEMENT *frame_pack);
   OMX_U32 set_frame_pack_data(OMX_QCOM_FRAME_PACK_ARRANGEMENT *frame_pack);
+  OMX_U32 create_sliceinfo(OMX_BUFFERHEADERTYPE *buf_hdr);
 private:
   OMX_QCOM_FRAME_PACK_ARRANGEMENT frame_packing_arrangement;
   OMX_U8 *rbsp_buf;
@@ -86,6 +76,12 @@ private:
   OMX_U32 byte_ptr;
   OMX_U32 pack_sei;
   OMX_U32 sei_payload_type;
+  // Encoded SEI NAL for the current arrangement, built on first use
+  OMX_U8 sei_nal[SEI_NAL_MAX_SIZE];
+  OMX_U32 sei_nal_len;
+  // Raw bytes of the last SEI parsed into frame_packing_arrangement
+  OMX_U8 sei_cache[SEI_NAL_MAX_SIZE];
+  OMX_U32 sei_cache_len;
   OMX_U32 d_u(OMX_U32 num_bits);
   OMX_U32 d_ue();
   OMX_U32 parse_frame_pack(OMX_U32 payload_size);
@@ -95,9 +91,11 @@ private:
   OMX_U32 e_ue(OMX_U32 symbol);
   OMX_U32 create_frame_pack();
   OMX_S32 create_rbsp(OMX_U8 *buf, OMX_U32 nalu_type);
-  OMX_U32 create_sei(OMX_U8 *buffer);
+  OMX_U32 create_sei(OMX_U8 *buffer, OMX_U32 buffer_size);
   OMX_S32 parse_sliceinfo(OMX_BUFFERHEADERTYPE *pBufHdr,
      OMX_OTHER_EXTRADATATYPE *pExtra);
+  OMX_U32 index_slices(OMX_U8 *buf, OMX_U32 len, OMX_U32 *slice_info,
+     OMX_U32 max_slices);
 };
   
 #endif  
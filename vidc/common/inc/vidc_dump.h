@@ -0,0 +1,155 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef __VIDC_DUMP_H__
+#define __VIDC_DUMP_H__
+
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "OMX_Core.h"
+#include "OMX_Types.h"
+#include "vidc_log.h"
+
+/*
+ * Vendor config index of the per-port buffer dump. It is handled in
+ * every component state, including Executing.
+ */
+enum QOMX_VIDC_DUMP_INDEXTYPE
+{
+    /* "OMX.QCOM.index.config.video.Dump"
+     * QOMX_VIDEO_DUMP */
+    QOMX_IndexConfigVideoDump = OMX_IndexVendorStartUnused + 0x00A00300,
+};
+
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_DUMP \
+    "OMX.QCOM.index.config.video.Dump"
+
+#define QOMX_VIDEO_DUMP_PATH_MAX 128
+/* VIDC_DEBUG_DIR followed by the longest name cPath can carry */
+#define VIDC_DUMP_FILE_PATH_MAX \
+    (sizeof(VIDC_DEBUG_DIR) - 1 + QOMX_VIDEO_DUMP_PATH_MAX)
+
+typedef struct QOMX_VIDEO_DUMP
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;           /* input: bitstream, output: frames */
+    OMX_BOOL bEnable;             /* in/out: dumping on or off */
+    OMX_U32 nSampleInterval;      /* in/out: keep every Nth buffer, 0 or 1
+                                     keeps all */
+    OMX_BOOL bErrorsOnly;         /* in/out: keep only buffers with errors */
+    OMX_U32 nRingBytes;           /* in: ring size on first enable, 0 for
+                                     the default; out: ring size */
+    OMX_U32 nBuffersWritten;      /* out: buffers handed to the writer */
+    OMX_U32 nBuffersDropped;      /* out: buffers lost to a full ring */
+    OMX_U8 cPath[QOMX_VIDEO_DUMP_PATH_MAX];
+                                  /* in: bare file name, opened in
+                                     VIDC_DEBUG_DIR (vidc_log.h) on first
+                                     enable and fixed for the session
+                                     after that; out: name of the
+                                     current file, full path if it was
+                                     opened outside VIDC_DEBUG_DIR */
+} QOMX_VIDEO_DUMP;
+
+#define VIDC_DUMP_DEFAULT_RING (8 * 1024 * 1024)
+#define VIDC_DUMP_MAX_RING     (128 * 1024 * 1024)
+
+/*
+ * Asynchronous file dump. The thread that produces a buffer copies it
+ * into a byte ring and a writer thread owned by the dump moves it to
+ * disk, so callbacks never wait on the file system. A buffer is either
+ * copied whole or dropped and counted when the ring has no room for it.
+ * There is a single producer at a time; a second thread that finds the
+ * ring busy drops its buffer instead of waiting. Blocking mode is meant
+ * for the test apps, where every frame matters more than timing.
+ *
+ *   if (dump.sample(error) && dump.begin(len1 + len2))
+ *   {
+ *     dump.append(data1, len1);
+ *     dump.append(data2, len2);
+ *     dump.commit();
+ *   }
+ */
+class vidc_dump
+{
+public:
+    vidc_dump();
+    ~vidc_dump();
+    bool open(const char *path, OMX_U32 ring_bytes, bool block = false,
+              bool truncate = false);
+    void close();
+    bool is_open() { return m_ring != NULL; }
+    bool is_active() { return m_active; }
+    void set_active(bool active) { m_active = active && m_ring; }
+    void set_sampling(OMX_U32 interval, bool errors_only);
+    /* Called once per buffer, returns true if this one is to be kept */
+    bool sample(bool error)
+    {
+        return m_active && keep(error);
+    }
+    bool begin(OMX_U32 len);
+    void append(const void *data, OMX_U32 len);
+    void commit();
+    void write(const void *data, OMX_U32 len, bool error)
+    {
+        if (sample(error) && begin(len))
+        {
+            append(data, len);
+            commit();
+        }
+    }
+    OMX_ERRORTYPE get_config(QOMX_VIDEO_DUMP *dump);
+    OMX_ERRORTYPE set_config(QOMX_VIDEO_DUMP *dump);
+private:
+    bool keep(bool error);
+    void drain();
+    static void *writer_thread(void *arg);
+    FILE *m_fp;
+    char m_path[VIDC_DUMP_FILE_PATH_MAX];
+    OMX_U8 *m_ring;
+    OMX_U32 m_size;
+    volatile OMX_U32 m_head;      /* bytes published by the producer */
+    volatile OMX_U32 m_tail;      /* bytes written out by the writer */
+    OMX_U32 m_write;              /* producer position inside begin/commit */
+    OMX_U32 m_end;                /* end of the current reservation */
+    volatile int m_busy;
+    volatile bool m_active;
+    volatile bool m_stop;
+    bool m_block;
+    bool m_write_failed;
+    OMX_U32 m_interval;
+    bool m_errors_only;
+    volatile OMX_U32 m_buffers;
+    volatile OMX_U32 m_written;
+    volatile OMX_U32 m_dropped;
+    volatile OMX_U32 m_skipped;
+    sem_t m_sem;
+    pthread_t m_thread;
+};
+
+#endif
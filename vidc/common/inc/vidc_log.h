@@ -0,0 +1,108 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __VIDC_LOG_H__
+#define __VIDC_LOG_H__
+
+#include "OMX_Types.h"
+
+/* Expands lazily, so a LOG_TAG defined after this header is picked up */
+#if defined(_ANDROID_) || defined(LOG_TAG)
+#define VIDC_LOG_TAG LOG_TAG
+#else
+#define VIDC_LOG_TAG "OMX-VIDC"
+#endif
+
+#define VIDC_LOG_ERROR  0
+#define VIDC_LOG_HIGH   1
+#define VIDC_LOG_LOW    2
+
+#define VIDC_LOG_MAX_ARGS           8
+#define VIDC_LOG_DEFAULT_RATE       100     /* per call site per second */
+#define VIDC_LOG_MAX_RECORDS        (1 << 16)
+
+/* Debug files named by an OMX client are only created in this directory */
+#ifndef VIDC_DEBUG_DIR
+#define VIDC_DEBUG_DIR              "/data/misc/media/"
+#endif
+
+/*
+ * One static instance per DEBUG_PRINT_* call site. The argument types are
+ * derived from the format on the first binary record and reused after.
+ */
+typedef struct vidc_log_site
+{
+    const char *tag;
+    const char *fmt;
+    int level;
+    volatile int nargs;           /* -1 until fmt has been parsed */
+    OMX_U8 types[VIDC_LOG_MAX_ARGS];
+    OMX_U32 window_ms;            /* rate limit window start */
+    OMX_U32 count;                /* messages in the window */
+    OMX_U32 suppressed;           /* dropped in the window */
+} vidc_log_site;
+
+/* Messages above this level are skipped before any argument is touched */
+extern volatile int vidc_log_level;
+
+void vidc_log_init(void);
+void vidc_log_emit(vidc_log_site *site, ...);
+bool vidc_log_set_binary(OMX_U32 num_records);
+int vidc_log_dump(const char *path);
+void vidc_log_flush(void);
+bool vidc_debug_path(char *path, OMX_U32 size, const char *name);
+
+#define VIDC_LOG(level, fmt, ...) \
+    do { \
+        if ((level) <= vidc_log_level) { \
+            static vidc_log_site vidc_log_site_ = { VIDC_LOG_TAG, fmt, level, -1 }; \
+            vidc_log_emit(&vidc_log_site_, ##__VA_ARGS__); \
+        } \
+    } while (0)
+
+/*
+ * Levels that are not built in compile to nothing, so their arguments
+ * are never evaluated.
+ */
+#if defined(ENABLE_DEBUG_LOW) || !defined(_ANDROID_)
+#define DEBUG_PRINT_LOW(fmt, ...) VIDC_LOG(VIDC_LOG_LOW, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_PRINT_LOW(fmt, ...) do {} while (0)
+#endif
+#if defined(ENABLE_DEBUG_HIGH) || !defined(_ANDROID_)
+#define DEBUG_PRINT_HIGH(fmt, ...) VIDC_LOG(VIDC_LOG_HIGH, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_PRINT_HIGH(fmt, ...) do {} while (0)
+#endif
+#if defined(ENABLE_DEBUG_ERROR) || !defined(_ANDROID_)
+#define DEBUG_PRINT_ERROR(fmt, ...) VIDC_LOG(VIDC_LOG_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define DEBUG_PRINT_ERROR(fmt, ...) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef __VIDC_RECORD_H__
+#define __VIDC_RECORD_H__
+
+#include <stdint.h>
+#include "OMX_Core.h"
+#include "OMX_Types.h"
+#include "vidc_dump.h"
+
+/*
+ * On-disk format of an OMX call recording, shared by the components and
+ * mm-video-omx-replay. Fixed-width types only, so a recording taken on
+ * the device can be read by a host build. The file is a
+ * vidc_record_file header followed by vidc_record_entry records, each
+ * followed by payload_len bytes of payload.
+ */
+#define VIDC_RECORD_MAGIC       0x43455256      /* "VREC" */
+#define VIDC_RECORD_VERSION     1
+#define VIDC_RECORD_NAME_MAX    128
+/* set_parameter/set_config payloads are cut at this size */
+#define VIDC_RECORD_PARAM_MAX   4096
+
+typedef enum VIDC_RECORD_TYPE
+{
+    /* calls from the client, payload noted where there is one */
+    VIDC_RECORD_SEND_COMMAND = 1, /* port = command, param1 = param */
+    VIDC_RECORD_SET_PARAMETER,    /* param1 = index, the structure */
+    VIDC_RECORD_SET_CONFIG,       /* param1 = index, the structure */
+    VIDC_RECORD_USE_BUFFER,       /* recorded once the header exists */
+    VIDC_RECORD_ALLOCATE_BUFFER,
+    VIDC_RECORD_FREE_BUFFER,
+    VIDC_RECORD_ETB,              /* the filled bytes */
+    VIDC_RECORD_FTB,
+    /* callbacks to the client */
+    VIDC_RECORD_EVENT,            /* port = event, param1/2 = data1/2 */
+    VIDC_RECORD_EBD,
+    VIDC_RECORD_FBD,
+    VIDC_RECORD_TYPE_MAX
+} VIDC_RECORD_TYPE;
+
+typedef enum VIDC_RECORD_CALLBACK
+{
+    VIDC_RECORD_CB_EVENT = 0,
+    VIDC_RECORD_CB_EBD,
+    VIDC_RECORD_CB_FBD,
+    VIDC_RECORD_CB_MAX
+} VIDC_RECORD_CALLBACK;
+
+typedef struct vidc_record_file
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;          /* sizeof(vidc_record_entry) */
+    uint32_t reserved;
+    char component[VIDC_RECORD_NAME_MAX];
+} vidc_record_file;
+
+typedef struct vidc_record_entry
+{
+    uint32_t type;                /* VIDC_RECORD_TYPE */
+    uint32_t seq;                 /* gaps mean the ring overflowed */
+    uint64_t time_us;             /* since the recording started */
+    uint64_t buffer;              /* buffer header id, 0 if none */
+    int64_t timestamp;
+    uint32_t tid;
+    uint32_t seen[VIDC_RECORD_CB_MAX];
+                                  /* callbacks delivered before this
+                                     record, replay waits for as many */
+    uint32_t port;
+    uint32_t param1;
+    uint32_t param2;
+    uint32_t offset;
+    uint32_t filled_len;
+    uint32_t alloc_len;
+    uint32_t flags;
+    uint32_t payload_len;
+} vidc_record_entry;
+
+#define VIDC_RECORD_DEFAULT_RING (32 * 1024 * 1024)
+
+/*
+ * Per-session recorder of every OMX entry point and callback. Records
+ * are queued to a vidc_dump, so recording never waits on the disk; a
+ * full ring drops records and leaves a gap in seq. Callbacks are
+ * recorded by handing the component a wrapped callback table whose
+ * app data points back at the recorder.
+ */
+class vidc_recorder
+{
+public:
+    vidc_recorder();
+    ~vidc_recorder();
+    bool open(const char *path, const char *component, OMX_U32 ring_bytes);
+    void close();
+    bool is_enabled() { return m_enabled; }
+    void wrap_callbacks(OMX_CALLBACKTYPE *callbacks, OMX_PTR *app_data);
+    void command(OMX_COMMANDTYPE cmd, OMX_U32 param)
+    {
+        if (m_enabled)
+            add(VIDC_RECORD_SEND_COMMAND, NULL, cmd, param, 0, NULL, 0);
+    }
+    void parameter(VIDC_RECORD_TYPE type, OMX_INDEXTYPE index, OMX_PTR data);
+    void buffer(VIDC_RECORD_TYPE type, OMX_U32 port,
+                OMX_BUFFERHEADERTYPE *buffer)
+    {
+        if (m_enabled)
+            add(type, buffer, port, 0, 0, NULL, 0);
+    }
+    void etb(OMX_BUFFERHEADERTYPE *buffer);
+private:
+    void add(VIDC_RECORD_TYPE type, OMX_BUFFERHEADERTYPE *buffer,
+             OMX_U32 port, OMX_U32 param1, OMX_U32 param2,
+             const void *payload, OMX_U32 payload_len);
+    static OMX_ERRORTYPE event_handler(OMX_HANDLETYPE comp, OMX_PTR app_data,
+                                       OMX_EVENTTYPE event, OMX_U32 data1,
+                                       OMX_U32 data2, OMX_PTR event_data);
+    static OMX_ERRORTYPE empty_buffer_done(OMX_HANDLETYPE comp,
+                                           OMX_PTR app_data,
+                                           OMX_BUFFERHEADERTYPE *buffer);
+    static OMX_ERRORTYPE fill_buffer_done(OMX_HANDLETYPE comp,
+                                          OMX_PTR app_data,
+                                          OMX_BUFFERHEADERTYPE *buffer);
+    vidc_dump m_dump;
+    pthread_mutex_t m_lock;       /* orders seq with the file */
+    volatile bool m_enabled;
+    OMX_U64 m_start_us;
+    volatile OMX_U32 m_seq;
+    volatile OMX_U32 m_seen[VIDC_RECORD_CB_MAX];
+    OMX_CALLBACKTYPE m_client_cb;
+    OMX_PTR m_client_data;
+};
+
+#endif
@@ -0,0 +1,619 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __VIDC_STATS_H__
+#define __VIDC_STATS_H__
+
+#include <pthread.h>
+#include <time.h>
+#include "OMX_Core.h"
+#include "OMX_Types.h"
+
+/*
+ * Vendor config indices for the vidc statistics interface. They live
+ * above the OMX_QCOMExtns.h range so both omx_vdec and omx_venc can use
+ * them without clashing with the QCOM indices.
+ */
+enum QOMX_VIDC_STATS_INDEXTYPE
+{
+    /* "OMX.QCOM.index.config.video.MemoryStats"
+     * QOMX_VIDEO_MEMORY_STATS, nPortIndex = OMX_ALL returns the
+     * aggregate of all sessions of the library in this process */
+    QOMX_IndexConfigVideoMemoryStats = OMX_IndexVendorStartUnused + 0x00A00000,
+    /* "OMX.QCOM.index.config.video.LiveStats"
+     * QOMX_VIDEO_LIVE_STATS, accepted in every state */
+    QOMX_IndexConfigVideoLiveStats,
+    /* "OMX.QCOM.index.config.video.LockStats"
+     * QOMX_VIDEO_LOCK_STATS, accepted in every state */
+    QOMX_IndexConfigVideoLockStats,
+    /* "OMX.QCOM.index.config.video.PerfStats"
+     * QOMX_VIDEO_PERF_STATS, set_config with bEnable starts or stops
+     * counting, accepted in every state */
+    QOMX_IndexConfigVideoPerfStats,
+    /* "OMX.QCOM.index.config.video.ThreadStats"
+     * QOMX_VIDEO_THREAD_STATS, accepted in every state */
+    QOMX_IndexConfigVideoThreadStats,
+    /* "OMX.QCOM.index.config.video.StartupStats"
+     * QOMX_VIDEO_STARTUP_STATS, accepted in every state */
+    QOMX_IndexConfigVideoStartupStats,
+};
+
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_MEMORY_STATS \
+    "OMX.QCOM.index.config.video.MemoryStats"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_LIVE_STATS \
+    "OMX.QCOM.index.config.video.LiveStats"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_LOCK_STATS \
+    "OMX.QCOM.index.config.video.LockStats"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS \
+    "OMX.QCOM.index.config.video.PerfStats"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS \
+    "OMX.QCOM.index.config.video.ThreadStats"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_STARTUP_STATS \
+    "OMX.QCOM.index.config.video.StartupStats"
+
+typedef enum QOMX_VIDEO_MEMCATEGORY
+{
+    QOMX_VIDEO_MEM_INPUT = 0,     /* input port ION/pmem buffers */
+    QOMX_VIDEO_MEM_OUTPUT,        /* output port ION/pmem buffers */
+    QOMX_VIDEO_MEM_H264_MV,       /* decoder H.264 MV buffer */
+    QOMX_VIDEO_MEM_DESC,          /* decoder demux desc buffers */
+    QOMX_VIDEO_MEM_EXTRADATA,     /* extradata space in output buffers */
+    QOMX_VIDEO_MEM_RECON,         /* encoder reconstruction buffers */
+    QOMX_VIDEO_MEM_MAX
+} QOMX_VIDEO_MEMCATEGORY;
+
+typedef struct QOMX_VIDEO_MEMUSAGE
+{
+    OMX_U64 nAllocatedBytes;      /* currently allocated */
+    OMX_U64 nMappedBytes;         /* currently mapped in the CPU */
+    OMX_U64 nPeakBytes;           /* high-water mark of nAllocatedBytes */
+} QOMX_VIDEO_MEMUSAGE;
+
+typedef struct QOMX_VIDEO_MEMORY_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;           /* in: OMX_ALL for the process aggregate */
+    OMX_U32 nSessions;            /* out: sessions included in the numbers */
+    QOMX_VIDEO_MEMUSAGE sUsage[QOMX_VIDEO_MEM_MAX];
+    QOMX_VIDEO_MEMUSAGE sTotal;
+    OMX_U64 nPoolRetainedBytes;   /* out: idle buffers kept allocated by
+                                     process-wide pools for later
+                                     sessions, not part of sUsage */
+    OMX_U32 nPoolRetainedBuffers;
+    OMX_U32 nPoolHits;            /* out: allocations served by a pool */
+    OMX_U32 nPoolMisses;          /* out: allocations a pool could not
+                                     serve */
+} QOMX_VIDEO_MEMORY_STATS;
+
+/*
+ * Per-session memory accounting. Every update is mirrored into a
+ * process-wide aggregate shared by all sessions of the library.
+ * Updates happen on buffer allocation and free only, so a single
+ * mutex is enough.
+ */
+class vidc_mem_stats
+{
+public:
+    vidc_mem_stats();
+    ~vidc_mem_stats();
+    void allocated(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes);
+    void released(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes);
+    void mapped(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes);
+    void unmapped(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes);
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_MEMORY_STATS *stats);
+    static void get_process_stats(QOMX_VIDEO_MEMORY_STATS *stats);
+private:
+    QOMX_VIDEO_MEMUSAGE m_usage[QOMX_VIDEO_MEM_MAX];
+    QOMX_VIDEO_MEMUSAGE m_total;
+    static pthread_mutex_t s_lock;
+    static QOMX_VIDEO_MEMUSAGE s_usage[QOMX_VIDEO_MEM_MAX];
+    static QOMX_VIDEO_MEMUSAGE s_total;
+    static OMX_U32 s_sessions;
+    static void add(QOMX_VIDEO_MEMUSAGE *usage, OMX_U64 *field, OMX_U32 bytes);
+    static void sub(OMX_U64 *field, OMX_U32 bytes);
+    static void fill(QOMX_VIDEO_MEMORY_STATS *stats,
+                     const QOMX_VIDEO_MEMUSAGE *usage,
+                     const QOMX_VIDEO_MEMUSAGE *total,
+                     OMX_U32 sessions);
+};
+
+typedef enum QOMX_VIDEO_QUEUE
+{
+    QOMX_VIDEO_QUEUE_ETB = 0,     /* m_etb_q: ETB/EBD messages */
+    QOMX_VIDEO_QUEUE_FTB,         /* m_ftb_q: FTB/FBD messages */
+    QOMX_VIDEO_QUEUE_CMD,         /* m_cmd_q: commands and events */
+    QOMX_VIDEO_QUEUE_MAX
+} QOMX_VIDEO_QUEUE;
+
+typedef struct QOMX_VIDEO_QUEUE_DEPTH
+{
+    OMX_U32 nCurrent;
+    OMX_U32 nHighWater;
+} QOMX_VIDEO_QUEUE_DEPTH;
+
+typedef struct QOMX_VIDEO_LIVE_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nWindowMs;            /* span covered by the rate and latency
+                                     fields below, at least one second
+                                     once the session has run that long */
+    OMX_U32 nFrameRateQ16;        /* frames decoded/encoded per second */
+    OMX_U32 nLatencyP50Us;        /* ETB to FBD latency percentiles, */
+    OMX_U32 nLatencyP95Us;        /* log-scale buckets with 1/4 octave */
+    OMX_U32 nLatencyP99Us;        /* resolution */
+    OMX_U32 nLatencyMaxUs;
+    OMX_U32 nLatencySamples;
+    OMX_U64 nUptimeMs;            /* since the component was created */
+    OMX_U64 nInputBuffers;        /* lifetime ETB count */
+    OMX_U64 nOutputFrames;        /* lifetime FBDs carrying data */
+    OMX_U32 nDroppedFrames;       /* frames skipped by the codec */
+    OMX_U32 nInputFlushes;
+    OMX_U32 nOutputFlushes;
+    OMX_U32 nPendingInputBuffers;
+    OMX_U32 nPendingOutputBuffers;
+    QOMX_VIDEO_QUEUE_DEPTH sQueue[QOMX_VIDEO_QUEUE_MAX];
+    OMX_U64 nConcealedMBs;        /* decoder only */
+} QOMX_VIDEO_LIVE_STATS;
+
+#define VIDC_LIVE_STATS_WINDOW_MS   1000
+#define VIDC_LIVE_STATS_BUCKETS     128
+#define VIDC_LIVE_STATS_SLOTS       64
+
+/*
+ * Rolling per-session pipeline statistics. The data path only does
+ * atomic increments and plain stores, never takes a lock. Input
+ * timestamps are remembered in a small hash keyed by nTimeStamp so the
+ * latency can be measured when the matching frame is returned; a slot
+ * overwritten before its frame comes back just loses that sample.
+ *
+ * Rates and percentiles are computed by get_stats() from the difference
+ * between the cumulative counters and a snapshot taken at least
+ * VIDC_LIVE_STATS_WINDOW_MS earlier, so a poller calling once a second
+ * sees roughly the last one to two seconds.
+ */
+class vidc_live_stats
+{
+public:
+    vidc_live_stats();
+    ~vidc_live_stats();
+    void input_queued(OMX_S64 timestamp);
+    void output_done(OMX_S64 timestamp, OMX_U32 filled_len);
+    void frame_dropped() { __sync_fetch_and_add(&m_dropped, 1); }
+    void input_flushed() { __sync_fetch_and_add(&m_input_flushes, 1); }
+    void output_flushed() { __sync_fetch_and_add(&m_output_flushes, 1); }
+    /* called with the queue lock held right after an insert */
+    void queued(QOMX_VIDEO_QUEUE queue, OMX_U32 depth)
+    {
+        if (queue < QOMX_VIDEO_QUEUE_MAX && depth > m_high_water[queue])
+            m_high_water[queue] = depth;
+    }
+    /* fills everything but nCurrent, the pending counts and
+     * nConcealedMBs, which the component owns */
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_LIVE_STATS *stats);
+private:
+    struct latency_slot
+    {
+        volatile OMX_S64 timestamp;
+        volatile OMX_U32 time_us;  /* 0 while free or being written */
+    };
+    struct snapshot
+    {
+        OMX_U64 time_us;
+        OMX_U32 frames;
+        OMX_U32 hist[VIDC_LIVE_STATS_BUCKETS];
+    };
+    static OMX_U64 now_us();
+    static OMX_U32 bucket(OMX_U32 value);
+    static OMX_U32 bucket_limit(OMX_U32 index);
+    static OMX_U32 slot_index(OMX_S64 timestamp);
+    void take_snapshot(snapshot *snap, OMX_U64 time_us);
+    OMX_U64 m_start_us;
+    volatile OMX_U32 m_inputs;
+    volatile OMX_U32 m_frames;
+    volatile OMX_U32 m_dropped;
+    volatile OMX_U32 m_input_flushes;
+    volatile OMX_U32 m_output_flushes;
+    volatile OMX_U32 m_hist[VIDC_LIVE_STATS_BUCKETS];
+    OMX_U32 m_high_water[QOMX_VIDEO_QUEUE_MAX];
+    latency_slot m_slots[VIDC_LIVE_STATS_SLOTS];
+    /* reader side only */
+    pthread_mutex_t m_read_lock;
+    snapshot m_prev;
+    snapshot m_base;
+};
+
+#define QOMX_VIDEO_LOCK_SITES       8
+#define QOMX_VIDEO_LOCK_SITE_NAME   48
+
+typedef struct QOMX_VIDEO_LOCK_SITE
+{
+    OMX_U8 cName[QOMX_VIDEO_LOCK_SITE_NAME]; /* "function:line" */
+    OMX_U32 nAcquired;
+    OMX_U32 nContended;           /* acquisitions that had to wait */
+    OMX_U64 nWaitUs;              /* time spent waiting at this site */
+    OMX_U64 nHoldUs;              /* time the lock was held from here */
+    OMX_U32 nHoldMaxUs;
+    OMX_U64 nBlockingUs;          /* time other sites waited while the
+                                     lock was held from here */
+} QOMX_VIDEO_LOCK_SITE;
+
+typedef struct QOMX_VIDEO_LOCK_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bEnabled;            /* out: false unless the session lock
+                                     was instrumented at creation */
+    OMX_U32 nAcquired;
+    OMX_U32 nContended;
+    OMX_U64 nWaitUs;
+    OMX_U64 nHoldUs;
+    OMX_U32 nSites;               /* out: entries filled in sSite */
+    QOMX_VIDEO_LOCK_SITE sSite[QOMX_VIDEO_LOCK_SITES];
+                                  /* most contended first, by
+                                     nWaitUs + nBlockingUs */
+} QOMX_VIDEO_LOCK_STATS;
+
+typedef struct vidc_lock_site
+{
+    const char *func;
+    int line;
+} vidc_lock_site;
+
+#define VIDC_MUTEX_MAX_SITES        32
+
+/*
+ * pthread mutex that can record, per call site, how long callers waited
+ * for it, how long they held it and whom they waited behind. All the
+ * bookkeeping is done while the mutex is held, so it needs no atomics;
+ * the holder seen by a waiter is read without the lock and is only a
+ * best guess. Without instrumentation lock() and unlock() add a flag
+ * test to the pthread calls. Take it through VIDC_MUTEX_LOCK so every
+ * call site gets its own static tag.
+ */
+class vidc_mutex
+{
+public:
+    vidc_mutex();
+    ~vidc_mutex();
+    /* only before the mutex is first used */
+    void set_instrumented(bool instrumented) { m_instrumented = instrumented; }
+    void lock(const vidc_lock_site *site)
+    {
+        if (m_instrumented)
+            lock_timed(site);
+        else
+            pthread_mutex_lock(&m_mutex);
+    }
+    void unlock()
+    {
+        if (m_instrumented)
+            unlock_timed();
+        else
+            pthread_mutex_unlock(&m_mutex);
+    }
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_LOCK_STATS *stats);
+    void report(const char *name);
+private:
+    struct site_stats
+    {
+        const vidc_lock_site *site;
+        OMX_U32 acquired;
+        OMX_U32 contended;
+        OMX_U64 wait_us;
+        OMX_U64 hold_us;
+        OMX_U32 hold_max_us;
+        OMX_U64 blocking_us;
+    };
+    static OMX_U64 now_us();
+    site_stats *find(const vidc_lock_site *site);
+    void lock_timed(const vidc_lock_site *site);
+    void unlock_timed();
+    pthread_mutex_t m_mutex;
+    bool m_instrumented;
+    const vidc_lock_site * volatile m_owner;
+    OMX_U64 m_acquired_us;
+    OMX_U32 m_num_sites;
+    site_stats m_sites[VIDC_MUTEX_MAX_SITES];
+    site_stats m_other;           /* sites that did not fit */
+};
+
+typedef enum QOMX_VIDEO_PERF_STAGE
+{
+    QOMX_VIDEO_PERF_PARSER = 0,   /* arbitrary-bytes frame parser */
+    QOMX_VIDEO_PERF_EVENT,        /* process_event_cb dispatch */
+    QOMX_VIDEO_PERF_ETB,          /* empty_this_buffer_proxy */
+    QOMX_VIDEO_PERF_FBD,          /* fill_buffer_done */
+    QOMX_VIDEO_PERF_STAGE_MAX
+} QOMX_VIDEO_PERF_STAGE;
+
+typedef enum QOMX_VIDEO_PERF_COUNTER
+{
+    QOMX_VIDEO_PERF_CYCLES = 0,
+    QOMX_VIDEO_PERF_INSTRUCTIONS,
+    QOMX_VIDEO_PERF_CACHE_MISSES,
+    QOMX_VIDEO_PERF_BRANCH_MISSES,
+    QOMX_VIDEO_PERF_COUNTER_MAX
+} QOMX_VIDEO_PERF_COUNTER;
+
+typedef struct QOMX_VIDEO_PERF_COUNTS
+{
+    OMX_U64 nCalls;
+    OMX_U64 nCount[QOMX_VIDEO_PERF_COUNTER_MAX];
+} QOMX_VIDEO_PERF_COUNTS;
+
+typedef struct QOMX_VIDEO_PERF_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bEnable;             /* in: start or stop counting;
+                                     out: counting */
+    OMX_U32 nCounterMask;         /* out: bit per QOMX_VIDEO_PERF_COUNTER
+                                     the CPU provides, 0 when perf events
+                                     are not available at all */
+    OMX_BOOL bUserOnly;           /* out: kernel time is not counted */
+    OMX_U32 nRunningPermille;     /* out: share of the counted time the
+                                     PMU actually ran the counters; below
+                                     1000 it multiplexed them with other
+                                     users and the counts are scaled */
+    OMX_U32 nThreads;             /* out: threads being counted */
+    OMX_U64 nFrames;              /* out: output frames so far */
+    QOMX_VIDEO_PERF_COUNTS sSession[QOMX_VIDEO_PERF_STAGE_MAX];
+                                  /* out: since counting started */
+    QOMX_VIDEO_PERF_COUNTS sLastFrame[QOMX_VIDEO_PERF_STAGE_MAX];
+                                  /* out: between the last two frames */
+} QOMX_VIDEO_PERF_STATS;
+
+#define VIDC_PERF_MAX_THREADS       8
+#define VIDC_PERF_MAX_DEPTH         4
+
+/*
+ * Per-session hardware counters (perf_event_open) split by pipeline
+ * stage. Each thread that enters a stage gets its own counter group;
+ * a stage entered inside another one pauses the outer stage, so the
+ * stages add up without double counting. Totals are kept per thread and
+ * summed by the reader without a lock. When the PMU multiplexes the
+ * group with other users, each interval is scaled by its enabled to
+ * running time ratio. Disabled, begin() and end() are
+ * a flag test; where perf events are missing or not permitted, enable()
+ * fails and the session runs uncounted.
+ */
+class vidc_perf
+{
+public:
+    vidc_perf();
+    ~vidc_perf();
+    bool enable(bool enable);
+    bool is_enabled() { return m_enabled; }
+    void begin(QOMX_VIDEO_PERF_STAGE stage)
+    {
+        if (m_enabled)
+            push(stage);
+    }
+    void end()
+    {
+        if (m_enabled)
+            pop();
+    }
+    /* called once per output frame */
+    void frame_done()
+    {
+        if (m_enabled)
+            roll_frame();
+    }
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_PERF_STATS *stats);
+    OMX_ERRORTYPE set_config(QOMX_VIDEO_PERF_STATS *stats);
+    void report(const char *name);
+private:
+    struct thread_state
+    {
+        pthread_t thread;
+        int fd[QOMX_VIDEO_PERF_COUNTER_MAX];
+        int slot[QOMX_VIDEO_PERF_COUNTER_MAX]; /* position in a group read */
+        OMX_U32 nr;
+        OMX_U32 generation;
+        OMX_U32 depth;
+        QOMX_VIDEO_PERF_STAGE stack[VIDC_PERF_MAX_DEPTH];
+        OMX_U64 last[QOMX_VIDEO_PERF_COUNTER_MAX];
+        OMX_U64 last_time[2];     /* time enabled, time running */
+        OMX_U64 time_enabled;     /* charged to the stages */
+        OMX_U64 time_running;
+        QOMX_VIDEO_PERF_COUNTS totals[QOMX_VIDEO_PERF_STAGE_MAX];
+    };
+    bool open_group(thread_state *state);
+    static void close_group(thread_state *state);
+    bool read_group(thread_state *state, OMX_U64 *values, OMX_U64 *times);
+    thread_state *current();
+    void charge(thread_state *state, const OMX_U64 *values,
+                const OMX_U64 *times);
+    void push(QOMX_VIDEO_PERF_STAGE stage);
+    void pop();
+    void roll_frame();
+    void sum(QOMX_VIDEO_PERF_COUNTS *totals);
+    OMX_U32 running_permille();
+    pthread_mutex_t m_lock;       /* thread table growth and frames */
+    volatile bool m_enabled;
+    bool m_probed;
+    bool m_available;
+    bool m_user_only;
+    OMX_U32 m_mask;
+    volatile OMX_U32 m_generation;
+    thread_state m_threads[VIDC_PERF_MAX_THREADS];
+    volatile OMX_U32 m_num_threads;
+    OMX_U64 m_frames;
+    QOMX_VIDEO_PERF_COUNTS m_frame_base[QOMX_VIDEO_PERF_STAGE_MAX];
+    QOMX_VIDEO_PERF_COUNTS m_last_frame[QOMX_VIDEO_PERF_STAGE_MAX];
+};
+
+typedef enum QOMX_VIDEO_THREAD_ROLE
+{
+    QOMX_VIDEO_THREAD_MESSAGE = 0,  /* OMX command and event pipe reader */
+    QOMX_VIDEO_THREAD_CALLBACK,     /* driver message reader */
+    QOMX_VIDEO_THREAD_ROLE_MAX
+} QOMX_VIDEO_THREAD_ROLE;
+
+#define QOMX_VIDEO_THREAD_NAME_MAX  16
+
+typedef struct QOMX_VIDEO_THREAD_USAGE
+{
+    OMX_U8 cName[QOMX_VIDEO_THREAD_NAME_MAX]; /* thread name, empty if the
+                                                 role never ran */
+    OMX_BOOL bRunning;
+    OMX_U64 nCpuTimeUs;           /* user + system time of the thread */
+    OMX_U64 nWakeups;             /* returns from the blocking wait */
+} QOMX_VIDEO_THREAD_USAGE;
+
+typedef struct QOMX_VIDEO_THREAD_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U64 nSessionUs;           /* wall time since the component was
+                                     created */
+    OMX_U64 nCpuTimeUs;           /* sum over all roles */
+    QOMX_VIDEO_THREAD_USAGE sThread[QOMX_VIDEO_THREAD_ROLE_MAX];
+} QOMX_VIDEO_THREAD_STATS;
+
+/*
+ * CPU time and wakeups of the threads a session owns, by role. Each
+ * thread registers itself when it starts and counts its own wakeups;
+ * CPU time of a running thread is read through its CPU-time clock, and
+ * the final value is latched when it exits. Client threads calling into
+ * the component are not covered.
+ */
+class vidc_thread_stats
+{
+public:
+    vidc_thread_stats();
+    ~vidc_thread_stats();
+    /* called by the thread itself, after it has named itself */
+    void thread_start(QOMX_VIDEO_THREAD_ROLE role);
+    void thread_exit(QOMX_VIDEO_THREAD_ROLE role);
+    void wakeup(QOMX_VIDEO_THREAD_ROLE role)
+    {
+        m_threads[role].wakeups++;
+    }
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_THREAD_STATS *stats);
+    void report(const char *name);
+private:
+    struct thread_state
+    {
+        char name[QOMX_VIDEO_THREAD_NAME_MAX];
+        bool running;
+        clockid_t clock;
+        OMX_U64 exited_us;        /* CPU time of threads that exited */
+        volatile OMX_U32 wakeups; /* written by the owning thread only */
+    };
+    static OMX_U64 clock_us(clockid_t clock);
+    pthread_mutex_t m_lock;       /* running and clock against exit */
+    OMX_U64 m_start_us;
+    thread_state m_threads[QOMX_VIDEO_THREAD_ROLE_MAX];
+};
+
+typedef enum QOMX_VIDEO_STARTUP_PHASE
+{
+    QOMX_VIDEO_STARTUP_DEVICE_OPEN = 0, /* component_init: driver open */
+    QOMX_VIDEO_STARTUP_DEVICE_SETUP,    /* component_init: ioctl setup */
+    QOMX_VIDEO_STARTUP_LOADED_TO_IDLE,  /* command to completion */
+    QOMX_VIDEO_STARTUP_BUFFER_ALLOC,    /* allocate/use_buffer, summed over
+                                           buffers; overlaps the phase the
+                                           client allocates in */
+    QOMX_VIDEO_STARTUP_IDLE_TO_EXECUTING,
+    QOMX_VIDEO_STARTUP_FIRST_ETB,       /* executing to first ETB */
+    QOMX_VIDEO_STARTUP_HEADER_PARSE,    /* first ETB to port settings
+                                           changed */
+    QOMX_VIDEO_STARTUP_PORT_RECONFIG,   /* port settings changed to output
+                                           port enabled */
+    QOMX_VIDEO_STARTUP_FIRST_FBD,       /* first ETB, or the reconfig, to
+                                           the first filled FBD */
+    QOMX_VIDEO_STARTUP_PHASE_MAX
+} QOMX_VIDEO_STARTUP_PHASE;
+
+typedef struct QOMX_VIDEO_STARTUP_TIME
+{
+    OMX_U64 nStartUs;             /* since the component was created */
+    OMX_U64 nDurationUs;
+    OMX_U32 nCount;               /* 0 if the phase did not happen, else
+                                     1, or buffers for BUFFER_ALLOC */
+} QOMX_VIDEO_STARTUP_TIME;
+
+typedef struct QOMX_VIDEO_STARTUP_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bComplete;           /* first frame delivered, values final */
+    OMX_U64 nFirstFrameUs;        /* component creation to first FBD */
+    QOMX_VIDEO_STARTUP_TIME sPhase[QOMX_VIDEO_STARTUP_PHASE_MAX];
+} QOMX_VIDEO_STARTUP_STATS;
+
+/*
+ * Time to first frame split into phases. Each phase is recorded once:
+ * begin() (re)starts it until it has ended, end() closes it and returns
+ * true the first time so the caller can start the next one. Everything
+ * freezes at the first filled FBD; a phase still open then, such as the
+ * header parse of a stream that needed no reconfig, stays unrecorded.
+ * Once complete, every call is a flag test.
+ */
+class vidc_startup_stats
+{
+public:
+    vidc_startup_stats();
+    ~vidc_startup_stats();
+    static OMX_U64 now_us();
+    void begin(QOMX_VIDEO_STARTUP_PHASE phase);
+    bool end(QOMX_VIDEO_STARTUP_PHASE phase);
+    /* adds one occurrence of a repeated phase that began at start_us */
+    void add(QOMX_VIDEO_STARTUP_PHASE phase, OMX_U64 start_us);
+    /* ends FIRST_FBD and freezes the numbers; true the first time */
+    bool first_frame();
+    bool is_complete() { return m_complete; }
+    OMX_ERRORTYPE get_stats(QOMX_VIDEO_STARTUP_STATS *stats);
+    void report(const char *name);
+private:
+    pthread_mutex_t m_lock;
+    volatile bool m_complete;
+    OMX_U64 m_created_us;
+    OMX_U64 m_first_frame_us;
+    bool m_open[QOMX_VIDEO_STARTUP_PHASE_MAX];
+    volatile bool m_ended[QOMX_VIDEO_STARTUP_PHASE_MAX];
+    QOMX_VIDEO_STARTUP_TIME m_phase[QOMX_VIDEO_STARTUP_PHASE_MAX];
+};
+
+#define VIDC_MUTEX_LOCK(m) \
+    do { \
+        static const vidc_lock_site vidc_lock_site_ = { __FUNCTION__, __LINE__ }; \
+        (m)->lock(&vidc_lock_site_); \
+    } while (0)
+#define VIDC_MUTEX_UNLOCK(m) (m)->unlock()
+
+#endif
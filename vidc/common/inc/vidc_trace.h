@@ -0,0 +1,127 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#ifndef __VIDC_TRACE_H__
+#define __VIDC_TRACE_H__
+
+#include <pthread.h>
+#include "OMX_Core.h"
+#include "OMX_Types.h"
+
+/*
+ * Vendor config index of the per-session pipeline tracer. It is handled
+ * in every component state, including Executing.
+ */
+enum QOMX_VIDC_TRACE_INDEXTYPE
+{
+    /* "OMX.QCOM.index.config.video.Trace"
+     * QOMX_VIDEO_TRACE */
+    QOMX_IndexConfigVideoTrace = OMX_IndexVendorStartUnused + 0x00A00200,
+};
+
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_TRACE \
+    "OMX.QCOM.index.config.video.Trace"
+
+#define QOMX_VIDEO_TRACE_PATH_MAX 128
+
+typedef struct QOMX_VIDEO_TRACE
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BOOL bEnable;             /* in/out: recording on or off */
+    OMX_U32 nEvents;              /* in: ring size on first enable, 0 for
+                                     the default; out: events recorded */
+    OMX_U8 cDumpFile[QOMX_VIDEO_TRACE_PATH_MAX];
+                                  /* in: if not empty, a bare file name;
+                                     the ring is written to it in
+                                     VIDC_DEBUG_DIR (vidc_log.h) as Chrome
+                                     trace JSON before bEnable is
+                                     applied */
+} QOMX_VIDEO_TRACE;
+
+typedef enum VIDC_TRACE_EVENT
+{
+    VIDC_TRACE_ETB = 0,           /* EmptyThisBuffer from the client */
+    VIDC_TRACE_PARSE_DONE,        /* frame assembled from arbitrary bytes */
+    VIDC_TRACE_DRV_SUBMIT,        /* frame queued to the driver */
+    VIDC_TRACE_DRV_INPUT_DONE,    /* input buffer released by the driver */
+    VIDC_TRACE_DRV_OUTPUT_DONE,   /* decoded frame returned by the driver */
+    VIDC_TRACE_FBD,               /* FillBufferDone to the client */
+    VIDC_TRACE_FTB,               /* FillThisBuffer from the client */
+    VIDC_TRACE_EVENT_MAX
+} VIDC_TRACE_EVENT;
+
+#define VIDC_TRACE_DEFAULT_EVENTS 4096
+#define VIDC_TRACE_MAX_EVENTS     (1 << 20)
+
+/*
+ * Per-session event ring. Recording is compiled in everywhere and costs
+ * a single flag test while disabled. Writers on any thread claim a slot
+ * with an atomic increment and publish it through its sequence number,
+ * so no lock is taken in the data path; the oldest events are
+ * overwritten once the ring is full. The ring is allocated on the first
+ * enable and kept until the session is destroyed, so late writers never
+ * see it freed.
+ */
+class vidc_tracer
+{
+public:
+    vidc_tracer();
+    ~vidc_tracer();
+    bool enable(OMX_U32 num_events);
+    void disable();
+    bool is_enabled() { return m_enabled; }
+    void record(VIDC_TRACE_EVENT event, OMX_U32 buf_index, OMX_S64 timestamp)
+    {
+        if (m_enabled)
+            add(event, buf_index, timestamp);
+    }
+    OMX_U32 get_count();
+    bool dump(const char *path, const char *name);
+    OMX_ERRORTYPE get_config(QOMX_VIDEO_TRACE *trace);
+    OMX_ERRORTYPE set_config(QOMX_VIDEO_TRACE *trace, const char *name);
+private:
+    struct trace_event
+    {
+        volatile OMX_U32 seq;     /* claim sequence + 1, 0 while written */
+        OMX_U16 type;
+        OMX_U16 buf_index;
+        OMX_U32 tid;
+        OMX_U64 time_us;
+        OMX_S64 timestamp;
+    };
+    void add(VIDC_TRACE_EVENT event, OMX_U32 buf_index, OMX_S64 timestamp);
+    static const char *event_name(OMX_U32 type);
+    trace_event *m_events;
+    OMX_U32 m_size;
+    volatile OMX_U32 m_head;
+    volatile bool m_enabled;
+};
+
+#endif
@@ -30,11 +30,13 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 extra_data_handler::extra_data_handler()
 {
-   rbsp_buf = (OMX_U8 *) calloc(1,100);
+   rbsp_buf = (OMX_U8 *) calloc(1,RBSP_BUF_SIZE);
    memset(&frame_packing_arrangement,0,sizeof(frame_packing_arrangement));
    frame_packing_arrangement.cancel_flag = 1;
    pack_sei = false;
    sei_payload_type = -1;
+   sei_nal_len = 0;
+   sei_cache_len = 0;
 }
 
 extra_data_handler::~extra_data_handler()
@@ -95,6 +97,7 @@ OMX_U32 extra_data_handler::d_ue()
 
 OMX_U32 extra_data_handler::parse_frame_pack(OMX_U32 payload_size)
 {
+  sei_nal_len = 0;
   frame_packing_arrangement.id = d_ue();
   frame_packing_arrangement.cancel_flag = d_u(1);
   if(!frame_packing_arrangement.cancel_flag) {
@@ -166,6 +169,14 @@ OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
   OMX_U32 nal_unit_type, payload_type = 0, payload_size = 0;
   OMX_U32 marker = 0, pad = 0xFF;
 
+  // Frame packing SEI is usually repeated unchanged on every frame
+  if (buffer_length && buffer_length == sei_cache_len &&
+      !memcmp(buffer, sei_cache, buffer_length)) {
+    DEBUG_PRINT_LOW("\nIn %s() SEI unchanged, keep parsed data", __func__);
+    return 1;
+  }
+  sei_cache_len = 0;
+
   nal_unit_type = parse_rbsp(buffer, buffer_length);
 
   if (nal_unit_type != NAL_TYPE_SEI) {
@@ -214,6 +225,10 @@ OMX_S32 extra_data_handler::parse_sei(OMX_U8 *buffer, OMX_U32 buffer_length)
   }
   DEBUG_PRINT_LOW("\nIn %s() payload_size : %u/%u", __func__,
     payload_size, byte_ptr);
+  if (buffer_length <= SEI_NAL_MAX_SIZE) {
+    memcpy(sei_cache, buffer, buffer_length);
+    sei_cache_len = buffer_length;
+  }
   return 1;
 }
 /*======================================================================
@@ -266,6 +281,96 @@ OMX_S32 extra_data_handler::parse_sliceinfo(
   return 0;
 }
 
+/*======================================================================
+  Build the slice table above from the bitstream itself, for drivers
+  that do not report it. Only coded slice NAL units (nal_unit_type 1-5)
+  open a new entry; SPS, PPS, AUD and SEI units stay with the slice that
+  follows them, or with the last slice when they trail it, so the
+  entries still add up to the whole buffer. A zero byte ahead of a 3
+  byte start code belongs to the NAL unit it opens.
+  Returns the number of slices found, at most max_slices are stored.
+======================================================================*/
+OMX_U32 extra_data_handler::index_slices(OMX_U8 *buf, OMX_U32 len,
+  OMX_U32 *slice_info, OMX_U32 max_slices)
+{
+  OMX_U32 i = 0, start, nal_type, num_slices = 0, prev_offset = 0;
+
+  while (i + 2 < len) {
+    // buf[i+2] > 1 rules out start codes at i, i+1 and i+2
+    if (buf[i+2] > 1)
+      i += 3;
+    else if (buf[i+1])
+      i += 2;
+    else if (buf[i] || buf[i+2] != H264_START_CODE)
+      i++;
+    else {
+      i += 3;
+      nal_type = (i < len) ? (buf[i] & 0x1F) : 0;
+      if (nal_type < NAL_TYPE_SLICE || nal_type > NAL_TYPE_IDR)
+        continue;
+      start = (i >= 4 && !buf[i-4]) ? i - 4 : i - 3;
+      // Units ahead of the first slice are folded into it
+      if (!num_slices)
+        start = 0;
+      if (num_slices && num_slices <= max_slices)
+        slice_info[num_slices*2] = start - prev_offset;
+      if (++num_slices <= max_slices)
+        slice_info[num_slices*2 - 1] = start;
+      prev_offset = start;
+    }
+  }
+  if (num_slices && num_slices <= max_slices)
+    slice_info[num_slices*2] = len - prev_offset;
+  return num_slices;
+}
+
+OMX_U32 extra_data_handler::create_sliceinfo(OMX_BUFFERHEADERTYPE *buf_hdr)
+{
+  OMX_U8 *buffer = buf_hdr->pBuffer + buf_hdr->nOffset;
+  OMX_U8 *buf_end = buf_hdr->pBuffer + buf_hdr->nAllocLen;
+  OMX_OTHER_EXTRADATATYPE *extra_data = (OMX_OTHER_EXTRADATATYPE *)
+    ((unsigned)(buffer + buf_hdr->nFilledLen + 3)&(~3));
+  OMX_U32 hdr_size = sizeof(OMX_OTHER_EXTRADATATYPE) - sizeof(OMX_U32);
+  OMX_U32 max_slices = 0, num_slices, data_size;
+
+  // Room left for the record header, slice count and terminator
+  if ((OMX_U8 *)extra_data + 2 * hdr_size + sizeof(OMX_U32) < buf_end)
+    max_slices = (buf_end - (OMX_U8 *)extra_data - 2 * hdr_size -
+      sizeof(OMX_U32)) / (2 * sizeof(OMX_U32));
+  num_slices = index_slices(buffer, buf_hdr->nFilledLen,
+    (OMX_U32 *)extra_data->data, max_slices);
+  if (!num_slices) {
+    // Parameter sets only, e.g. the codec config buffer
+    DEBUG_PRINT_LOW("\nIn %s() no slices in %u bytes", __func__,
+      buf_hdr->nFilledLen);
+    return 0;
+  }
+  if (num_slices > max_slices) {
+    DEBUG_PRINT_ERROR("\nERROR: In %s() no room for %u slices", __func__,
+      num_slices);
+    return 0;
+  }
+  data_size = sizeof(OMX_U32) + num_slices * 2 * sizeof(OMX_U32);
+  *(OMX_U32 *)extra_data->data = num_slices;
+  extra_data->nSize = hdr_size + data_size;
+  extra_data->nVersion.nVersion = OMX_SPEC_VERSION;
+  extra_data->nPortIndex = buf_hdr->nOutputPortIndex;
+  extra_data->eType = (OMX_EXTRADATATYPE)VEN_EXTRADATA_SLICEINFO;
+  extra_data->nDataSize = data_size;
+  DEBUG_PRINT_LOW("\nIn %s() %u slices in %u bytes", __func__, num_slices,
+    buf_hdr->nFilledLen);
+
+  extra_data = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) extra_data) +
+    extra_data->nSize);
+  extra_data->nSize = hdr_size;
+  extra_data->nVersion.nVersion = OMX_SPEC_VERSION;
+  extra_data->nPortIndex = buf_hdr->nOutputPortIndex;
+  extra_data->eType = OMX_ExtraDataNone;
+  extra_data->nDataSize = 0;
+  buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
+  return num_slices;
+}
+
 OMX_U32 extra_data_handler::parse_extra_data(OMX_BUFFERHEADERTYPE *buf_hdr)
 {
   OMX_OTHER_EXTRADATATYPE *extra_data = (OMX_OTHER_EXTRADATATYPE *)
@@ -311,8 +416,13 @@ OMX_U32 extra_data_handler::set_frame_pack_data(OMX_QCOM_FRAME_PACK_ARRANGEMENT
    *frame_pack)
 {
    DEBUG_PRINT_LOW("\n%s:%d set frame data", __func__, __LINE__);
-   memcpy(&frame_packing_arrangement.id, &frame_pack->id,
-     FRAME_PACK_SIZE*sizeof(OMX_U32));
+   if (memcmp(&frame_packing_arrangement.id, &frame_pack->id,
+       FRAME_PACK_SIZE*sizeof(OMX_U32))) {
+     memcpy(&frame_packing_arrangement.id, &frame_pack->id,
+       FRAME_PACK_SIZE*sizeof(OMX_U32));
+     sei_nal_len = 0;
+     sei_cache_len = 0;
+   }
    pack_sei = true;
    sei_payload_type = SEI_PAYLOAD_FRAME_PACKING_ARRANGEMENT;
    return 1;
@@ -423,28 +533,39 @@ OMX_S32 extra_data_handler::create_rbsp(OMX_U8 *buf, OMX_U32 nalu_type)
     return j;
 }
 
-OMX_U32 extra_data_handler::create_sei(OMX_U8 *buffer)
+OMX_U32 extra_data_handler::create_sei(OMX_U8 *buffer, OMX_U32 buffer_size)
 {
    OMX_U32 i, ret_val = 0;
 
-   byte_ptr = 0;
-   bit_ptr  = 8;
-
    if(sei_payload_type == SEI_PAYLOAD_FRAME_PACKING_ARRANGEMENT) {
-     create_frame_pack();
-
-     if(bit_ptr != 8) {
-       e_u(1,1);
-       if(bit_ptr != 8)
-         e_u(0,bit_ptr);
-     }
+     // Encode only when the arrangement changed, reuse the NAL otherwise
+     if(!sei_nal_len) {
+       memset(rbsp_buf, 0, RBSP_BUF_SIZE);
+       byte_ptr = 0;
+       bit_ptr  = 8;
+
+       create_frame_pack();
+
+       if(bit_ptr != 8) {
+         e_u(1,1);
+         if(bit_ptr != 8)
+           e_u(0,bit_ptr);
+       }
 
-     //Payload will have been byte aligned by now,
-     //insert the rbsp trailing bits
-     e_u(1, 1);
-     e_u(0, 7);
+       //Payload will have been byte aligned by now,
+       //insert the rbsp trailing bits
+       e_u(1, 1);
+       e_u(0, 7);
 
-     ret_val = create_rbsp(buffer, NAL_TYPE_SEI);
+       sei_nal_len = create_rbsp(sei_nal, NAL_TYPE_SEI);
+     }
+     if(sei_nal_len <= buffer_size) {
+       memcpy(buffer, sei_nal, sei_nal_len);
+       ret_val = sei_nal_len;
+     } else {
+       DEBUG_PRINT_ERROR("\nERROR: In %s() no room for SEI %u/%u", __func__,
+         sei_nal_len, buffer_size);
+     }
    }
 
    pack_sei = false;
@@ -457,7 +578,7 @@ OMX_U32 extra_data_handler::create_extra_data(OMX_BUFFERHEADERTYPE *buf_hdr)
 {
    OMX_U8 *buffer = (OMX_U8 *) ((unsigned)(buf_hdr->pBuffer +
      buf_hdr->nOffset + buf_hdr->nFilledLen));
-   OMX_U32 msg_size;
+   OMX_U32 msg_size, used_len = buf_hdr->nOffset + buf_hdr->nFilledLen;
 
    DEBUG_PRINT_LOW("\n filled_len/orig_len %d/%d", buf_hdr->nFilledLen,
      buf_hdr->nAllocLen);
@@ -466,7 +587,8 @@ OMX_U32 extra_data_handler::create_extra_data(OMX_BUFFERHEADERTYPE *buf_hdr)
       DEBUG_PRINT_LOW("\n%s:%d create extra data with config", __func__,
         __LINE__);
       if(pack_sei) {
-         msg_size = create_sei(buffer);
+         msg_size = create_sei(buffer, (buf_hdr->nAllocLen > used_len)?
+           (buf_hdr->nAllocLen - used_len) : 0);
 	 if( msg_size > 0)
            buf_hdr->nFilledLen += msg_size;
       }
@@ -0,0 +1,303 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "vidc_dump.h"
+#include "vidc_log.h"
+#ifdef _ANDROID_
+extern "C"{
+#include <utils/Log.h>
+}
+#endif
+
+vidc_dump::vidc_dump() :
+  m_fp(NULL),
+  m_ring(NULL),
+  m_size(0),
+  m_head(0),
+  m_tail(0),
+  m_write(0),
+  m_end(0),
+  m_busy(0),
+  m_active(false),
+  m_stop(false),
+  m_block(false),
+  m_write_failed(false),
+  m_interval(1),
+  m_errors_only(false),
+  m_buffers(0),
+  m_written(0),
+  m_dropped(0),
+  m_skipped(0)
+{
+  m_path[0] = 0;
+}
+
+vidc_dump::~vidc_dump()
+{
+  close();
+}
+
+bool vidc_dump::open(const char *path, OMX_U32 ring_bytes, bool block,
+                     bool truncate)
+{
+  OMX_U32 size = 64 * 1024;
+
+  if (m_ring || !path || !path[0])
+    return false;
+  if (!ring_bytes)
+    ring_bytes = VIDC_DUMP_DEFAULT_RING;
+  while (size < ring_bytes && size < VIDC_DUMP_MAX_RING)
+    size <<= 1;
+  m_fp = fopen(path, truncate ? "wb" : "ab");
+  if (!m_fp)
+  {
+    DEBUG_PRINT_ERROR("vidc_dump: failed to open %s", path);
+    return false;
+  }
+  m_ring = (OMX_U8 *) malloc(size);
+  if (!m_ring)
+  {
+    fclose(m_fp);
+    m_fp = NULL;
+    return false;
+  }
+  // Fault the pages in now rather than in the first callbacks
+  memset(m_ring, 0, size);
+  strlcpy(m_path, path, sizeof(m_path));
+  m_size = size;
+  m_head = m_tail = 0;
+  m_buffers = m_written = m_dropped = m_skipped = 0;
+  m_block = block;
+  m_write_failed = false;
+  m_stop = false;
+  sem_init(&m_sem, 0, 0);
+  if (pthread_create(&m_thread, NULL, writer_thread, this))
+  {
+    sem_destroy(&m_sem);
+    free(m_ring);
+    m_ring = NULL;
+    fclose(m_fp);
+    m_fp = NULL;
+    return false;
+  }
+  m_active = true;
+  DEBUG_PRINT_HIGH("vidc_dump: writing %s through a %lu byte ring",
+                   m_path, m_size);
+  return true;
+}
+
+/* Stops taking buffers, flushes what is queued and joins the writer */
+void vidc_dump::close()
+{
+  if (!m_ring)
+    return;
+  m_active = false;
+  // Wait out a producer that was already past the flag test
+  while (__sync_lock_test_and_set(&m_busy, 1))
+    sched_yield();
+  m_stop = true;
+  sem_post(&m_sem);
+  pthread_join(m_thread, NULL);
+  sem_destroy(&m_sem);
+  fclose(m_fp);
+  m_fp = NULL;
+  free(m_ring);
+  m_ring = NULL;
+  __sync_lock_release(&m_busy);
+  DEBUG_PRINT_HIGH("vidc_dump: %s: %lu buffers written, %lu dropped, "
+                   "%lu skipped", m_path, m_written, m_dropped, m_skipped);
+}
+
+void vidc_dump::set_sampling(OMX_U32 interval, bool errors_only)
+{
+  m_interval = interval ? interval : 1;
+  m_errors_only = errors_only;
+}
+
+bool vidc_dump::keep(bool error)
+{
+  OMX_U32 index = __sync_fetch_and_add(&m_buffers, 1);
+  if (m_errors_only ? !error : (index % m_interval) != 0)
+  {
+    __sync_fetch_and_add(&m_skipped, 1);
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Reserves len contiguous bytes of the stream. On success the caller
+ * owns the ring until commit(); on failure the buffer is counted as
+ * dropped and nothing else is to be called for it.
+ */
+bool vidc_dump::begin(OMX_U32 len)
+{
+  if (__sync_lock_test_and_set(&m_busy, 1))
+  {
+    __sync_fetch_and_add(&m_dropped, 1);
+    return false;
+  }
+  if (!m_ring || len > m_size)
+  {
+    __sync_lock_release(&m_busy);
+    __sync_fetch_and_add(&m_dropped, 1);
+    return false;
+  }
+  while (m_size - (m_head - m_tail) < len)
+  {
+    if (!m_block)
+    {
+      __sync_lock_release(&m_busy);
+      __sync_fetch_and_add(&m_dropped, 1);
+      return false;
+    }
+    sem_post(&m_sem);
+    usleep(1000);
+  }
+  m_write = m_head;
+  m_end = m_head + len;
+  return true;
+}
+
+void vidc_dump::append(const void *data, OMX_U32 len)
+{
+  OMX_U32 offset = m_write & (m_size - 1);
+  OMX_U32 first;
+
+  if (len > m_end - m_write)
+    len = m_end - m_write;
+  first = m_size - offset;
+  if (first > len)
+    first = len;
+  memcpy(m_ring + offset, data, first);
+  memcpy(m_ring, (const OMX_U8 *) data + first, len - first);
+  m_write += len;
+}
+
+void vidc_dump::commit()
+{
+  // Data must be visible before the writer sees the new head
+  __sync_synchronize();
+  m_head = m_write;
+  __sync_fetch_and_add(&m_written, 1);
+  __sync_lock_release(&m_busy);
+  sem_post(&m_sem);
+}
+
+void vidc_dump::drain()
+{
+  OMX_U32 head = m_head;
+  OMX_U32 offset, len;
+
+  __sync_synchronize();
+  while (m_tail != head)
+  {
+    offset = m_tail & (m_size - 1);
+    len = head - m_tail;
+    if (len > m_size - offset)
+      len = m_size - offset;
+    // After a write error the stream is consumed and discarded so the
+    // producer keeps running at full speed
+    if (!m_write_failed && fwrite(m_ring + offset, 1, len, m_fp) != len)
+    {
+      DEBUG_PRINT_ERROR("vidc_dump: write to %s failed, dump stopped",
+                        m_path);
+      m_write_failed = true;
+    }
+    __sync_synchronize();
+    m_tail += len;
+  }
+}
+
+void *vidc_dump::writer_thread(void *arg)
+{
+  vidc_dump *dump = (vidc_dump *) arg;
+
+  while (!dump->m_stop)
+  {
+    if (sem_wait(&dump->m_sem))
+      continue;
+    dump->drain();
+  }
+  dump->drain();
+  return NULL;
+}
+
+OMX_ERRORTYPE vidc_dump::get_config(QOMX_VIDEO_DUMP *dump)
+{
+  if (!dump)
+    return OMX_ErrorBadParameter;
+  dump->bEnable = m_active ? OMX_TRUE : OMX_FALSE;
+  dump->nSampleInterval = m_interval;
+  dump->bErrorsOnly = m_errors_only ? OMX_TRUE : OMX_FALSE;
+  dump->nRingBytes = m_size;
+  dump->nBuffersWritten = m_written;
+  dump->nBuffersDropped = m_dropped;
+  // The full path may not fit, the directory is implied for client files
+  if (!strncmp(m_path, VIDC_DEBUG_DIR, sizeof(VIDC_DEBUG_DIR) - 1))
+    strlcpy((char *) dump->cPath, m_path + sizeof(VIDC_DEBUG_DIR) - 1,
+            QOMX_VIDEO_DUMP_PATH_MAX);
+  else
+    strlcpy((char *) dump->cPath, m_path, QOMX_VIDEO_DUMP_PATH_MAX);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE vidc_dump::set_config(QOMX_VIDEO_DUMP *dump)
+{
+  char path[VIDC_DUMP_FILE_PATH_MAX];
+
+  if (!dump || !memchr(dump->cPath, 0, QOMX_VIDEO_DUMP_PATH_MAX))
+    return OMX_ErrorBadParameter;
+  // The client names a file, the directory is ours
+  if (dump->cPath[0] &&
+      !vidc_debug_path(path, sizeof(path), (const char *) dump->cPath))
+    return OMX_ErrorBadParameter;
+  if (!dump->bEnable)
+  {
+    // The file and the writer stay until the session is destroyed
+    set_active(false);
+    return OMX_ErrorNone;
+  }
+  if (!m_ring)
+  {
+    if (!dump->cPath[0])
+      return OMX_ErrorBadParameter;
+    set_sampling(dump->nSampleInterval, dump->bErrorsOnly == OMX_TRUE);
+    if (!open(path, dump->nRingBytes))
+      return OMX_ErrorInsufficientResources;
+    return OMX_ErrorNone;
+  }
+  if (dump->cPath[0] && strcmp(path, m_path))
+    return OMX_ErrorIncorrectStateOperation;
+  set_sampling(dump->nSampleInterval, dump->bErrorsOnly == OMX_TRUE);
+  set_active(true);
+  return OMX_ErrorNone;
+}
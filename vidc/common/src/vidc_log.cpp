@@ -0,0 +1,403 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "vidc_log.h"
+#ifdef _ANDROID_
+extern "C"{
+#include <utils/Log.h>
+}
+#include <cutils/properties.h>
+#endif
+
+volatile int vidc_log_level = VIDC_LOG_HIGH;
+
+enum vidc_log_arg_type
+{
+  VIDC_LOG_ARG_INT = 0,
+  VIDC_LOG_ARG_LONG,
+  VIDC_LOG_ARG_LLONG,
+  VIDC_LOG_ARG_PTR,
+  VIDC_LOG_ARG_STR,
+  VIDC_LOG_ARG_DOUBLE
+};
+
+struct vidc_log_record
+{
+  volatile OMX_U32 seq;           /* claim sequence + 1, 0 while written */
+  OMX_U32 tid;
+  OMX_U64 time_us;
+  const vidc_log_site *site;
+  OMX_U64 args[VIDC_LOG_MAX_ARGS];
+};
+
+static pthread_once_t s_init_once = PTHREAD_ONCE_INIT;
+static OMX_U32 s_rate_limit = VIDC_LOG_DEFAULT_RATE;
+static vidc_log_record *s_records = NULL;
+static OMX_U32 s_num_records = 0;
+static volatile OMX_U32 s_head = 0;
+static char s_dump_file[128];
+
+static OMX_U64 log_now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void log_print(const char *tag, const char *fmt, va_list args)
+{
+#ifdef _ANDROID_
+  __android_log_vprint(ANDROID_LOG_ERROR, tag, fmt, args);
+#else
+  (void) tag;
+  vprintf(fmt, args);
+#endif
+}
+
+static void log_printf(const char *tag, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  log_print(tag, fmt, args);
+  va_end(args);
+}
+
+static void log_init_once()
+{
+#ifdef _ANDROID_
+  char property_value[PROPERTY_VALUE_MAX] = {0};
+  /* vidc.debug.level: 0 errors, 1 high (default), 2 low */
+  if (property_get("vidc.debug.level", property_value, NULL) > 0)
+    vidc_log_level = atoi(property_value);
+  /* vidc.debug.ratelimit: messages per call site per second, 0 = off */
+  if (property_get("vidc.debug.ratelimit", property_value, NULL) > 0)
+    s_rate_limit = atoi(property_value);
+  /* vidc.debug.binlog: records kept in memory instead of logcat */
+  if (property_get("vidc.debug.binlog", property_value, NULL) > 0 &&
+      atoi(property_value) > 0)
+    vidc_log_set_binary(atoi(property_value));
+  property_get("vidc.debug.binlog.file", s_dump_file, "");
+#endif
+}
+
+void vidc_log_init()
+{
+  pthread_once(&s_init_once, log_init_once);
+}
+
+bool vidc_log_set_binary(OMX_U32 num_records)
+{
+  OMX_U32 size = 16;
+  vidc_log_record *records;
+
+  // The ring is never freed, late writers may still hold a slot
+  if (s_records)
+    return true;
+  while (size < num_records && size < VIDC_LOG_MAX_RECORDS)
+    size <<= 1;
+  records = (vidc_log_record *) calloc(size, sizeof(vidc_log_record));
+  if (!records)
+    return false;
+  s_num_records = size;
+  __sync_synchronize();
+  s_records = records;
+  return true;
+}
+
+/* Returns false if the site already used up its budget for this second */
+static bool log_admit(vidc_log_site *site, OMX_U64 now_us)
+{
+  OMX_U32 now_ms, suppressed;
+
+  if (site->level == VIDC_LOG_ERROR || !s_rate_limit)
+    return true;
+  now_ms = (OMX_U32) (now_us / 1000);
+  if (now_ms - site->window_ms >= 1000)
+  {
+    suppressed = site->suppressed;
+    site->window_ms = now_ms;
+    site->count = 0;
+    site->suppressed = 0;
+    if (suppressed)
+      log_printf(site->tag, "%u messages suppressed: %.40s",
+                 suppressed, site->fmt);
+  }
+  if (++site->count > s_rate_limit)
+  {
+    site->suppressed++;
+    return false;
+  }
+  return true;
+}
+
+/*
+ * Walks the printf conversions of fmt. Returns the position after the
+ * next conversion that consumes an argument, or NULL at the end, and
+ * stores the argument type and the conversion's start.
+ */
+static const char *log_next_conv(const char *fmt, int *type,
+                                 const char **start)
+{
+  int longs;
+  while (*fmt)
+  {
+    if (*fmt++ != '%')
+      continue;
+    if (*fmt == '%')
+    {
+      fmt++;
+      continue;
+    }
+    *start = fmt - 1;
+    while (*fmt && strchr("-+ #0123456789.", *fmt))
+      fmt++;
+    longs = 0;
+    while (*fmt && strchr("hlLqjzt", *fmt))
+    {
+      if (*fmt == 'l' || *fmt == 'L' || *fmt == 'q' || *fmt == 'j')
+        longs += (*fmt == 'l') ? 1 : 2;
+      else if (*fmt == 'z' || *fmt == 't')
+        longs = 1;
+      fmt++;
+    }
+    switch (*fmt)
+    {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      *type = longs >= 2 ? VIDC_LOG_ARG_LLONG :
+              longs ? VIDC_LOG_ARG_LONG : VIDC_LOG_ARG_INT;
+      break;
+    case 'p':
+      *type = VIDC_LOG_ARG_PTR;
+      break;
+    case 's':
+      *type = VIDC_LOG_ARG_STR;
+      break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+    case 'a': case 'A':
+      *type = VIDC_LOG_ARG_DOUBLE;
+      break;
+    default:
+      // '*' widths and %n are not used by the component logs
+      return NULL;
+    }
+    return fmt + 1;
+  }
+  return NULL;
+}
+
+static void log_parse_site(vidc_log_site *site)
+{
+  const char *fmt = site->fmt, *start;
+  int type, nargs = 0;
+  while (nargs < VIDC_LOG_MAX_ARGS &&
+         (fmt = log_next_conv(fmt, &type, &start)) != NULL)
+    site->types[nargs++] = (OMX_U8) type;
+  site->nargs = nargs;
+}
+
+static void log_record(vidc_log_site *site, OMX_U64 now_us, va_list args)
+{
+  vidc_log_record *rec;
+  OMX_U32 seq;
+  int i;
+
+  if (site->nargs < 0)
+    log_parse_site(site);
+  seq = __sync_fetch_and_add(&s_head, 1);
+  rec = &s_records[seq & (s_num_records - 1)];
+  rec->seq = 0;
+  __sync_synchronize();
+  rec->site = site;
+  rec->tid = (OMX_U32) syscall(SYS_gettid);
+  rec->time_us = now_us;
+  for (i = 0; i < site->nargs; i++)
+  {
+    switch (site->types[i])
+    {
+    case VIDC_LOG_ARG_INT:
+      rec->args[i] = (OMX_U32) va_arg(args, int);
+      break;
+    case VIDC_LOG_ARG_LONG:
+      rec->args[i] = (unsigned long) va_arg(args, long);
+      break;
+    case VIDC_LOG_ARG_LLONG:
+      rec->args[i] = (OMX_U64) va_arg(args, long long);
+      break;
+    case VIDC_LOG_ARG_DOUBLE:
+      {
+        double value = va_arg(args, double);
+        memcpy(&rec->args[i], &value, sizeof(value));
+      }
+      break;
+    default:
+      rec->args[i] = (unsigned long) va_arg(args, void *);
+      break;
+    }
+  }
+  __sync_synchronize();
+  rec->seq = seq + 1;
+}
+
+void vidc_log_emit(vidc_log_site *site, ...)
+{
+  va_list args;
+  OMX_U64 now_us = log_now_us();
+
+  if (!log_admit(site, now_us))
+    return;
+  va_start(args, site);
+  if (s_records)
+    log_record(site, now_us, args);
+  else
+    log_print(site->tag, site->fmt, args);
+  va_end(args);
+}
+
+/* Writes len bytes of format text, collapsing "%%" */
+static void log_literal(FILE *fp, const char *text, size_t len)
+{
+  size_t i;
+  for (i = 0; i < len; i++)
+  {
+    fputc(text[i], fp);
+    if (text[i] == '%' && i + 1 < len && text[i + 1] == '%')
+      i++;
+  }
+}
+
+/* Formats one record from its site's format, one conversion at a time */
+static void log_format(FILE *fp, const vidc_log_record *rec)
+{
+  const vidc_log_site *site = rec->site;
+  const char *fmt = site->fmt, *next, *start;
+  char spec[32];
+  int type, i = 0;
+  size_t len;
+
+  fprintf(fp, "%llu.%06llu %08x %s: ",
+          (unsigned long long) (rec->time_us / 1000000),
+          (unsigned long long) (rec->time_us % 1000000), rec->tid, site->tag);
+  while (i < site->nargs && (next = log_next_conv(fmt, &type, &start)))
+  {
+    log_literal(fp, fmt, start - fmt);
+    len = next - start;
+    if (len >= sizeof(spec))
+      len = sizeof(spec) - 1;
+    memcpy(spec, start, len);
+    spec[len] = 0;
+    switch (type)
+    {
+    case VIDC_LOG_ARG_INT:
+      fprintf(fp, spec, (int) rec->args[i]);
+      break;
+    case VIDC_LOG_ARG_LONG:
+      fprintf(fp, spec, (long) rec->args[i]);
+      break;
+    case VIDC_LOG_ARG_LLONG:
+      fprintf(fp, spec, (long long) rec->args[i]);
+      break;
+    case VIDC_LOG_ARG_DOUBLE:
+      {
+        double value;
+        memcpy(&value, &rec->args[i], sizeof(value));
+        fprintf(fp, spec, value);
+      }
+      break;
+    case VIDC_LOG_ARG_STR:
+      // Only the pointer was kept; the string may be gone by now
+      fprintf(fp, "<str %p>", (void *) (unsigned long) rec->args[i]);
+      break;
+    default:
+      fprintf(fp, "%p", (void *) (unsigned long) rec->args[i]);
+      break;
+    }
+    fmt = next;
+    i++;
+  }
+  log_literal(fp, fmt, strlen(fmt));
+  len = strlen(site->fmt);
+  if (!len || site->fmt[len - 1] != '\n')
+    fputc('\n', fp);
+}
+
+/*
+ * Joins a client supplied file name to VIDC_DEBUG_DIR. Names holding a
+ * '/' or starting with '.' are refused, so a client can not reach files
+ * outside that directory.
+ */
+bool vidc_debug_path(char *path, OMX_U32 size, const char *name)
+{
+  if (!name || !name[0] || name[0] == '.' || strchr(name, '/'))
+    return false;
+  return snprintf(path, size, "%s%s", VIDC_DEBUG_DIR, name) < (int) size;
+}
+
+int vidc_log_dump(const char *path)
+{
+  vidc_log_record rec;
+  OMX_U32 head, first, seq;
+  FILE *fp;
+  int count = 0;
+
+  if (!s_records || !path || !path[0])
+    return -1;
+  fp = fopen(path, "a");
+  if (!fp)
+    return -1;
+  head = s_head;
+  first = head > s_num_records ? head - s_num_records : 0;
+  for (seq = first; seq != head; seq++)
+  {
+    const vidc_log_record *slot = &s_records[seq & (s_num_records - 1)];
+    if (slot->seq != seq + 1)
+      continue;
+    memcpy(&rec, (const void *) slot, sizeof(rec));
+    __sync_synchronize();
+    // Skip slots reused while they were copied
+    if (slot->seq != seq + 1)
+      continue;
+    log_format(fp, &rec);
+    count++;
+  }
+  fclose(fp);
+  return count;
+}
+
+void vidc_log_flush()
+{
+  if (s_records && s_dump_file[0])
+    vidc_log_dump(s_dump_file);
+}
@@ -0,0 +1,237 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "vidc_record.h"
+#include "vidc_log.h"
+#ifdef _ANDROID_
+extern "C"{
+#include <utils/Log.h>
+}
+#endif
+
+static OMX_U64 record_now_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+vidc_recorder::vidc_recorder() :
+  m_enabled(false),
+  m_start_us(0),
+  m_seq(0),
+  m_client_data(NULL)
+{
+  memset((void *) m_seen, 0, sizeof(m_seen));
+  memset(&m_client_cb, 0, sizeof(m_client_cb));
+  pthread_mutex_init(&m_lock, NULL);
+}
+
+vidc_recorder::~vidc_recorder()
+{
+  close();
+  pthread_mutex_destroy(&m_lock);
+}
+
+bool vidc_recorder::open(const char *path, const char *component,
+                         OMX_U32 ring_bytes)
+{
+  vidc_record_file header;
+
+  if (m_enabled)
+    return false;
+  if (!ring_bytes)
+    ring_bytes = VIDC_RECORD_DEFAULT_RING;
+  if (!m_dump.open(path, ring_bytes, false, true))
+    return false;
+  memset(&header, 0, sizeof(header));
+  header.magic = VIDC_RECORD_MAGIC;
+  header.version = VIDC_RECORD_VERSION;
+  header.entry_size = sizeof(vidc_record_entry);
+  if (component)
+    strlcpy(header.component, component, sizeof(header.component));
+  if (!m_dump.begin(sizeof(header)))
+  {
+    m_dump.close();
+    return false;
+  }
+  m_dump.append(&header, sizeof(header));
+  m_dump.commit();
+  m_start_us = record_now_us();
+  m_seq = 0;
+  memset((void *) m_seen, 0, sizeof(m_seen));
+  m_enabled = true;
+  DEBUG_PRINT_HIGH("vidc_recorder: recording %s to %s", header.component,
+                   path);
+  return true;
+}
+
+void vidc_recorder::close()
+{
+  if (!m_enabled)
+    return;
+  pthread_mutex_lock(&m_lock);
+  m_enabled = false;
+  pthread_mutex_unlock(&m_lock);
+  DEBUG_PRINT_HIGH("vidc_recorder: %lu records", m_seq);
+  m_dump.close();
+}
+
+/*
+ * Swaps the client callback table for one that records each callback
+ * before passing it on. Called from set_callbacks; the wrapped table
+ * stays valid for the life of the recorder.
+ */
+void vidc_recorder::wrap_callbacks(OMX_CALLBACKTYPE *callbacks,
+                                   OMX_PTR *app_data)
+{
+  if (!m_enabled || !callbacks || !app_data)
+    return;
+  m_client_cb = *callbacks;
+  m_client_data = *app_data;
+  callbacks->EventHandler = event_handler;
+  callbacks->EmptyBufferDone = empty_buffer_done;
+  callbacks->FillBufferDone = fill_buffer_done;
+  *app_data = this;
+}
+
+void vidc_recorder::parameter(VIDC_RECORD_TYPE type, OMX_INDEXTYPE index,
+                              OMX_PTR data)
+{
+  OMX_U32 len = 0;
+
+  if (!m_enabled)
+    return;
+  // Every OMX structure starts with nSize
+  if (data)
+  {
+    len = *(OMX_U32 *) data;
+    if (len > VIDC_RECORD_PARAM_MAX)
+      len = VIDC_RECORD_PARAM_MAX;
+  }
+  add(type, NULL, 0, index, 0, data, len);
+}
+
+void vidc_recorder::etb(OMX_BUFFERHEADERTYPE *buffer)
+{
+  if (!m_enabled || !buffer)
+    return;
+  if (buffer->pBuffer && buffer->nFilledLen)
+    add(VIDC_RECORD_ETB, buffer, buffer->nInputPortIndex, 0, 0,
+        buffer->pBuffer + buffer->nOffset, buffer->nFilledLen);
+  else
+    add(VIDC_RECORD_ETB, buffer, buffer->nInputPortIndex, 0, 0, NULL, 0);
+}
+
+void vidc_recorder::add(VIDC_RECORD_TYPE type, OMX_BUFFERHEADERTYPE *buffer,
+                        OMX_U32 port, OMX_U32 param1, OMX_U32 param2,
+                        const void *payload, OMX_U32 payload_len)
+{
+  vidc_record_entry entry;
+  int i;
+
+  memset(&entry, 0, sizeof(entry));
+  entry.type = type;
+  entry.tid = (uint32_t) syscall(SYS_gettid);
+  entry.port = port;
+  entry.param1 = param1;
+  entry.param2 = param2;
+  entry.payload_len = payload ? payload_len : 0;
+  if (buffer)
+  {
+    entry.buffer = (uint64_t) (unsigned long) buffer;
+    entry.offset = buffer->nOffset;
+    entry.filled_len = buffer->nFilledLen;
+    entry.alloc_len = buffer->nAllocLen;
+    entry.flags = buffer->nFlags;
+    entry.timestamp = buffer->nTimeStamp;
+  }
+  pthread_mutex_lock(&m_lock);
+  if (m_enabled)
+  {
+    entry.seq = m_seq++;
+    entry.time_us = record_now_us() - m_start_us;
+    for (i = 0; i < VIDC_RECORD_CB_MAX; i++)
+      entry.seen[i] = m_seen[i];
+    // Callbacks count themselves only once their own record is taken
+    if (type == VIDC_RECORD_EVENT)
+      m_seen[VIDC_RECORD_CB_EVENT]++;
+    else if (type == VIDC_RECORD_EBD)
+      m_seen[VIDC_RECORD_CB_EBD]++;
+    else if (type == VIDC_RECORD_FBD)
+      m_seen[VIDC_RECORD_CB_FBD]++;
+    if (m_dump.sample(false) &&
+        m_dump.begin(sizeof(entry) + entry.payload_len))
+    {
+      m_dump.append(&entry, sizeof(entry));
+      if (entry.payload_len)
+        m_dump.append(payload, entry.payload_len);
+      m_dump.commit();
+    }
+  }
+  pthread_mutex_unlock(&m_lock);
+}
+
+OMX_ERRORTYPE vidc_recorder::event_handler(OMX_HANDLETYPE comp,
+                                           OMX_PTR app_data,
+                                           OMX_EVENTTYPE event, OMX_U32 data1,
+                                           OMX_U32 data2, OMX_PTR event_data)
+{
+  vidc_recorder *rec = (vidc_recorder *) app_data;
+
+  rec->add(VIDC_RECORD_EVENT, NULL, event, data1, data2, NULL, 0);
+  return rec->m_client_cb.EventHandler(comp, rec->m_client_data, event,
+                                       data1, data2, event_data);
+}
+
+OMX_ERRORTYPE vidc_recorder::empty_buffer_done(OMX_HANDLETYPE comp,
+                                               OMX_PTR app_data,
+                                               OMX_BUFFERHEADERTYPE *buffer)
+{
+  vidc_recorder *rec = (vidc_recorder *) app_data;
+
+  rec->add(VIDC_RECORD_EBD, buffer, buffer ? buffer->nInputPortIndex : 0,
+           0, 0, NULL, 0);
+  return rec->m_client_cb.EmptyBufferDone(comp, rec->m_client_data, buffer);
+}
+
+OMX_ERRORTYPE vidc_recorder::fill_buffer_done(OMX_HANDLETYPE comp,
+                                              OMX_PTR app_data,
+                                              OMX_BUFFERHEADERTYPE *buffer)
+{
+  vidc_recorder *rec = (vidc_recorder *) app_data;
+
+  rec->add(VIDC_RECORD_FBD, buffer, buffer ? buffer->nOutputPortIndex : 0,
+           0, 0, NULL, 0);
+  return rec->m_client_cb.FillBufferDone(comp, rec->m_client_data, buffer);
+}
@@ -0,0 +1,1092 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#ifdef __NR_perf_event_open
+#include <linux/perf_event.h>
+#define VIDC_PERF_EVENTS
+#endif
+#include "vidc_stats.h"
+#include "vidc_log.h"
+#ifdef _ANDROID_
+extern "C"{
+#include <utils/Log.h>
+}
+#endif
+
+pthread_mutex_t vidc_mem_stats::s_lock = PTHREAD_MUTEX_INITIALIZER;
+QOMX_VIDEO_MEMUSAGE vidc_mem_stats::s_usage[QOMX_VIDEO_MEM_MAX];
+QOMX_VIDEO_MEMUSAGE vidc_mem_stats::s_total;
+OMX_U32 vidc_mem_stats::s_sessions = 0;
+
+vidc_mem_stats::vidc_mem_stats()
+{
+  memset(m_usage, 0, sizeof(m_usage));
+  memset(&m_total, 0, sizeof(m_total));
+  pthread_mutex_lock(&s_lock);
+  s_sessions++;
+  pthread_mutex_unlock(&s_lock);
+}
+
+vidc_mem_stats::~vidc_mem_stats()
+{
+  int i;
+  // Drop whatever the session still holds from the aggregate
+  pthread_mutex_lock(&s_lock);
+  for (i = 0; i < QOMX_VIDEO_MEM_MAX; i++)
+  {
+    sub(&s_usage[i].nAllocatedBytes, m_usage[i].nAllocatedBytes);
+    sub(&s_usage[i].nMappedBytes, m_usage[i].nMappedBytes);
+  }
+  sub(&s_total.nAllocatedBytes, m_total.nAllocatedBytes);
+  sub(&s_total.nMappedBytes, m_total.nMappedBytes);
+  s_sessions--;
+  pthread_mutex_unlock(&s_lock);
+}
+
+void vidc_mem_stats::add(QOMX_VIDEO_MEMUSAGE *usage, OMX_U64 *field, OMX_U32 bytes)
+{
+  *field += bytes;
+  if (usage->nAllocatedBytes > usage->nPeakBytes)
+    usage->nPeakBytes = usage->nAllocatedBytes;
+}
+
+void vidc_mem_stats::sub(OMX_U64 *field, OMX_U32 bytes)
+{
+  *field = (*field > bytes) ? (*field - bytes) : 0;
+}
+
+void vidc_mem_stats::allocated(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes)
+{
+  if (category >= QOMX_VIDEO_MEM_MAX)
+    return;
+  pthread_mutex_lock(&s_lock);
+  add(&m_usage[category], &m_usage[category].nAllocatedBytes, bytes);
+  add(&m_total, &m_total.nAllocatedBytes, bytes);
+  add(&s_usage[category], &s_usage[category].nAllocatedBytes, bytes);
+  add(&s_total, &s_total.nAllocatedBytes, bytes);
+  pthread_mutex_unlock(&s_lock);
+}
+
+void vidc_mem_stats::released(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes)
+{
+  if (category >= QOMX_VIDEO_MEM_MAX)
+    return;
+  pthread_mutex_lock(&s_lock);
+  sub(&m_usage[category].nAllocatedBytes, bytes);
+  sub(&m_total.nAllocatedBytes, bytes);
+  sub(&s_usage[category].nAllocatedBytes, bytes);
+  sub(&s_total.nAllocatedBytes, bytes);
+  pthread_mutex_unlock(&s_lock);
+}
+
+void vidc_mem_stats::mapped(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes)
+{
+  if (category >= QOMX_VIDEO_MEM_MAX)
+    return;
+  pthread_mutex_lock(&s_lock);
+  add(&m_usage[category], &m_usage[category].nMappedBytes, bytes);
+  add(&m_total, &m_total.nMappedBytes, bytes);
+  add(&s_usage[category], &s_usage[category].nMappedBytes, bytes);
+  add(&s_total, &s_total.nMappedBytes, bytes);
+  pthread_mutex_unlock(&s_lock);
+}
+
+void vidc_mem_stats::unmapped(QOMX_VIDEO_MEMCATEGORY category, OMX_U32 bytes)
+{
+  if (category >= QOMX_VIDEO_MEM_MAX)
+    return;
+  pthread_mutex_lock(&s_lock);
+  sub(&m_usage[category].nMappedBytes, bytes);
+  sub(&m_total.nMappedBytes, bytes);
+  sub(&s_usage[category].nMappedBytes, bytes);
+  sub(&s_total.nMappedBytes, bytes);
+  pthread_mutex_unlock(&s_lock);
+}
+
+void vidc_mem_stats::fill(QOMX_VIDEO_MEMORY_STATS *stats,
+                          const QOMX_VIDEO_MEMUSAGE *usage,
+                          const QOMX_VIDEO_MEMUSAGE *total,
+                          OMX_U32 sessions)
+{
+  stats->nSessions = sessions;
+  memcpy(stats->sUsage, usage, sizeof(stats->sUsage));
+  memcpy(&stats->sTotal, total, sizeof(stats->sTotal));
+  stats->nPoolRetainedBytes = 0;
+  stats->nPoolRetainedBuffers = 0;
+  stats->nPoolHits = 0;
+  stats->nPoolMisses = 0;
+}
+
+OMX_ERRORTYPE vidc_mem_stats::get_stats(QOMX_VIDEO_MEMORY_STATS *stats)
+{
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  if (stats->nPortIndex == OMX_ALL)
+  {
+    get_process_stats(stats);
+    return OMX_ErrorNone;
+  }
+  pthread_mutex_lock(&s_lock);
+  fill(stats, m_usage, &m_total, 1);
+  pthread_mutex_unlock(&s_lock);
+  return OMX_ErrorNone;
+}
+
+void vidc_mem_stats::get_process_stats(QOMX_VIDEO_MEMORY_STATS *stats)
+{
+  if (!stats)
+    return;
+  pthread_mutex_lock(&s_lock);
+  fill(stats, s_usage, &s_total, s_sessions);
+  pthread_mutex_unlock(&s_lock);
+}
+
+vidc_live_stats::vidc_live_stats():
+  m_inputs(0),
+  m_frames(0),
+  m_dropped(0),
+  m_input_flushes(0),
+  m_output_flushes(0)
+{
+  memset((void *) m_hist, 0, sizeof(m_hist));
+  memset(m_high_water, 0, sizeof(m_high_water));
+  memset((void *) m_slots, 0, sizeof(m_slots));
+  pthread_mutex_init(&m_read_lock, NULL);
+  m_start_us = now_us();
+  take_snapshot(&m_base, m_start_us);
+  m_prev = m_base;
+}
+
+vidc_live_stats::~vidc_live_stats()
+{
+  pthread_mutex_destroy(&m_read_lock);
+}
+
+OMX_U64 vidc_live_stats::now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Four buckets per power of two: 0-3 are exact, then [4,5), [5,6), ... */
+OMX_U32 vidc_live_stats::bucket(OMX_U32 value)
+{
+  OMX_U32 msb;
+  if (value < 4)
+    return value;
+  msb = 31 - __builtin_clz(value);
+  return (msb << 2) + ((value >> (msb - 2)) & 3) - 4;
+}
+
+/* Largest value that still falls in bucket index */
+OMX_U32 vidc_live_stats::bucket_limit(OMX_U32 index)
+{
+  OMX_U32 msb, sub;
+  if (index < 3)
+    return index;
+  index++;
+  msb = (index >> 2) + 1;
+  sub = index & 3;
+  if (msb > 31)
+    return 0xFFFFFFFF;
+  return ((4 + sub) << (msb - 2)) - 1;
+}
+
+OMX_U32 vidc_live_stats::slot_index(OMX_S64 timestamp)
+{
+  return (OMX_U32) (((OMX_U64) timestamp * 0x9E3779B97F4A7C15ULL) >> 32) &
+         (VIDC_LIVE_STATS_SLOTS - 1);
+}
+
+void vidc_live_stats::input_queued(OMX_S64 timestamp)
+{
+  latency_slot *slot = &m_slots[slot_index(timestamp)];
+  OMX_U32 now = (OMX_U32) now_us();
+
+  __sync_fetch_and_add(&m_inputs, 1);
+  // Retire the old entry before the key changes so a concurrent
+  // output_done() can not pair the new key with the old time
+  slot->time_us = 0;
+  __sync_synchronize();
+  slot->timestamp = timestamp;
+  __sync_synchronize();
+  slot->time_us = now ? now : 1;
+}
+
+void vidc_live_stats::output_done(OMX_S64 timestamp, OMX_U32 filled_len)
+{
+  latency_slot *slot = &m_slots[slot_index(timestamp)];
+  OMX_U32 start;
+
+  if (!filled_len)
+    return;
+  __sync_fetch_and_add(&m_frames, 1);
+  start = slot->time_us;
+  __sync_synchronize();
+  if (!start || slot->timestamp != timestamp)
+    return;
+  // Claim the sample; fails if the slot was reused or already counted
+  if (__sync_bool_compare_and_swap(&slot->time_us, start, 0))
+    __sync_fetch_and_add(&m_hist[bucket((OMX_U32) now_us() - start)], 1);
+}
+
+void vidc_live_stats::take_snapshot(snapshot *snap, OMX_U64 time_us)
+{
+  int i;
+  snap->time_us = time_us;
+  snap->frames = m_frames;
+  for (i = 0; i < VIDC_LIVE_STATS_BUCKETS; i++)
+    snap->hist[i] = m_hist[i];
+}
+
+OMX_ERRORTYPE vidc_live_stats::get_stats(QOMX_VIDEO_LIVE_STATS *stats)
+{
+  snapshot cur;
+  OMX_U32 hist[VIDC_LIVE_STATS_BUCKETS];
+  OMX_U32 samples = 0, seen = 0, window_us, frames;
+  OMX_U32 p50, p95, p99;
+  int i;
+
+  if (!stats)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_read_lock);
+  take_snapshot(&cur, now_us());
+  if (cur.time_us - m_base.time_us >= VIDC_LIVE_STATS_WINDOW_MS * 1000)
+  {
+    m_prev = m_base;
+    m_base = cur;
+  }
+  window_us = (OMX_U32) (cur.time_us - m_prev.time_us);
+  frames = cur.frames - m_prev.frames;
+  for (i = 0; i < VIDC_LIVE_STATS_BUCKETS; i++)
+  {
+    hist[i] = cur.hist[i] - m_prev.hist[i];
+    samples += hist[i];
+  }
+  pthread_mutex_unlock(&m_read_lock);
+
+  stats->nWindowMs = window_us / 1000;
+  stats->nFrameRateQ16 = window_us ?
+    (OMX_U32) (((OMX_U64) frames * 1000000 << 16) / window_us) : 0;
+  stats->nLatencyP50Us = stats->nLatencyP95Us = 0;
+  stats->nLatencyP99Us = stats->nLatencyMaxUs = 0;
+  stats->nLatencySamples = samples;
+  // Rank of each percentile, rounded up so p99 of 10 samples is the max
+  p50 = (samples * 50 + 99) / 100;
+  p95 = (samples * 95 + 99) / 100;
+  p99 = (samples * 99 + 99) / 100;
+  for (i = 0; i < VIDC_LIVE_STATS_BUCKETS && samples; i++)
+  {
+    if (!hist[i])
+      continue;
+    seen += hist[i];
+    if (!stats->nLatencyP50Us && seen >= p50)
+      stats->nLatencyP50Us = bucket_limit(i);
+    if (!stats->nLatencyP95Us && seen >= p95)
+      stats->nLatencyP95Us = bucket_limit(i);
+    if (!stats->nLatencyP99Us && seen >= p99)
+      stats->nLatencyP99Us = bucket_limit(i);
+    stats->nLatencyMaxUs = bucket_limit(i);
+  }
+  stats->nUptimeMs = (cur.time_us - m_start_us) / 1000;
+  stats->nInputBuffers = m_inputs;
+  stats->nOutputFrames = cur.frames;
+  stats->nDroppedFrames = m_dropped;
+  stats->nInputFlushes = m_input_flushes;
+  stats->nOutputFlushes = m_output_flushes;
+  for (i = 0; i < QOMX_VIDEO_QUEUE_MAX; i++)
+    stats->sQueue[i].nHighWater = m_high_water[i];
+  return OMX_ErrorNone;
+}
+
+vidc_mutex::vidc_mutex():
+  m_instrumented(false),
+  m_owner(NULL),
+  m_acquired_us(0),
+  m_num_sites(0)
+{
+  memset(m_sites, 0, sizeof(m_sites));
+  memset(&m_other, 0, sizeof(m_other));
+  pthread_mutex_init(&m_mutex, NULL);
+}
+
+vidc_mutex::~vidc_mutex()
+{
+  pthread_mutex_destroy(&m_mutex);
+}
+
+OMX_U64 vidc_mutex::now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* Called with m_mutex held */
+vidc_mutex::site_stats *vidc_mutex::find(const vidc_lock_site *site)
+{
+  OMX_U32 i;
+  for (i = 0; i < m_num_sites; i++)
+    if (m_sites[i].site == site)
+      return &m_sites[i];
+  if (m_num_sites == VIDC_MUTEX_MAX_SITES)
+    return &m_other;
+  m_sites[i].site = site;
+  // The entry is complete before get_stats() can see it
+  __sync_synchronize();
+  m_num_sites++;
+  return &m_sites[i];
+}
+
+void vidc_mutex::lock_timed(const vidc_lock_site *site)
+{
+  const vidc_lock_site *holder = NULL;
+  OMX_U64 start_us = 0;
+  bool contended = false;
+  site_stats *stats;
+
+  if (pthread_mutex_trylock(&m_mutex))
+  {
+    contended = true;
+    holder = m_owner;
+    start_us = now_us();
+    pthread_mutex_lock(&m_mutex);
+  }
+  m_acquired_us = now_us();
+  m_owner = site;
+  stats = find(site);
+  stats->acquired++;
+  if (contended)
+  {
+    stats->contended++;
+    stats->wait_us += m_acquired_us - start_us;
+    if (holder)
+      find(holder)->blocking_us += m_acquired_us - start_us;
+  }
+}
+
+void vidc_mutex::unlock_timed()
+{
+  OMX_U32 hold_us;
+  site_stats *stats;
+
+  if (m_owner)
+  {
+    hold_us = (OMX_U32) (now_us() - m_acquired_us);
+    stats = find(m_owner);
+    stats->hold_us += hold_us;
+    if (hold_us > stats->hold_max_us)
+      stats->hold_max_us = hold_us;
+    m_owner = NULL;
+  }
+  pthread_mutex_unlock(&m_mutex);
+}
+
+/*
+ * Reads the counters without taking the mutex, so it can be called from
+ * a callback that runs under it; a concurrent update may be half seen.
+ */
+OMX_ERRORTYPE vidc_mutex::get_stats(QOMX_VIDEO_LOCK_STATS *stats)
+{
+  site_stats sites[VIDC_MUTEX_MAX_SITES + 1];
+  OMX_U32 count = m_num_sites, i, j;
+
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  memset(&stats->bEnabled, 0,
+         sizeof(*stats) - offsetof(QOMX_VIDEO_LOCK_STATS, bEnabled));
+  stats->bEnabled = m_instrumented ? OMX_TRUE : OMX_FALSE;
+  memcpy(sites, m_sites, count * sizeof(site_stats));
+  if (m_other.acquired)
+    sites[count++] = m_other;
+  for (i = 0; i < count; i++)
+  {
+    stats->nAcquired += sites[i].acquired;
+    stats->nContended += sites[i].contended;
+    stats->nWaitUs += sites[i].wait_us;
+    stats->nHoldUs += sites[i].hold_us;
+  }
+  // Partial selection sort, only the top entries are reported
+  for (i = 0; i < count && i < QOMX_VIDEO_LOCK_SITES; i++)
+  {
+    QOMX_VIDEO_LOCK_SITE *out = &stats->sSite[i];
+    OMX_U32 best = i;
+    for (j = i + 1; j < count; j++)
+      if (sites[j].wait_us + sites[j].blocking_us >
+          sites[best].wait_us + sites[best].blocking_us)
+        best = j;
+    if (best != i)
+    {
+      site_stats tmp = sites[i];
+      sites[i] = sites[best];
+      sites[best] = tmp;
+    }
+    if (sites[i].site)
+      snprintf((char *) out->cName, sizeof(out->cName), "%s:%d",
+               sites[i].site->func, sites[i].site->line);
+    else
+      strlcpy((char *) out->cName, "other", sizeof(out->cName));
+    out->nAcquired = sites[i].acquired;
+    out->nContended = sites[i].contended;
+    out->nWaitUs = sites[i].wait_us;
+    out->nHoldUs = sites[i].hold_us;
+    out->nHoldMaxUs = sites[i].hold_max_us;
+    out->nBlockingUs = sites[i].blocking_us;
+  }
+  stats->nSites = i;
+  return OMX_ErrorNone;
+}
+
+void vidc_mutex::report(const char *name)
+{
+  QOMX_VIDEO_LOCK_STATS stats;
+  OMX_U32 i;
+
+  if (!m_instrumented)
+    return;
+  get_stats(&stats);
+  DEBUG_PRINT_HIGH("%s lock: %lu acquired, %lu contended, wait %llu us, "
+                   "held %llu us", name, stats.nAcquired, stats.nContended,
+                   stats.nWaitUs, stats.nHoldUs);
+  for (i = 0; i < stats.nSites; i++)
+  {
+    QOMX_VIDEO_LOCK_SITE *site = &stats.sSite[i];
+    DEBUG_PRINT_HIGH("  %s: %lu acquired, %lu contended, wait %llu us, "
+                     "held %llu us (max %lu), blocked others %llu us",
+                     site->cName, site->nAcquired, site->nContended,
+                     site->nWaitUs, site->nHoldUs, site->nHoldMaxUs,
+                     site->nBlockingUs);
+  }
+}
+
+#ifdef VIDC_PERF_EVENTS
+static const OMX_U64 perf_config[QOMX_VIDEO_PERF_COUNTER_MAX] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES,
+};
+#endif
+
+/* Opens one counter of the calling thread, -1 with errno set on failure */
+static int perf_open(int counter, int group_fd, bool user_only)
+{
+#ifdef VIDC_PERF_EVENTS
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = perf_config[counter];
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.exclude_kernel = user_only;
+  attr.exclude_hv = user_only;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+vidc_perf::vidc_perf() :
+  m_enabled(false),
+  m_probed(false),
+  m_available(false),
+  m_user_only(false),
+  m_mask(0),
+  m_generation(0),
+  m_num_threads(0),
+  m_frames(0)
+{
+  pthread_mutex_init(&m_lock, NULL);
+  memset(m_threads, 0, sizeof(m_threads));
+  memset(m_frame_base, 0, sizeof(m_frame_base));
+  memset(m_last_frame, 0, sizeof(m_last_frame));
+}
+
+vidc_perf::~vidc_perf()
+{
+  OMX_U32 i;
+
+  m_enabled = false;
+  for (i = 0; i < m_num_threads; i++)
+    close_group(&m_threads[i]);
+  pthread_mutex_destroy(&m_lock);
+}
+
+/*
+ * The first enable finds out which counters the kernel and the CPU
+ * offer, falling back to user-space only counting when kernel counting
+ * is not permitted. Counting restarts each stage stack on every enable
+ * but the totals carry on.
+ */
+bool vidc_perf::enable(bool enable)
+{
+  if (!enable)
+  {
+    m_enabled = false;
+    return true;
+  }
+  pthread_mutex_lock(&m_lock);
+  if (!m_probed)
+  {
+    thread_state probe;
+    int err = 0;
+    m_probed = true;
+    memset(&probe, 0, sizeof(probe));
+    m_mask = (1 << QOMX_VIDEO_PERF_COUNTER_MAX) - 1;
+    if (!open_group(&probe))
+    {
+      err = errno;
+      m_user_only = true;
+      if (!open_group(&probe))
+        err = errno;
+    }
+    m_mask = 0;
+    for (int c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+      if (probe.slot[c] >= 0 && probe.nr)
+        m_mask |= 1 << c;
+    close_group(&probe);
+    m_available = m_mask != 0;
+    if (m_available)
+      DEBUG_PRINT_HIGH("vidc_perf: counters 0x%lx%s", m_mask,
+                       m_user_only ? ", user space only" : "");
+    else
+      DEBUG_PRINT_HIGH("vidc_perf: perf events unavailable (%d)", err);
+  }
+  if (m_available && !m_enabled)
+  {
+    // Frames start from here rather than from the last time counted
+    sum(m_frame_base);
+    m_generation++;
+    m_enabled = true;
+  }
+  pthread_mutex_unlock(&m_lock);
+  return m_available;
+}
+
+/* Opens the counters in m_mask as one group, false if none opened */
+bool vidc_perf::open_group(thread_state *state)
+{
+  int leader = -1, c;
+
+  state->nr = 0;
+  for (c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+  {
+    state->fd[c] = -1;
+    state->slot[c] = -1;
+    if (!(m_mask & (1 << c)))
+      continue;
+    state->fd[c] = perf_open(c, leader, m_user_only);
+    if (state->fd[c] < 0)
+      continue;
+    if (leader < 0)
+      leader = state->fd[c];
+    state->slot[c] = state->nr++;
+  }
+  return state->nr != 0;
+}
+
+void vidc_perf::close_group(thread_state *state)
+{
+  for (int c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+    if (state->nr && state->fd[c] >= 0)
+      close(state->fd[c]);
+  state->nr = 0;
+}
+
+/* Group read layout: nr, time enabled, time running, one value per counter */
+bool vidc_perf::read_group(thread_state *state, OMX_U64 *values,
+                           OMX_U64 *times)
+{
+  OMX_U64 buf[3 + QOMX_VIDEO_PERF_COUNTER_MAX];
+  int leader = -1, c;
+
+  for (c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX && leader < 0; c++)
+    if (state->slot[c] == 0)
+      leader = state->fd[c];
+  if (leader < 0 ||
+      read(leader, buf, (3 + state->nr) * sizeof(OMX_U64)) <= 0)
+    return false;
+  times[0] = buf[1];
+  times[1] = buf[2];
+  for (c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+    values[c] = state->slot[c] >= 0 ? buf[3 + state->slot[c]] : 0;
+  return true;
+}
+
+/*
+ * Finds the counter group of the calling thread, opening one on the
+ * first visit. Only the owning thread adds its entry, so lookups need
+ * no lock; a thread whose group failed to open keeps an empty entry so
+ * it does not retry every frame.
+ */
+vidc_perf::thread_state *vidc_perf::current()
+{
+  pthread_t self = pthread_self();
+  thread_state *state;
+  OMX_U32 i, count = m_num_threads;
+
+  for (i = 0; i < count; i++)
+    if (pthread_equal(m_threads[i].thread, self))
+      return m_threads[i].nr ? &m_threads[i] : NULL;
+  pthread_mutex_lock(&m_lock);
+  count = m_num_threads;
+  if (count == VIDC_PERF_MAX_THREADS)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return NULL;
+  }
+  state = &m_threads[count];
+  memset(state, 0, sizeof(*state));
+  state->thread = self;
+  state->generation = m_generation - 1;
+  open_group(state);
+  __sync_synchronize();
+  m_num_threads = count + 1;
+  pthread_mutex_unlock(&m_lock);
+  return state->nr ? state : NULL;
+}
+
+/*
+ * Charges the counts since the last read to the innermost stage. If the
+ * group was only on the PMU part of the interval, the counts are scaled
+ * up to the whole interval.
+ */
+void vidc_perf::charge(thread_state *state, const OMX_U64 *values,
+                       const OMX_U64 *times)
+{
+  OMX_U32 depth = state->depth;
+  OMX_U64 enabled = times[0] - state->last_time[0];
+  OMX_U64 running = times[1] - state->last_time[1];
+  QOMX_VIDEO_PERF_COUNTS *totals;
+
+  if (depth > VIDC_PERF_MAX_DEPTH)
+    depth = VIDC_PERF_MAX_DEPTH;
+  totals = &state->totals[state->stack[depth - 1]];
+  for (int c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+  {
+    OMX_U64 delta = values[c] - state->last[c];
+    if (running && running < enabled)
+      delta = (OMX_U64) ((double) delta * enabled / running);
+    totals->nCount[c] += delta;
+  }
+  state->time_enabled += enabled;
+  state->time_running += running;
+}
+
+void vidc_perf::push(QOMX_VIDEO_PERF_STAGE stage)
+{
+  thread_state *state = current();
+  OMX_U64 values[QOMX_VIDEO_PERF_COUNTER_MAX], times[2];
+
+  if (!state || !read_group(state, values, times))
+    return;
+  if (state->generation != m_generation)
+  {
+    state->generation = m_generation;
+    state->depth = 0;
+  }
+  if (state->depth)
+    charge(state, values, times);
+  // Levels past the stack are charged to the deepest stage kept
+  if (state->depth < VIDC_PERF_MAX_DEPTH)
+  {
+    state->stack[state->depth] = stage;
+    state->totals[stage].nCalls++;
+  }
+  state->depth++;
+  memcpy(state->last, values, sizeof(values));
+  memcpy(state->last_time, times, sizeof(times));
+}
+
+void vidc_perf::pop()
+{
+  thread_state *state = current();
+  OMX_U64 values[QOMX_VIDEO_PERF_COUNTER_MAX], times[2];
+
+  // A stage begun before counting was (re)enabled is not charged
+  if (!state || state->generation != m_generation || !state->depth ||
+      !read_group(state, values, times))
+    return;
+  charge(state, values, times);
+  state->depth--;
+  memcpy(state->last, values, sizeof(values));
+  memcpy(state->last_time, times, sizeof(times));
+}
+
+/* Sums the per-thread totals, racing with the threads that own them */
+void vidc_perf::sum(QOMX_VIDEO_PERF_COUNTS *totals)
+{
+  OMX_U32 i, count = m_num_threads;
+
+  memset(totals, 0, sizeof(QOMX_VIDEO_PERF_COUNTS) * QOMX_VIDEO_PERF_STAGE_MAX);
+  for (i = 0; i < count; i++)
+    for (int s = 0; s < QOMX_VIDEO_PERF_STAGE_MAX; s++)
+    {
+      totals[s].nCalls += m_threads[i].totals[s].nCalls;
+      for (int c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+        totals[s].nCount[c] += m_threads[i].totals[s].nCount[c];
+    }
+}
+
+/* Share of the charged time the groups were on the PMU, 1000 if none yet */
+OMX_U32 vidc_perf::running_permille()
+{
+  OMX_U64 enabled = 0, running = 0;
+  OMX_U32 i, count = m_num_threads;
+
+  for (i = 0; i < count; i++)
+  {
+    enabled += m_threads[i].time_enabled;
+    running += m_threads[i].time_running;
+  }
+  if (!enabled || running >= enabled)
+    return 1000;
+  return (OMX_U32) (running * 1000 / enabled);
+}
+
+void vidc_perf::roll_frame()
+{
+  QOMX_VIDEO_PERF_COUNTS now[QOMX_VIDEO_PERF_STAGE_MAX];
+
+  pthread_mutex_lock(&m_lock);
+  sum(now);
+  for (int s = 0; s < QOMX_VIDEO_PERF_STAGE_MAX; s++)
+  {
+    m_last_frame[s].nCalls = now[s].nCalls - m_frame_base[s].nCalls;
+    for (int c = 0; c < QOMX_VIDEO_PERF_COUNTER_MAX; c++)
+      m_last_frame[s].nCount[c] = now[s].nCount[c] -
+                                  m_frame_base[s].nCount[c];
+  }
+  memcpy(m_frame_base, now, sizeof(now));
+  m_frames++;
+  pthread_mutex_unlock(&m_lock);
+}
+
+OMX_ERRORTYPE vidc_perf::get_stats(QOMX_VIDEO_PERF_STATS *stats)
+{
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  memset(&stats->bEnable, 0,
+         sizeof(*stats) - offsetof(QOMX_VIDEO_PERF_STATS, bEnable));
+  stats->bEnable = m_enabled ? OMX_TRUE : OMX_FALSE;
+  stats->nCounterMask = m_mask;
+  stats->bUserOnly = m_user_only ? OMX_TRUE : OMX_FALSE;
+  stats->nThreads = m_num_threads;
+  stats->nRunningPermille = running_permille();
+  sum(stats->sSession);
+  pthread_mutex_lock(&m_lock);
+  stats->nFrames = m_frames;
+  memcpy(stats->sLastFrame, m_last_frame, sizeof(m_last_frame));
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE vidc_perf::set_config(QOMX_VIDEO_PERF_STATS *stats)
+{
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  if (!enable(stats->bEnable == OMX_TRUE))
+    return OMX_ErrorUnsupportedSetting;
+  return OMX_ErrorNone;
+}
+
+void vidc_perf::report(const char *name)
+{
+  static const char *stage_names[QOMX_VIDEO_PERF_STAGE_MAX] = {
+    "parser", "event", "etb", "fbd"
+  };
+  QOMX_VIDEO_PERF_STATS stats;
+
+  if (!m_available || !m_num_threads)
+    return;
+  get_stats(&stats);
+  DEBUG_PRINT_HIGH("%s perf: %llu frames, %lu threads%s", name,
+                   stats.nFrames, stats.nThreads,
+                   stats.bUserOnly ? ", user space only" : "");
+  if (stats.nRunningPermille < 1000)
+    DEBUG_PRINT_HIGH("  counters multiplexed, on the PMU %lu.%lu%% of the "
+                     "time, counts are scaled estimates",
+                     stats.nRunningPermille / 10, stats.nRunningPermille % 10);
+  for (int s = 0; s < QOMX_VIDEO_PERF_STAGE_MAX; s++)
+  {
+    QOMX_VIDEO_PERF_COUNTS *counts = &stats.sSession[s];
+    if (!counts->nCalls)
+      continue;
+    DEBUG_PRINT_HIGH("  %s: %llu calls, %llu cycles, %llu instructions, "
+                     "%llu cache misses, %llu branch misses, "
+                     "%llu cycles/frame", stage_names[s], counts->nCalls,
+                     counts->nCount[QOMX_VIDEO_PERF_CYCLES],
+                     counts->nCount[QOMX_VIDEO_PERF_INSTRUCTIONS],
+                     counts->nCount[QOMX_VIDEO_PERF_CACHE_MISSES],
+                     counts->nCount[QOMX_VIDEO_PERF_BRANCH_MISSES],
+                     stats.nFrames ?
+                       counts->nCount[QOMX_VIDEO_PERF_CYCLES] / stats.nFrames :
+                       0ULL);
+  }
+}
+
+vidc_thread_stats::vidc_thread_stats()
+{
+  pthread_mutex_init(&m_lock, NULL);
+  memset(m_threads, 0, sizeof(m_threads));
+  m_start_us = clock_us(CLOCK_MONOTONIC);
+}
+
+vidc_thread_stats::~vidc_thread_stats()
+{
+  pthread_mutex_destroy(&m_lock);
+}
+
+OMX_U64 vidc_thread_stats::clock_us(clockid_t clock)
+{
+  struct timespec ts;
+  if (clock_gettime(clock, &ts))
+    return 0;
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void vidc_thread_stats::thread_start(QOMX_VIDEO_THREAD_ROLE role)
+{
+  thread_state *state = &m_threads[role];
+  char name[QOMX_VIDEO_THREAD_NAME_MAX + 1];
+
+  memset(name, 0, sizeof(name));
+  prctl(PR_GET_NAME, (unsigned long) name, 0, 0, 0);
+  pthread_mutex_lock(&m_lock);
+  strlcpy(state->name, name, sizeof(state->name));
+  if (pthread_getcpuclockid(pthread_self(), &state->clock))
+    state->clock = CLOCK_THREAD_CPUTIME_ID;
+  state->running = true;
+  pthread_mutex_unlock(&m_lock);
+}
+
+void vidc_thread_stats::thread_exit(QOMX_VIDEO_THREAD_ROLE role)
+{
+  thread_state *state = &m_threads[role];
+
+  // The per-thread clock is gone once the thread is, so latch it here
+  pthread_mutex_lock(&m_lock);
+  state->exited_us += clock_us(CLOCK_THREAD_CPUTIME_ID);
+  state->running = false;
+  pthread_mutex_unlock(&m_lock);
+}
+
+OMX_ERRORTYPE vidc_thread_stats::get_stats(QOMX_VIDEO_THREAD_STATS *stats)
+{
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  memset(&stats->nSessionUs, 0,
+         sizeof(*stats) - offsetof(QOMX_VIDEO_THREAD_STATS, nSessionUs));
+  stats->nSessionUs = clock_us(CLOCK_MONOTONIC) - m_start_us;
+  pthread_mutex_lock(&m_lock);
+  for (int r = 0; r < QOMX_VIDEO_THREAD_ROLE_MAX; r++)
+  {
+    thread_state *state = &m_threads[r];
+    QOMX_VIDEO_THREAD_USAGE *usage = &stats->sThread[r];
+    strlcpy((char *) usage->cName, state->name, sizeof(usage->cName));
+    usage->bRunning = state->running ? OMX_TRUE : OMX_FALSE;
+    usage->nCpuTimeUs = state->exited_us;
+    // The fallback clock would measure the caller, not the thread
+    if (state->running && state->clock != CLOCK_THREAD_CPUTIME_ID)
+      usage->nCpuTimeUs += clock_us(state->clock);
+    usage->nWakeups = state->wakeups;
+    stats->nCpuTimeUs += usage->nCpuTimeUs;
+  }
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+void vidc_thread_stats::report(const char *name)
+{
+  static const char *role_names[QOMX_VIDEO_THREAD_ROLE_MAX] = {
+    "message", "callback"
+  };
+  QOMX_VIDEO_THREAD_STATS stats;
+
+  get_stats(&stats);
+  DEBUG_PRINT_HIGH("%s threads: %llu us CPU in %llu us", name,
+                   stats.nCpuTimeUs, stats.nSessionUs);
+  for (int r = 0; r < QOMX_VIDEO_THREAD_ROLE_MAX; r++)
+  {
+    QOMX_VIDEO_THREAD_USAGE *usage = &stats.sThread[r];
+    if (!usage->cName[0])
+      continue;
+    DEBUG_PRINT_HIGH("  %s (%s): %llu us CPU, %llu wakeups, %llu us/wakeup",
+                     role_names[r], (char *) usage->cName, usage->nCpuTimeUs,
+                     usage->nWakeups, usage->nWakeups ?
+                       usage->nCpuTimeUs / usage->nWakeups : 0ULL);
+  }
+}
+
+vidc_startup_stats::vidc_startup_stats()
+{
+  pthread_mutex_init(&m_lock, NULL);
+  m_complete = false;
+  m_first_frame_us = 0;
+  memset(m_open, 0, sizeof(m_open));
+  memset((void *) m_ended, 0, sizeof(m_ended));
+  memset(m_phase, 0, sizeof(m_phase));
+  m_created_us = now_us();
+}
+
+vidc_startup_stats::~vidc_startup_stats()
+{
+  pthread_mutex_destroy(&m_lock);
+}
+
+OMX_U64 vidc_startup_stats::now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void vidc_startup_stats::begin(QOMX_VIDEO_STARTUP_PHASE phase)
+{
+  if (m_complete || m_ended[phase])
+    return;
+  pthread_mutex_lock(&m_lock);
+  if (!m_complete && !m_ended[phase])
+  {
+    m_phase[phase].nStartUs = now_us() - m_created_us;
+    m_open[phase] = true;
+  }
+  pthread_mutex_unlock(&m_lock);
+}
+
+bool vidc_startup_stats::end(QOMX_VIDEO_STARTUP_PHASE phase)
+{
+  bool ended = false;
+
+  if (m_complete || m_ended[phase])
+    return false;
+  pthread_mutex_lock(&m_lock);
+  if (!m_complete && m_open[phase] && !m_ended[phase])
+  {
+    m_phase[phase].nDurationUs = now_us() - m_created_us -
+                                 m_phase[phase].nStartUs;
+    m_phase[phase].nCount = 1;
+    m_open[phase] = false;
+    m_ended[phase] = ended = true;
+  }
+  pthread_mutex_unlock(&m_lock);
+  return ended;
+}
+
+void vidc_startup_stats::add(QOMX_VIDEO_STARTUP_PHASE phase, OMX_U64 start_us)
+{
+  OMX_U64 end_us;
+
+  if (m_complete)
+    return;
+  end_us = now_us();
+  pthread_mutex_lock(&m_lock);
+  if (!m_complete)
+  {
+    if (!m_phase[phase].nCount)
+      m_phase[phase].nStartUs = start_us - m_created_us;
+    m_phase[phase].nDurationUs += end_us - start_us;
+    m_phase[phase].nCount++;
+  }
+  pthread_mutex_unlock(&m_lock);
+}
+
+bool vidc_startup_stats::first_frame()
+{
+  if (m_complete)
+    return false;
+  end(QOMX_VIDEO_STARTUP_FIRST_FBD);
+  pthread_mutex_lock(&m_lock);
+  if (m_complete)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return false;
+  }
+  m_first_frame_us = now_us() - m_created_us;
+  for (int p = 0; p < QOMX_VIDEO_STARTUP_PHASE_MAX; p++)
+    if (m_open[p])
+      memset(&m_phase[p], 0, sizeof(m_phase[p]));
+  m_complete = true;
+  pthread_mutex_unlock(&m_lock);
+  return true;
+}
+
+OMX_ERRORTYPE vidc_startup_stats::get_stats(QOMX_VIDEO_STARTUP_STATS *stats)
+{
+  if (!stats)
+    return OMX_ErrorBadParameter;
+  memset(&stats->bComplete, 0,
+         sizeof(*stats) - offsetof(QOMX_VIDEO_STARTUP_STATS, bComplete));
+  pthread_mutex_lock(&m_lock);
+  stats->bComplete = m_complete ? OMX_TRUE : OMX_FALSE;
+  stats->nFirstFrameUs = m_first_frame_us;
+  memcpy(stats->sPhase, m_phase, sizeof(m_phase));
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+void vidc_startup_stats::report(const char *name)
+{
+  static const char *phase_names[QOMX_VIDEO_STARTUP_PHASE_MAX] = {
+    "device open", "device setup", "loaded->idle", "buffer alloc",
+    "idle->executing", "first etb", "header parse", "port reconfig",
+    "first fbd"
+  };
+  QOMX_VIDEO_STARTUP_STATS stats;
+
+  get_stats(&stats);
+  DEBUG_PRINT_HIGH("%s startup: first frame %s %llu us after creation", name,
+                   stats.bComplete ? "at" : "not yet,", stats.bComplete ?
+                     stats.nFirstFrameUs : now_us() - m_created_us);
+  for (int p = 0; p < QOMX_VIDEO_STARTUP_PHASE_MAX; p++)
+  {
+    QOMX_VIDEO_STARTUP_TIME *phase = &stats.sPhase[p];
+    if (!phase->nCount)
+      continue;
+    if (p == QOMX_VIDEO_STARTUP_BUFFER_ALLOC)
+      DEBUG_PRINT_HIGH("  %s: %llu us over %lu buffers from +%llu us",
+                       phase_names[p], phase->nDurationUs, phase->nCount,
+                       phase->nStartUs);
+    else
+      DEBUG_PRINT_HIGH("  %s: %llu us at +%llu us", phase_names[p],
+                       phase->nDurationUs, phase->nStartUs);
+  }
+}
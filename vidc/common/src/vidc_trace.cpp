@@ -0,0 +1,207 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "vidc_trace.h"
+#include "vidc_log.h"
+
+vidc_tracer::vidc_tracer() :
+  m_events(NULL),
+  m_size(0),
+  m_head(0),
+  m_enabled(false)
+{
+}
+
+vidc_tracer::~vidc_tracer()
+{
+  m_enabled = false;
+  if (m_events)
+  {
+    free(m_events);
+    m_events = NULL;
+  }
+}
+
+bool vidc_tracer::enable(OMX_U32 num_events)
+{
+  OMX_U32 size = 16;
+  if (!m_events)
+  {
+    if (!num_events)
+      num_events = VIDC_TRACE_DEFAULT_EVENTS;
+    while (size < num_events && size < VIDC_TRACE_MAX_EVENTS)
+      size <<= 1;
+    m_events = (trace_event *) calloc(size, sizeof(trace_event));
+    if (!m_events)
+      return false;
+    m_size = size;
+    m_head = 0;
+  }
+  // Ring must be visible before any writer sees the flag
+  __sync_synchronize();
+  m_enabled = true;
+  return true;
+}
+
+void vidc_tracer::disable()
+{
+  m_enabled = false;
+}
+
+void vidc_tracer::add(VIDC_TRACE_EVENT event, OMX_U32 buf_index,
+                      OMX_S64 timestamp)
+{
+  struct timespec now;
+  trace_event *slot;
+  OMX_U32 seq;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  seq = __sync_fetch_and_add(&m_head, 1);
+  slot = &m_events[seq & (m_size - 1)];
+  slot->seq = 0;
+  __sync_synchronize();
+  slot->type = event;
+  slot->buf_index = buf_index;
+  slot->tid = (OMX_U32) syscall(SYS_gettid);
+  slot->time_us = (OMX_U64) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+  slot->timestamp = timestamp;
+  __sync_synchronize();
+  slot->seq = seq + 1;
+}
+
+OMX_U32 vidc_tracer::get_count()
+{
+  return m_head;
+}
+
+const char *vidc_tracer::event_name(OMX_U32 type)
+{
+  static const char *names[VIDC_TRACE_EVENT_MAX] =
+  {
+    "ETB", "ParseDone", "DriverSubmit", "DriverInputDone",
+    "DriverOutputDone", "FBD", "FTB"
+  };
+  return (type < VIDC_TRACE_EVENT_MAX) ? names[type] : "Unknown";
+}
+
+/*
+ * Writes the events still in the ring as Chrome trace JSON, which both
+ * chrome://tracing and Perfetto load. Each event becomes an instant
+ * event on the thread that recorded it; in addition every driver submit
+ * opens and every FBD closes an async "frame" slice keyed by the driver
+ * timestamp, which shows the decode latency of each frame. FBD is
+ * recorded with the timestamp the driver returned, before reordering or
+ * adjustment, so it matches the submit.
+ */
+bool vidc_tracer::dump(const char *path, const char *name)
+{
+  FILE *fp;
+  OMX_U32 head, seq;
+  trace_event ev;
+  trace_event *slot;
+  int pid = getpid();
+
+  if (!path || !m_events)
+    return false;
+  fp = fopen(path, "w");
+  if (!fp)
+    return false;
+  head = m_head;
+  seq = (head >= m_size) ? head - m_size : 0;
+  fprintf(fp, "{\"traceEvents\":[\n");
+  fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+          "\"args\":{\"name\":\"%s\"}}", pid, name ? name : "vidc");
+  for (; seq != head; seq++)
+  {
+    slot = &m_events[seq & (m_size - 1)];
+    if (slot->seq != seq + 1)
+      continue;
+    ev.type = slot->type;
+    ev.buf_index = slot->buf_index;
+    ev.tid = slot->tid;
+    ev.time_us = slot->time_us;
+    ev.timestamp = slot->timestamp;
+    __sync_synchronize();
+    // Skip slots overwritten while they were copied
+    if (slot->seq != seq + 1)
+      continue;
+    fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"vidc\",\"ph\":\"i\",\"s\":\"t\","
+            "\"ts\":%llu,\"pid\":%d,\"tid\":%u,"
+            "\"args\":{\"buf\":%u,\"timestamp\":%lld}}",
+            event_name(ev.type), ev.time_us, pid, ev.tid,
+            ev.buf_index, ev.timestamp);
+    if (ev.type == VIDC_TRACE_DRV_SUBMIT || ev.type == VIDC_TRACE_FBD)
+      fprintf(fp, ",\n{\"name\":\"frame\",\"cat\":\"vidc\",\"ph\":\"%s\","
+              "\"id\":\"0x%llx\",\"ts\":%llu,\"pid\":%d,\"tid\":%u}",
+              (ev.type == VIDC_TRACE_DRV_SUBMIT) ? "b" : "e",
+              ev.timestamp, ev.time_us, pid, ev.tid);
+  }
+  fprintf(fp, "\n]}\n");
+  fclose(fp);
+  return true;
+}
+
+OMX_ERRORTYPE vidc_tracer::get_config(QOMX_VIDEO_TRACE *trace)
+{
+  if (!trace)
+    return OMX_ErrorBadParameter;
+  trace->bEnable = m_enabled ? OMX_TRUE : OMX_FALSE;
+  trace->nEvents = get_count();
+  trace->cDumpFile[0] = 0;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE vidc_tracer::set_config(QOMX_VIDEO_TRACE *trace,
+                                      const char *name)
+{
+  if (!trace)
+    return OMX_ErrorBadParameter;
+  if (trace->cDumpFile[0])
+  {
+    char path[sizeof(VIDC_DEBUG_DIR) + QOMX_VIDEO_TRACE_PATH_MAX];
+    if (!memchr(trace->cDumpFile, 0, QOMX_VIDEO_TRACE_PATH_MAX) ||
+        !vidc_debug_path(path, sizeof(path), (const char *) trace->cDumpFile))
+      return OMX_ErrorBadParameter;
+    if (!dump(path, name))
+      return OMX_ErrorUndefined;
+  }
+  if (trace->bEnable)
+  {
+    if (!enable(trace->nEvents))
+      return OMX_ErrorInsufficientResources;
+  }
+  else
+    disable();
+  return OMX_ErrorNone;
+}
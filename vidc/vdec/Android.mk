@@ -18,7 +18,7 @@ libOmxVdec-def += -D_ANDROID_
 libOmxVdec-def += -DCDECL
 libOmxVdec-def += -DT_ARM
 libOmxVdec-def += -DNO_ARM_CLZ
-libOmxVdec-def += -UENABLE_DEBUG_LOW
+libOmxVdec-def += -DENABLE_DEBUG_LOW
 libOmxVdec-def += -DENABLE_DEBUG_HIGH
 libOmxVdec-def += -DENABLE_DEBUG_ERROR
 libOmxVdec-def += -UINPUT_BUFFER_LOG
@@ -75,6 +75,7 @@ LOCAL_SHARED_LIBRARIES  += libdivxdrmdecrypt
 LOCAL_SRC_FILES         := src/frameparser.cpp
 LOCAL_SRC_FILES         += src/h264_utils.cpp
 LOCAL_SRC_FILES         += src/ts_parser.cpp
+LOCAL_SRC_FILES         += src/pts_predictor.cpp
 ifeq ($(TARGET_BOARD_PLATFORM),msm8660)
 LOCAL_SRC_FILES         += src/mp4_utils.cpp
 endif
@@ -83,6 +84,11 @@ LOCAL_SRC_FILES         += src/mp4_utils.cpp
 endif
 LOCAL_SRC_FILES         += src/omx_vdec.cpp
 LOCAL_SRC_FILES         += ../common/src/extra_data_handler.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_stats.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_trace.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_log.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_dump.cpp
+LOCAL_SRC_FILES         += ../common/src/vidc_record.cpp
 include $(BUILD_SHARED_LIBRARY)
 
 # ---------------------------------------------------------------------------------
@@ -92,6 +98,7 @@ include $(CLEAR_VARS)
 
 mm-vdec-test-inc    := $(TARGET_OUT_HEADERS)/mm-core/omxcore
 mm-vdec-test-inc    += $(LOCAL_PATH)/inc
+mm-vdec-test-inc    += $(OMX_VIDEO_PATH)/vidc/common/inc
 
 LOCAL_MODULE                    := mm-vdec-omx-test
 LOCAL_MODULE_TAGS               := optional
@@ -106,6 +113,23 @@ LOCAL_SRC_FILES           += test/omx_vdec_test.cpp
 
 include $(BUILD_EXECUTABLE)
 
+# ---------------------------------------------------------------------------------
+# 			Make the replay tool (mm-video-omx-replay)
+# ---------------------------------------------------------------------------------
+include $(CLEAR_VARS)
+
+LOCAL_MODULE                    := mm-video-omx-replay
+LOCAL_MODULE_TAGS               := optional
+LOCAL_CFLAGS                    := $(libOmxVdec-def)
+LOCAL_C_INCLUDES                := $(mm-vdec-test-inc)
+
+LOCAL_PRELINK_MODULE      := false
+LOCAL_SHARED_LIBRARIES    := libutils liblog libOmxCore
+
+LOCAL_SRC_FILES           := test/omx_replay.cpp
+
+include $(BUILD_EXECUTABLE)
+
 # ---------------------------------------------------------------------------------
 # 			Make the driver-test (mm-video-driver-test)
 # ---------------------------------------------------------------------------------
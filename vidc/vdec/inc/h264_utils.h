@@ -298,6 +298,9 @@ typedef struct
   OMX_U8   low_delay_hrd_flag;
   OMX_U8   pic_struct_present_flag;
   OMX_S64  fixed_fps_prev_ts;
+  OMX_U8   bitstream_restriction_flag;
+  OMX_U32  num_reorder_frames;
+  OMX_U32  max_dec_frame_buffering;
 } h264_vui_param;
 
 typedef struct
@@ -343,28 +346,27 @@ typedef struct
 } h264_pan_scan;
 
 #ifdef PANSCAN_HDLR
-template <class NODE_STRUCT>
-class omx_dl_list
-{
-public:
-  omx_dl_list() { head = tail = NULL; } ;
-  ~omx_dl_list() {};
-  void add_multiple(NODE_STRUCT *data_arr, int data_num);
-  NODE_STRUCT *remove_first();
-  NODE_STRUCT *remove_last();
-  void add_last(NODE_STRUCT *data_ptr);
-  NODE_STRUCT *watch_first();
-  NODE_STRUCT *watch_last();
-private:
-  NODE_STRUCT *head, *tail;
-};
-
+#define PANSCAN_DEF_DEPTH      10
+// Frames in flight between the parser and the output port
+#define PANSCAN_PIPELINE_DEPTH 4
+// Power of two so that sequence wrap-around keeps the ring index
+#define PANSCAN_MAX_DEPTH      32
+
+/*
+ * Pan-scan entries are kept in a ring indexed by a monotonically
+ * increasing sequence number. Entries in [head_seq, tail_seq) are in
+ * decode order and their start_ts is kept non-decreasing, so the entry
+ * covering an output timestamp is found with a binary search. An entry
+ * ends where the next one starts. The number of live entries is bounded
+ * by the stream reorder depth; the oldest entry is dropped on overflow.
+ */
 class panscan_handler
 {
 public:
   panscan_handler();
   ~panscan_handler();
   bool initialize(int num_data);
+  void set_depth(OMX_U32 depth);
   h264_pan_scan *get_free();
   h264_pan_scan *get_populated(OMX_S64 frame_ts);
   void update_last(OMX_S64 frame_ts);
@@ -374,11 +376,16 @@ private:
     h264_pan_scan pan_scan_param;
     OMX_S64  start_ts, end_ts;
     bool active;
-    PANSCAN_NODE *next, *prev;
   } PANSCAN_NODE;
-  omx_dl_list<PANSCAN_NODE> panscan_used;
-  omx_dl_list<PANSCAN_NODE> panscan_free;
+  PANSCAN_NODE *node(OMX_U32 seq)
+  {
+    return &panscan_data[seq & (PANSCAN_MAX_DEPTH - 1)];
+  }
+  OMX_U32 find_node(OMX_U32 last_seq, OMX_S64 frame_ts);
   PANSCAN_NODE *panscan_data;
+  OMX_U32 panscan_depth;
+  OMX_U32 head_seq;
+  OMX_U32 tail_seq;
 };
 
 #if 1 // Debug panscan data
@@ -426,6 +433,9 @@ class h264_stream_parser
     void get_frame_pack_data(OMX_QCOM_FRAME_PACK_ARRANGEMENT *frame_pack);
     bool is_mbaff();
     void get_frame_rate(OMX_U32 *frame_rate);
+    bool get_reorder_depth(OMX_U32 *num_reorder_frames,
+                           OMX_U32 *max_dec_frame_buffering);
+    OMX_U32 get_field_count() { return field_count; }
 #ifdef PANSCAN_HDLR
     void update_panscan_data(OMX_S64 timestamp);
 #endif
@@ -462,6 +472,7 @@ class h264_stream_parser
     bool    emulation_sc_enabled;
 
     h264_vui_param vui_param;
+    OMX_U32 field_count;
     h264_sei_buf_period sei_buf_period;
     h264_sei_pic_timing sei_pic_timing;
 #ifdef PANSCAN_HDLR
@@ -63,27 +63,8 @@ extern "C"{
 #else
 #define LOG_TAG "OMX-VDEC"
 #endif
-#ifdef ENABLE_DEBUG_LOW
-#define DEBUG_PRINT_LOW LOGE
-#else
-#define DEBUG_PRINT_LOW
-#endif
-#ifdef ENABLE_DEBUG_HIGH
-#define DEBUG_PRINT_HIGH LOGE
-#else
-#define DEBUG_PRINT_HIGH
-#endif
-#ifdef ENABLE_DEBUG_ERROR
-#define DEBUG_PRINT_ERROR LOGE
-#else
-#define DEBUG_PRINT_ERROR
-#endif
-
-#else //_ANDROID_
-#define DEBUG_PRINT_LOW printf
-#define DEBUG_PRINT_HIGH printf
-#define DEBUG_PRINT_ERROR printf
 #endif // _ANDROID_
+#include "vidc_log.h"
 
 #if defined (_ANDROID_HONEYCOMB_) || defined (_ANDROID_ICS_)
 #include <media/stagefright/HardwareAPI.h>
@@ -108,6 +89,11 @@ extern "C"{
 #include <linux/android_pmem.h>
 #include "extra_data_handler.h"
 #include "ts_parser.h"
+#include "pts_predictor.h"
+#include "vidc_stats.h"
+#include "vidc_trace.h"
+#include "vidc_dump.h"
+#include "vidc_record.h"
 
 extern "C" {
   OMX_API void * get_omx_component_factory_fn(void);
@@ -173,7 +159,14 @@ extern "C" {
 #define OMX_CORE_WVGA_HEIGHT         480
 #define OMX_CORE_WVGA_WIDTH          800
 
-#define DESC_BUFFER_SIZE (8192 * 16)
+#define DESC_ENTRY_SIZE  16
+#define DESC_BUFFER_SIZE (8192 * DESC_ENTRY_SIZE)
+
+// Per-port buffer metadata is carved out of one block, every section
+// starting on its own cache line
+#define VDEC_CACHE_LINE_SIZE 64
+#define VDEC_CACHE_ALIGN(x) (((x) + VDEC_CACHE_LINE_SIZE - 1) & \
+                             ~(VDEC_CACHE_LINE_SIZE - 1))
 
 #ifdef _ANDROID_
 #define MAX_NUM_INPUT_OUTPUT_BUFFERS 32
@@ -183,6 +176,7 @@ extern "C" {
 #define OMX_INTERLACE_EXTRADATA 0x00020000
 #define OMX_TIMEINFO_EXTRADATA  0x00040000
 #define OMX_PORTDEF_EXTRADATA   0x00080000
+#define OMX_STREAMINFO_EXTRADATA 0x00100000
 #define DRIVER_EXTRADATA_MASK   0x0000FFFF
 
 #define OMX_INTERLACE_EXTRADATA_SIZE ((sizeof(OMX_OTHER_EXTRADATATYPE) +\
@@ -200,6 +194,90 @@ extern "C" {
 
 //#define DEFAULT_EXTRADATA (OMX_FRAMEINFO_EXTRADATA|OMX_INTERLACE_EXTRADATA)
 
+/*
+ * Separate extradata mode. When enabled the OMX extradata records of an
+ * output buffer are written to a small cached side buffer instead of the
+ * tail of the (uncached) frame, and the frame is sized without room for
+ * them. Clients find the records of a buffer returned by FillBufferDone
+ * through QOMX_IndexConfigVideoExtradataBuffer; they stay valid until the
+ * buffer is given back with FillThisBuffer.
+ */
+enum QOMX_VDEC_EXTRADATA_INDEXTYPE
+{
+    /* "OMX.QCOM.index.param.video.SeparateExtradata"
+     * QOMX_ENABLETYPE, Loaded state before output buffers exist */
+    QOMX_IndexParamVideoSeparateExtradata = OMX_IndexVendorStartUnused + 0x00A00100,
+    /* "OMX.QCOM.index.config.video.ExtradataBuffer"
+     * QOMX_VIDEO_EXTRADATA_BUFFER */
+    QOMX_IndexConfigVideoExtradataBuffer,
+    /* "OMX.QCOM.index.param.video.StreamInfoExtraData"
+     * QOMX_ENABLETYPE, H.264 SEI/VUI are requested from the driver but
+     * only parsed when read through QOMX_IndexConfigVideoStreamInfo or
+     * OMX_QcomIndexConfigVideoFramePackingArrangement */
+    QOMX_IndexParamVideoStreamInfoExtraData,
+    /* "OMX.QCOM.index.config.video.StreamInfo"
+     * QOMX_VIDEO_STREAM_INFO */
+    QOMX_IndexConfigVideoStreamInfo,
+    /* "OMX.QCOM.index.config.video.ConcealStats"
+     * QOMX_VIDEO_CONCEAL_STATS, counted from the MB error map, which
+     * is requested from the driver by the frame info or conceal MB
+     * map extradata */
+    QOMX_IndexConfigVideoConcealStats,
+};
+
+#define OMX_QCOM_INDEX_PARAM_VIDEO_SEPARATE_EXTRADATA \
+    "OMX.QCOM.index.param.video.SeparateExtradata"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_EXTRADATA_BUFFER \
+    "OMX.QCOM.index.config.video.ExtradataBuffer"
+#define OMX_QCOM_INDEX_PARAM_VIDEO_STREAM_INFO_EXTRADATA \
+    "OMX.QCOM.index.param.video.StreamInfoExtraData"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_STREAM_INFO \
+    "OMX.QCOM.index.config.video.StreamInfo"
+#define OMX_QCOM_INDEX_CONFIG_VIDEO_CONCEAL_STATS \
+    "OMX.QCOM.index.config.video.ConcealStats"
+
+typedef struct QOMX_VIDEO_EXTRADATA_BUFFER
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_BUFFERHEADERTYPE *pBufferHdr; /* in: output buffer header */
+    OMX_U8 *pExtraData;               /* out: OMX_OTHER_EXTRADATATYPE list
+                                         ending with OMX_ExtraDataNone */
+    OMX_U32 nAllocLen;                /* out: size of the side buffer */
+} QOMX_VIDEO_EXTRADATA_BUFFER;
+
+typedef struct QOMX_VIDEO_STREAM_INFO
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nFrameRate;               /* VUI timing info, 0 if absent */
+    OMX_QCOM_ASPECT_RATIO sAspectRatio;
+    OMX_U32 nNumReorderFrames;        /* VUI bitstream restriction, */
+    OMX_U32 nMaxDecFrameBuffering;    /* 0 if absent */
+} QOMX_VIDEO_STREAM_INFO;
+
+typedef struct QOMX_VIDEO_CONCEAL_STATS
+{
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nLastConcealedMBs;        /* last frame with an MB error map */
+    OMX_U32 nLastConcealPercent;
+    OMX_U32 nFrames;                  /* frames with an MB error map */
+    OMX_U32 nFramesWithErrors;        /* of which had concealed MBs */
+    OMX_U32 nConcealedMBs;            /* total over nFrames */
+} QOMX_VIDEO_CONCEAL_STATS;
+
+// Deferred H.264 extradata NALs, parsed in arrival order on demand
+#define VDEC_DEFERRED_NAL_SIZE 4096
+struct vdec_deferred_nal
+{
+    OMX_U32 nal_type;
+    OMX_U32 size;
+};
+
 enum port_indexes
 {
     OMX_CORE_INPUT_PORT_INDEX        =0,
@@ -214,6 +292,12 @@ struct vdec_ion
 };
 #endif
 
+struct vdec_port_arena
+{
+    void *base;
+    unsigned size;
+};
+
 struct video_driver_context
 {
     int video_driver_fd;
@@ -375,6 +459,8 @@ public:
     int  m_pipe_out;
     pthread_t msg_thread_id;
     pthread_t async_thread_id;
+    // CPU time and wakeups of the two threads above
+    vidc_thread_stats m_thread_stats;
 
 private:
     // Bit Positions
@@ -471,19 +557,17 @@ private:
     };
 
 #ifdef _ANDROID_
-    struct ts_entry
-    {
-        OMX_TICKS timestamp;
-        bool valid;
-    };
-
+    // Binary min-heap of the input timestamps still in the decoder
     struct ts_arr_list
     {
-        ts_entry m_ts_arr_list[MAX_NUM_INPUT_OUTPUT_BUFFERS];
+        OMX_TICKS *m_ts_heap;
+        OMX_U32 m_ts_count;
+        OMX_U32 m_ts_size;
 
         ts_arr_list();
         ~ts_arr_list();
 
+        bool set_depth(OMX_U32 depth);
         bool insert_ts(OMX_TICKS ts);
         bool pop_min_ts(OMX_TICKS &ts);
         bool reset_ts_list();
@@ -494,6 +578,7 @@ private:
     {
         OMX_U8 *buf_addr;
         OMX_U32 desc_data_size;
+        OMX_U32 alloc_size;
     };
     bool allocate_done(void);
     bool allocate_input_done(void);
@@ -505,6 +590,9 @@ private:
     OMX_ERRORTYPE free_output_buffer(OMX_BUFFERHEADERTYPE *bufferHdr);
     void free_output_buffer_header();
     void free_input_buffer_header();
+    OMX_ERRORTYPE allocate_input_arena();
+    OMX_ERRORTYPE allocate_output_arena();
+    void free_port_arena(struct vdec_port_arena *arena);
 
     OMX_ERRORTYPE allocate_input_heap_buffer(OMX_HANDLETYPE       hComp,
                                              OMX_BUFFERHEADERTYPE **bufferHdr,
@@ -547,8 +635,12 @@ private:
 
     OMX_ERRORTYPE fill_buffer_done(OMX_HANDLETYPE hComp,
                                     OMX_BUFFERHEADERTYPE * buffer);
+    OMX_ERRORTYPE fill_buffer_done_internal(OMX_HANDLETYPE hComp,
+                                    OMX_BUFFERHEADERTYPE * buffer);
     OMX_ERRORTYPE empty_this_buffer_proxy(OMX_HANDLETYPE       hComp,
                                         OMX_BUFFERHEADERTYPE *buffer);
+    OMX_ERRORTYPE empty_this_buffer_proxy_internal(OMX_HANDLETYPE hComp,
+                                        OMX_BUFFERHEADERTYPE *buffer);
 
     OMX_ERRORTYPE empty_this_buffer_proxy_arbitrary(OMX_HANDLETYPE hComp,
                                                    OMX_BUFFERHEADERTYPE *buffer
@@ -566,28 +658,49 @@ private:
     bool release_output_done();
     bool release_input_done();
     OMX_ERRORTYPE get_buffer_req(vdec_allocatorproperty *buffer_prop);
+    OMX_U32 get_extradata_size();
+    OMX_U32 get_omx_extradata_size();
+    OMX_OTHER_EXTRADATATYPE *get_separate_extradata(OMX_BUFFERHEADERTYPE *buffer);
+    void update_output_mem_stats(unsigned index, bool alloc);
     OMX_ERRORTYPE set_buffer_req(vdec_allocatorproperty *buffer_prop);
     OMX_ERRORTYPE start_port_reconfig();
+    void startup_state_reached(OMX_STATETYPE state);
     OMX_ERRORTYPE update_picture_resolution();
     void adjust_timestamp(OMX_S64 &act_timestamp);
     void set_frame_rate(OMX_S64 act_timestamp);
+    void update_driver_frame_rate();
     void handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr);
     OMX_ERRORTYPE enable_extradata(OMX_U32 requested_extradata, bool enable = true);
     void print_debug_extradata(OMX_OTHER_EXTRADATATYPE *extra);
+    void init_dumps();
+    void dump_output(OMX_BUFFERHEADERTYPE *buffer, bool error);
     void append_interlace_extradata(OMX_OTHER_EXTRADATATYPE *extra,
                                     OMX_U32 interlaced_format_type);
+    void fill_interlace_format(OMX_STREAMINTERLACEFORMAT *interlace_format,
+                               OMX_U32 interlaced_format_type);
     void append_frame_info_extradata(OMX_OTHER_EXTRADATATYPE *extra,
                                      OMX_U32 num_conceal_mb,
                                      OMX_U32 picture_type,
                                      OMX_S64 timestamp,
                                      OMX_U32 frame_rate);
+    void fill_frame_info(OMX_QCOM_EXTRADATA_FRAMEINFO *frame_info,
+                         OMX_U32 num_conceal_mb,
+                         OMX_U32 picture_type,
+                         OMX_S64 timestamp,
+                         OMX_U32 frame_rate);
+    void build_extradata_template();
     void append_terminator_extradata(OMX_OTHER_EXTRADATATYPE *extra);
     OMX_ERRORTYPE update_portdef(OMX_PARAM_PORTDEFINITIONTYPE *portDefn);
     void append_portdef_extradata(OMX_OTHER_EXTRADATATYPE *extra);
-    void insert_demux_addr_offset(OMX_U32 address_offset);
+    OMX_ERRORTYPE insert_demux_addr_offset(OMX_BUFFERHEADERTYPE *buf_hdr,
+                                           OMX_U32 address_offset);
+    OMX_ERRORTYPE grow_desc_buffer(OMX_U32 index, OMX_U32 size);
     void extract_demux_addr_offsets(OMX_BUFFERHEADERTYPE *buf_hdr);
     OMX_ERRORTYPE handle_demux_data(OMX_BUFFERHEADERTYPE *buf_hdr);
     OMX_U32 count_MB_in_extradata(OMX_OTHER_EXTRADATATYPE *extra);
+    void parse_extradata_nal(OMX_OTHER_EXTRADATATYPE *extra, OMX_U32 nal_type,
+                             bool defer);
+    void parse_deferred_extradata();
 
     bool align_pmem_buffers(int pmem_fd, OMX_U32 buffer_size,
                             OMX_U32 alignment);
@@ -651,7 +764,7 @@ private:
     //*************************************************************
     //*******************MEMBER VARIABLES *************************
     //*************************************************************
-    pthread_mutex_t       m_lock;
+    vidc_mutex            m_lock;
     //sem to handle the minimum procesing of commands
     sem_t                 m_cmd_lock;
     bool              m_error_propogated;
@@ -674,6 +787,29 @@ private:
     OMX_BUFFERHEADERTYPE  *m_inp_mem_ptr;
     // Output memory pointer
     OMX_BUFFERHEADERTYPE  *m_out_mem_ptr;
+    // Single allocations backing the per-port headers and driver contexts
+    struct vdec_port_arena m_inp_arena;
+    struct vdec_port_arena m_out_arena;
+    // Contiguous/desc memory held by this session
+    vidc_mem_stats m_mem_stats;
+    // Frame and extradata bytes accounted per output buffer at allocation
+    OMX_U32 m_mem_out_size[MAX_NUM_INPUT_OUTPUT_BUFFERS];
+    OMX_U32 m_mem_out_extradata[MAX_NUM_INPUT_OUTPUT_BUFFERS];
+    // Pipeline event ring, dumped to m_trace_file on deinit if set
+    vidc_tracer m_tracer;
+    char m_trace_file[QOMX_VIDEO_TRACE_PATH_MAX];
+    // Rolling fps/latency/queue counters for QOMX_IndexConfigVideoLiveStats
+    vidc_live_stats m_live_stats;
+    // Hardware counters per stage for QOMX_IndexConfigVideoPerfStats
+    vidc_perf m_perf;
+    // Time to first frame by phase for QOMX_IndexConfigVideoStartupStats
+    vidc_startup_stats m_startup;
+    // Bitstream, frame and extradata dumps written by background threads
+    vidc_dump m_input_dump;
+    vidc_dump m_output_dump;
+    vidc_dump m_extradata_dump;
+    // Client calls and callbacks recorded for mm-video-omx-replay
+    vidc_recorder m_recorder;
     // number of input bitstream error frame count
     unsigned int m_inp_err_count;
 #ifdef _ANDROID_
@@ -750,22 +886,43 @@ private:
     enum vc1_profile_type m_vc1_profile;
     OMX_S64 h264_last_au_ts;
     OMX_U32 h264_last_au_flags;
-    OMX_U32 m_demux_offsets[8192];
+    // Entries written to the desc buffer of the frame being demuxed
     OMX_U32 m_demux_entries;
+    OMX_U32 m_demux_last_offset;
 
-    OMX_S64 prev_ts;
-    bool rst_prev_ts;
-    OMX_U32 frm_int;
+    pts_predictor m_pts;
+    // Fields the next output frame is displayed for, from SEI pic_struct
+    OMX_U32 m_pts_fields;
 
     struct vdec_allocatorproperty op_buf_rcnfg;
     bool in_reconfig;
     OMX_NATIVE_WINDOWTYPE m_display_id;
     h264_stream_parser *h264_parser;
     OMX_U32 client_extradata;
+    // Separate extradata mode, one side buffer per output buffer
+    // carved from the output arena
+    bool m_sep_extradata;
+    OMX_U8 *m_out_extradata;
+    OMX_U32 m_out_extradata_stride;
+    // Written by the FBD path, read by get_config
+    QOMX_VIDEO_CONCEAL_STATS m_conceal_stats;
+    // Prebuilt OMX extradata records of this session, rebuilt when the
+    // extradata selection or the port definition changes
+    OMX_U8 *m_extradata_tmpl;
+    OMX_U32 m_extradata_tmpl_len;     // records, terminator excluded
+    OMX_S32 m_tmpl_interlace_off;
+    OMX_S32 m_tmpl_frameinfo_off;
+    bool m_extradata_tmpl_dirty;
+    // SEI/VUI records waiting for a stream info read
+    OMX_U8 *m_deferred_nal;
+    OMX_U32 m_deferred_nal_len;
+    // Serializes h264_parser and the deferred queue between the message
+    // thread (input assembly, FBD extradata) and get_config
+    pthread_mutex_t m_parser_lock;
 #ifdef _ANDROID_
     bool m_debug_timestamp;
     bool perf_flag;
-    OMX_U32 proc_frms, latency;
+    OMX_U32 proc_frms;
     perf_metrics fps_metrics;
     perf_metrics dec_time;
     bool m_enable_android_native_buffers;
@@ -0,0 +1,74 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#ifndef __PTS_PREDICTOR_H
+#define __PTS_PREDICTOR_H
+
+#include "OMX_Types.h"
+
+/* Timestamps closer than this (us) are treated as repeats */
+#define PTS_DUPLICATE_WINDOW  2000
+/* Consecutive off-cadence intervals before the cadence is relearned */
+#define PTS_CADENCE_RELOCK    4
+
+/*
+ * Output timestamp engine. Fed once per output frame with the
+ * timestamp left after DTS reordering and SEI/VUI substitution, it
+ * passes valid timestamps through and fills missing or repeated ones
+ * from the learned cadence, advancing by the number of fields the
+ * frame is displayed for (pic_struct), so soft telecine and dropped
+ * fields keep a steady clock. It also tracks the
+ * smallest observed frame interval, which is what the driver is
+ * programmed with. Every call is constant time.
+ */
+class pts_predictor
+{
+public:
+  pts_predictor();
+  void reset();
+  void set_frame_interval(OMX_U32 frame_interval);
+  bool observe(OMX_S64 timestamp);
+  OMX_S64 predict(OMX_S64 timestamp, OMX_U32 num_fields, bool tolerant);
+  bool min_interval_changed();
+  OMX_U32 get_min_interval() { return m_min_interval; }
+  OMX_U32 get_frame_interval() { return m_interval; }
+
+private:
+  bool update_min_interval(OMX_S64 delta);
+  void learn_cadence(OMX_S64 delta, OMX_U32 num_fields);
+  OMX_S64 m_prev_in;        // last timestamp passed to observe()
+  OMX_S64 m_prev_src;       // last valid timestamp passed to predict()
+  OMX_S64 m_prev_out;       // last timestamp handed out by predict()
+  OMX_U32 m_prev_fields;    // fields the last output frame is shown for
+  bool    m_prev_real;      // last output was a stream timestamp
+  bool    m_restart;        // next valid timestamp restarts the clock
+  OMX_U32 m_interval;       // smoothed frame (two field) interval
+  OMX_U32 m_min_interval;   // smallest frame interval seen
+  bool    m_min_changed;
+  OMX_U32 m_outliers;
+};
+#endif
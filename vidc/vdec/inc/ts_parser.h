@@ -37,6 +37,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <stdio.h>
 #include <inttypes.h>
 
+/* Frames an H.264 decoder may hold back for reordering (max DPB) */
+#define TS_REORDER_DEPTH 16
+
 #ifdef _ANDROID_
 extern "C"{
 #include<utils/Log.h>
@@ -53,32 +56,39 @@ public:
 	bool get_next_timestamp(OMX_BUFFERHEADERTYPE *header, bool is_interlaced);
 	bool remove_time_stamp(OMX_TICKS ts, bool is_interlaced);
 	void flush_timestamp();
+	bool set_depth(unsigned int depth);
 
 private:
-	#define TIME_SZ 64
+	#define TIME_SZ 64  /* depth used if set_depth was not called */
+	/* Every EOS starts a new segment, timestamps are handed out
+	 * segment by segment and in increasing order within one */
 	typedef struct timestamp {
 		OMX_TICKS timestamps;
-		bool in_use;
+		unsigned int segment;
 	}timestamp;
-	typedef struct time_stamp_list {
-		timestamp input_timestamps[TIME_SZ];
-		time_stamp_list *next;
-		time_stamp_list *prev;
-		unsigned int entries_filled;
-	}time_stamp_list;
+	/* Binary min-heap on (segment, timestamp), sized by set_depth and
+	 * doubled if a stream holds back more than that */
+	timestamp *heap;
+	unsigned int heap_count;
+	unsigned int heap_size;
+	unsigned int cur_segment;
 	bool error;
-	time_stamp_list *phead,*pcurrent;
-	bool get_current_list();
-	bool add_new_list();
-	bool update_head();
-	void delete_list();
+	static inline bool before(const timestamp &a, const timestamp &b)
+	{
+		return a.segment < b.segment ||
+		       (a.segment == b.segment && a.timestamps < b.timestamps);
+	}
+	void sift_up(unsigned int idx, timestamp entry);
+	void sift_down(unsigned int idx, timestamp entry);
+	void remove_at(unsigned int idx);
+	int find(unsigned int segment, OMX_TICKS ts);
 	void handle_error()
 	{
 		LOGE("Error handler called for TS Parser");
 		if (error)
 			return;
 		error = true;
-		delete_list();
+		flush_timestamp();
 	}
 	bool reorder_ts;
         bool print_debug;
@@ -514,7 +514,7 @@ h264_stream_parser::h264_stream_parser()
   {
     DEBUG_PRINT_ERROR("ERROR: Panscan hdl was not allocated!");
   }
-  else if (!panscan_hdl->initialize(10))
+  else if (!panscan_hdl->initialize(PANSCAN_DEF_DEPTH))
   {
     DEBUG_PRINT_ERROR("ERROR: Allocating memory for panscan!");
     delete panscan_hdl;
@@ -553,6 +553,7 @@ void h264_stream_parser::reset()
   memset(&frame_packing_arrangement,0,sizeof(frame_packing_arrangement));
   frame_packing_arrangement.cancel_flag = 1;
   mbaff_flag = 0;
+  field_count = 2;
 }
 
 void h264_stream_parser::init_bitstream(OMX_U8* data, OMX_U32 size)
@@ -627,15 +628,22 @@ void h264_stream_parser::parse_vui(bool vui_in_extradata)
     vui_param.low_delay_hrd_flag = extract_bits(1);
   vui_param.pic_struct_present_flag = extract_bits(1);
   DEBUG_PRINT_LOW("pic_struct_present_flag : %u", vui_param.pic_struct_present_flag);
-  if (extract_bits(1)) //bitstream_restriction_flag
+  vui_param.bitstream_restriction_flag = extract_bits(1);
+  if (vui_param.bitstream_restriction_flag)
   {
     extract_bits(1); //motion_vectors_over_pic_boundaries_flag
     uev(); //max_bytes_per_pic_denom
     uev(); //max_bits_per_mb_denom
     uev(); //log2_max_mv_length_vertical
     uev(); //log2_max_mv_length_horizontal
-    uev(); //num_reorder_frames
-    uev(); //max_dec_frame_buffering
+    vui_param.num_reorder_frames = uev();
+    vui_param.max_dec_frame_buffering = uev();
+    DEBUG_PRINT_LOW("  num reorder frames : %u", vui_param.num_reorder_frames);
+    DEBUG_PRINT_LOW("  max dec frame buf  : %u", vui_param.max_dec_frame_buffering);
+#ifdef PANSCAN_HDLR
+    if (panscan_hdl)
+      panscan_hdl->set_depth(vui_param.max_dec_frame_buffering + PANSCAN_PIPELINE_DEPTH);
+#endif
   }
   DEBUG_PRINT_LOW("parse_vui: OUT");
 }
@@ -1074,6 +1082,8 @@ void h264_stream_parser::parse_sps()
   }
   if (extract_bits(1)) //vui_parameters_present_flag
     parse_vui(false);
+  else // A depth from an earlier SPS no longer applies
+    vui_param.bitstream_restriction_flag = 0;
   DEBUG_PRINT_LOW("@@parse_sps: OUT");
 }
 
@@ -1291,6 +1301,16 @@ void h264_stream_parser::get_frame_rate(OMX_U32 *frame_rate)
     *frame_rate = vui_param.time_scale / (2 * vui_param.num_units_in_tick);
 }
 
+bool h264_stream_parser::get_reorder_depth(OMX_U32 *num_reorder_frames,
+                                           OMX_U32 *max_dec_frame_buffering)
+{
+  if (!vui_param.bitstream_restriction_flag)
+    return false;
+  *num_reorder_frames = vui_param.num_reorder_frames;
+  *max_dec_frame_buffering = vui_param.max_dec_frame_buffering;
+  return true;
+}
+
 void h264_stream_parser::parse_nal(OMX_U8* data_ptr, OMX_U32 data_len, OMX_U32 nal_type, bool enable_emu_sc)
 {
   OMX_U32 nal_unit_type = NALU_TYPE_UNSPECIFIED, cons_bytes = 0;
@@ -1421,13 +1441,20 @@ OMX_S64 h264_stream_parser::process_ts_with_sei_vui(OMX_S64 timestamp)
   {
     DEBUG_PRINT_LOW("NO TIMING information present in VUI!");
   }
+  field_count = deltaTfiDivisor;
   sei_pic_timing.is_valid = false; // SEI data is valid only for current frame
   return clock_ts;
 }
 
 #ifdef PANSCAN_HDLR
 
-panscan_handler::panscan_handler() : panscan_data(NULL) {}
+panscan_handler::panscan_handler() :
+  panscan_data(NULL),
+  panscan_depth(0),
+  head_seq(0),
+  tail_seq(0)
+{
+}
 
 panscan_handler::~panscan_handler()
 {
@@ -1443,10 +1470,11 @@ bool panscan_handler::initialize(int num_data)
   bool ret = false;
   if (!panscan_data)
   {
-    panscan_data = (PANSCAN_NODE *) malloc (sizeof(PANSCAN_NODE) * num_data);
+    panscan_data = (PANSCAN_NODE *) calloc (PANSCAN_MAX_DEPTH, sizeof(PANSCAN_NODE));
     if (panscan_data)
     {
-      panscan_free.add_multiple(panscan_data, num_data);
+      head_seq = tail_seq = 0;
+      set_depth(num_data);
       ret = true;
     }
   }
@@ -1457,156 +1485,129 @@ bool panscan_handler::initialize(int num_data)
   return ret;
 }
 
-h264_pan_scan *panscan_handler::get_free()
+void panscan_handler::set_depth(OMX_U32 depth)
 {
-  h264_pan_scan *data = NULL;
-  PANSCAN_NODE *panscan_node = panscan_used.watch_last();
-  panscan_node = (!panscan_node || VALID_TS(panscan_node->start_ts))?
-                 panscan_free.remove_first() :
-                 panscan_used.remove_last();
-  if (panscan_node)
-  {
-    panscan_node->start_ts = LLONG_MAX;
-    panscan_node->end_ts = LLONG_MAX;
-    panscan_node->pan_scan_param.rect_id = NO_PAN_SCAN_BIT;
-    panscan_node->active = false;
-    panscan_used.add_last(panscan_node);
-    data = &panscan_node->pan_scan_param;
-  }
-  return data;
+  if (depth < 2)
+    depth = 2;
+  else if (depth > PANSCAN_MAX_DEPTH)
+    depth = PANSCAN_MAX_DEPTH;
+  if (depth != panscan_depth)
+    DEBUG_PRINT_LOW("panscan depth %lu -> %lu", panscan_depth, depth);
+  panscan_depth = depth;
+  while (tail_seq - head_seq > panscan_depth)
+    head_seq++;
 }
 
-h264_pan_scan *panscan_handler::get_populated(OMX_S64 frame_ts)
+h264_pan_scan *panscan_handler::get_free()
 {
-  h264_pan_scan *data = NULL;
-  PANSCAN_NODE *panscan_node = panscan_used.watch_first();
-  while (panscan_node && !data)
+  PANSCAN_NODE *panscan_node = NULL;
+  if (!panscan_data)
+    return NULL;
+  if (tail_seq != head_seq && !VALID_TS(node(tail_seq - 1)->start_ts))
+    // Last entry is not bound to a frame yet, overwrite it
+    panscan_node = node(tail_seq - 1);
+  else
   {
-    if (VALID_TS(panscan_node->start_ts))
-    {
-      if (panscan_node->active && frame_ts < panscan_node->start_ts)
-        panscan_node->start_ts = frame_ts;
-      if (frame_ts >= panscan_node->start_ts)
-        if (frame_ts < panscan_node->end_ts)
-        {
-          data = &panscan_node->pan_scan_param;
-          panscan_node->active = true;
-        }
-        else
-        {
-          panscan_free.add_last(panscan_used.remove_first());
-          panscan_node = panscan_used.watch_first();
-        }
-      else
-        // Finish search if current timestamp has not reached
-        // start timestamp of first panscan data.
-        panscan_node = NULL;
-    }
-    else
+    if (tail_seq - head_seq >= panscan_depth)
     {
-      // Only one panscan data is stored for clips
-      // with invalid timestamps in every frame
-      data = &panscan_node->pan_scan_param;
-      panscan_node->active = true;
+      DEBUG_PRINT_LOW("panscan: dropping oldest entry start_ts(%lld)",
+                      node(head_seq)->start_ts);
+      head_seq++;
     }
+    panscan_node = node(tail_seq++);
   }
-  if (data)
-    if (data->rect_repetition_period == 0)
-      panscan_free.add_last(panscan_used.remove_first());
-    else if (data->rect_repetition_period > 1)
-      data->rect_repetition_period -= 2;
-  PRINT_PANSCAN_DATA(panscan_node);
-  return data;
+  panscan_node->start_ts = LLONG_MAX;
+  panscan_node->end_ts = LLONG_MAX;
+  panscan_node->pan_scan_param.rect_id = NO_PAN_SCAN_BIT;
+  panscan_node->active = false;
+  return &panscan_node->pan_scan_param;
 }
 
-void panscan_handler::update_last(OMX_S64 frame_ts)
+/* Last entry in [head_seq, last_seq) whose start_ts is <= frame_ts.
+ * The caller guarantees node(head_seq)->start_ts <= frame_ts. */
+OMX_U32 panscan_handler::find_node(OMX_U32 last_seq, OMX_S64 frame_ts)
 {
-  PANSCAN_NODE *panscan_node = panscan_used.watch_last();
-  if (panscan_node && !VALID_TS(panscan_node->start_ts))
+  OMX_U32 lo = head_seq, hi = last_seq;
+  while (hi - lo > 1)
   {
-    panscan_node->start_ts = frame_ts;
-    PRINT_PANSCAN_DATA(panscan_node);
-    if (panscan_node->prev)
-    {
-      if (frame_ts < panscan_node->prev->end_ts)
-        panscan_node->prev->end_ts = frame_ts;
-      else if (!VALID_TS(frame_ts))
-        panscan_node->prev->pan_scan_param.rect_repetition_period = 0;
-      PRINT_PANSCAN_DATA(panscan_node->prev);
-    }
+    OMX_U32 mid = lo + (hi - lo) / 2;
+    if (node(mid)->start_ts <= frame_ts)
+      lo = mid;
+    else
+      hi = mid;
   }
+  return lo;
 }
 
-template <class NODE_STRUCT>
-void omx_dl_list<NODE_STRUCT>::add_multiple(NODE_STRUCT *data_arr, int data_num)
-{
-  for (int idx = 0; idx < data_num; idx++)
-    add_last(&data_arr[idx]);
-}
-
-template <class NODE_STRUCT>
-NODE_STRUCT *omx_dl_list<NODE_STRUCT>::remove_first()
+h264_pan_scan *panscan_handler::get_populated(OMX_S64 frame_ts)
 {
-  NODE_STRUCT *data = head;
-  if (head)
+  h264_pan_scan *data = NULL;
+  PANSCAN_NODE *panscan_node = NULL;
+  if (head_seq == tail_seq)
+    return NULL;
+  panscan_node = node(head_seq);
+  if (VALID_TS(panscan_node->start_ts))
   {
-    if (head->next)
+    OMX_U32 last_seq = tail_seq;
+    if (!VALID_TS(node(last_seq - 1)->start_ts))
+      last_seq--;
+    if (panscan_node->active && frame_ts < panscan_node->start_ts)
+      panscan_node->start_ts = frame_ts;
+    if (frame_ts >= panscan_node->start_ts)
     {
-      head = head->next;
-      head->prev = NULL;
+      // Entries ahead of the covering one have ended
+      head_seq = find_node(last_seq, frame_ts);
+      panscan_node = node(head_seq);
+      if (frame_ts >= panscan_node->end_ts)
+        panscan_node = (++head_seq != tail_seq)? node(head_seq) : NULL;
     }
     else
-      head = tail = NULL;
-    data->next = data->prev = NULL;
+      // Current timestamp has not reached start timestamp
+      // of first panscan data.
+      panscan_node = NULL;
   }
-  return data;
-}
-
-template <class NODE_STRUCT>
-NODE_STRUCT *omx_dl_list<NODE_STRUCT>::remove_last()
-{
-  NODE_STRUCT *data = tail;
-  if (tail)
+  // else: only one panscan data is stored for clips
+  // with invalid timestamps in every frame
+  if (panscan_node)
   {
-    if (tail->prev)
-    {
-      tail = tail->prev;
-      tail->next = NULL;
-    }
-    else
-      head = tail = NULL;
-    data->next = data->prev = NULL;
+    data = &panscan_node->pan_scan_param;
+    panscan_node->active = true;
+    if (data->rect_repetition_period == 0)
+      head_seq++;
+    else if (data->rect_repetition_period > 1)
+      data->rect_repetition_period -= 2;
   }
+  PRINT_PANSCAN_DATA(panscan_node);
   return data;
 }
 
-template <class NODE_STRUCT>
-void omx_dl_list<NODE_STRUCT>::add_last(NODE_STRUCT* data_ptr)
+void panscan_handler::update_last(OMX_S64 frame_ts)
 {
-  if (data_ptr)
+  PANSCAN_NODE *panscan_node = NULL, *prev_node = NULL;
+  if (head_seq == tail_seq)
+    return;
+  panscan_node = node(tail_seq - 1);
+  if (VALID_TS(panscan_node->start_ts))
+    return;
+  // Entries starting after this frame cover no frame at all; drop them
+  // so that start_ts stays sorted for the lookup in get_populated.
+  while (VALID_TS(frame_ts) && tail_seq - head_seq > 1 &&
+         frame_ts < node(tail_seq - 2)->start_ts)
   {
-    data_ptr->next = NULL;
-    data_ptr->prev = tail;
-    if (tail)
-    {
-      tail->next = data_ptr;
-      tail = data_ptr;
-    }
-    else
-      head = tail = data_ptr;
+    *node(tail_seq - 2) = *panscan_node;
+    panscan_node = node(--tail_seq - 1);
+  }
+  panscan_node->start_ts = frame_ts;
+  PRINT_PANSCAN_DATA(panscan_node);
+  if (tail_seq - head_seq > 1)
+  {
+    prev_node = node(tail_seq - 2);
+    if (frame_ts < prev_node->end_ts)
+      prev_node->end_ts = frame_ts;
+    else if (!VALID_TS(frame_ts))
+      prev_node->pan_scan_param.rect_repetition_period = 0;
+    PRINT_PANSCAN_DATA(prev_node);
   }
-}
-
-template <class NODE_STRUCT>
-NODE_STRUCT* omx_dl_list<NODE_STRUCT>::watch_first()
-{
-  return head;
-}
-
-template <class NODE_STRUCT>
-NODE_STRUCT* omx_dl_list<NODE_STRUCT>::watch_last()
-{
-  return tail;
 }
 
 #endif
@@ -48,6 +48,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "omx_vdec.h"
 #include <fcntl.h>
 #include <limits.h>
+#ifdef __ARM_NEON__
+#include <arm_neon.h>
+#endif
 
 #ifndef _ANDROID_
 #include <sys/ioctl.h>
@@ -80,15 +83,12 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifdef INPUT_BUFFER_LOG
 #define INPUT_BUFFER_FILE_NAME "/data/input-bitstream.\0\0\0\0"
 #define INPUT_BUFFER_FILE_NAME_LEN 30
-FILE *inputBufferFile1;
 char inputfilename [INPUT_BUFFER_FILE_NAME_LEN] = "\0";
 #endif
 #ifdef OUTPUT_BUFFER_LOG
-FILE *outputBufferFile1;
 char outputfilename [] = "/data/output.yuv";
 #endif
 #ifdef OUTPUT_EXTRADATA_LOG
-FILE *outputExtradataFile;
 char ouputextradatafilename [] = "/data/extradata";
 #endif
 
@@ -142,6 +142,7 @@ void* async_message_thread (void *input)
   int error_code = 0;
   DEBUG_PRINT_HIGH("omx_vdec: Async thread start\n");
   prctl(PR_SET_NAME, (unsigned long)"VideoDecCallBackThread", 0, 0, 0);
+  omx->m_thread_stats.thread_start(QOMX_VIDEO_THREAD_CALLBACK);
   while (1)
   {
     ioctl_msg.in = NULL;
@@ -149,6 +150,7 @@ void* async_message_thread (void *input)
     /*Wait for a message from the video decoder driver*/
     error_code = ioctl ( omx->drv_ctx.video_driver_fd,VDEC_IOCTL_GET_NEXT_MSG,
                          (void*)&ioctl_msg);
+    omx->m_thread_stats.wakeup(QOMX_VIDEO_THREAD_CALLBACK);
     if (error_code == -512) // ERESTARTSYS
     {
       DEBUG_PRINT_ERROR("\n ERESTARTSYS received in ioctl read next msg!");
@@ -163,6 +165,7 @@ void* async_message_thread (void *input)
       DEBUG_PRINT_ERROR("\nERROR:Wrong ioctl message");
     }
   }
+  omx->m_thread_stats.thread_exit(QOMX_VIDEO_THREAD_CALLBACK);
   DEBUG_PRINT_HIGH("omx_vdec: Async thread stop\n");
   return NULL;
 }
@@ -175,10 +178,12 @@ void* message_thread(void *input)
 
   DEBUG_PRINT_HIGH("omx_vdec: message thread start\n");
   prctl(PR_SET_NAME, (unsigned long)"VideoDecMsgThread", 0, 0, 0);
+  omx->m_thread_stats.thread_start(QOMX_VIDEO_THREAD_MESSAGE);
   while (1)
   {
 
     n = read(omx->m_pipe_in, &id, 1);
+    omx->m_thread_stats.wakeup(QOMX_VIDEO_THREAD_MESSAGE);
 
     if(0 == n)
     {
@@ -195,6 +200,7 @@ void* message_thread(void *input)
       break;
     }
   }
+  omx->m_thread_stats.thread_exit(QOMX_VIDEO_THREAD_MESSAGE);
   DEBUG_PRINT_HIGH("omx_vdec: message thread stop\n");
   return 0;
 }
@@ -274,103 +280,116 @@ unsigned omx_vdec::omx_cmd_queue::get_q_msg_type()
 }
 
 #ifdef _ANDROID_
-omx_vdec::ts_arr_list::ts_arr_list()
+omx_vdec::ts_arr_list::ts_arr_list():
+  m_ts_heap(NULL),
+  m_ts_count(0),
+  m_ts_size(0)
 {
-  //initialize timestamps array
-  memset(m_ts_arr_list, 0, ( sizeof(ts_entry) * MAX_NUM_INPUT_OUTPUT_BUFFERS) );
+  // On failure the heap stays empty and insert_ts retries the allocation
+  set_depth(MAX_NUM_INPUT_OUTPUT_BUFFERS);
 }
 omx_vdec::ts_arr_list::~ts_arr_list()
 {
-  //free m_ts_arr_list?
+  free(m_ts_heap);
 }
 
-bool omx_vdec::ts_arr_list::insert_ts(OMX_TICKS ts)
+/* ======================================================================
+FUNCTION
+  omx_vdec::ts_arr_list::set_depth
+
+DESCRIPTION
+  Makes room for depth timestamps. The heap never shrinks below the
+  number of timestamps it currently holds.
+
+PARAMETERS
+  depth - number of timestamps that can be outstanding.
+
+RETURN VALUE
+  false if the storage could not be grown.
+
+========================================================================== */
+bool omx_vdec::ts_arr_list::set_depth(OMX_U32 depth)
 {
-  bool ret = true;
-  bool duplicate_ts = false;
-  int idx = 0;
+  OMX_TICKS *heap = NULL;
 
-  //insert at the first available empty location
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
+  if (depth <= m_ts_size)
+    return true;
+  heap = (OMX_TICKS *)realloc(m_ts_heap, depth * sizeof(OMX_TICKS));
+  if (!heap)
   {
-    if (!m_ts_arr_list[idx].valid)
-    {
-      //found invalid or empty entry, save timestamp
-      m_ts_arr_list[idx].valid = true;
-      m_ts_arr_list[idx].timestamp = ts;
-      DEBUG_PRINT_LOW("Insert_ts(): Inserting TIMESTAMP (%lld) at idx (%d)",
-                       ts, idx);
-      break;
-    }
+    DEBUG_PRINT_ERROR("set_depth(): Failed to grow timestamp heap to %lu", depth);
+    return false;
   }
+  DEBUG_PRINT_LOW("set_depth(): Timestamp heap depth %lu -> %lu", m_ts_size, depth);
+  m_ts_heap = heap;
+  m_ts_size = depth;
+  return true;
+}
+
+bool omx_vdec::ts_arr_list::insert_ts(OMX_TICKS ts)
+{
+  OMX_U32 idx, parent;
 
-  if (idx == MAX_NUM_INPUT_OUTPUT_BUFFERS)
+  if (m_ts_count == m_ts_size &&
+      !set_depth(m_ts_size ? m_ts_size * 2 : MAX_NUM_INPUT_OUTPUT_BUFFERS))
   {
     DEBUG_PRINT_LOW("Timestamp array list is FULL. Unsuccessful insert");
-    ret = false;
+    return false;
   }
-  return ret;
+
+  //sift up from the new leaf
+  idx = m_ts_count++;
+  while (idx)
+  {
+    parent = (idx - 1) >> 1;
+    if (m_ts_heap[parent] <= ts)
+      break;
+    m_ts_heap[idx] = m_ts_heap[parent];
+    idx = parent;
+  }
+  m_ts_heap[idx] = ts;
+  DEBUG_PRINT_LOW("Insert_ts(): Inserting TIMESTAMP (%lld), count (%lu)",
+                   ts, m_ts_count);
+  return true;
 }
 
 bool omx_vdec::ts_arr_list::pop_min_ts(OMX_TICKS &ts)
 {
-  bool ret = true;
-  int min_idx = -1;
-  OMX_TICKS min_ts = 0;
-  int idx = 0;
-
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-
-    if (m_ts_arr_list[idx].valid)
-    {
-      //found valid entry, save index
-      if (min_idx < 0)
-      {
-        //first valid entry
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
-      else if (m_ts_arr_list[idx].timestamp < min_ts)
-      {
-        min_ts = m_ts_arr_list[idx].timestamp;
-        min_idx = idx;
-      }
-    }
+  OMX_U32 idx = 0, child;
+  OMX_TICKS last;
 
-  }
-
-  if (min_idx < 0)
+  if (!m_ts_count)
   {
     //no valid entries found
     DEBUG_PRINT_LOW("Timestamp array list is empty. Unsuccessful pop");
     ts = 0;
-    ret = false;
+    return false;
   }
-  else
+
+  ts = m_ts_heap[0];
+  last = m_ts_heap[--m_ts_count];
+  //sift the last leaf down from the root
+  while ((child = 2 * idx + 1) < m_ts_count)
   {
-    ts = m_ts_arr_list[min_idx].timestamp;
-    m_ts_arr_list[min_idx].valid = false;
-    DEBUG_PRINT_LOW("Pop_min_ts:Timestamp (%lld), index(%d)",
-                     ts, min_idx);
+    if (child + 1 < m_ts_count && m_ts_heap[child + 1] < m_ts_heap[child])
+      child++;
+    if (last <= m_ts_heap[child])
+      break;
+    m_ts_heap[idx] = m_ts_heap[child];
+    idx = child;
   }
-
-  return ret;
-
+  m_ts_heap[idx] = last;
+  DEBUG_PRINT_LOW("Pop_min_ts:Timestamp (%lld), count(%lu)",
+                   ts, m_ts_count);
+  return true;
 }
 
 
 bool omx_vdec::ts_arr_list::reset_ts_list()
 {
-  bool ret = true;
-  int idx = 0;
-
   DEBUG_PRINT_LOW("reset_ts_list(): Resetting timestamp array list");
-  for ( ; idx < MAX_NUM_INPUT_OUTPUT_BUFFERS; idx++)
-  {
-    m_ts_arr_list[idx].valid = false;
-  }
-  return ret;
+  m_ts_count = 0;
+  return true;
 }
 #endif
 
@@ -446,14 +465,22 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
                       m_error_propogated(false),
                       m_device_file_ptr(NULL),
                       m_vc1_profile((vc1_profile_type)0),
-                      prev_ts(LLONG_MAX),
-                      rst_prev_ts(true),
-                      frm_int(0),
+                      m_pts_fields(2),
                       m_in_alloc_cnt(0),
                       m_display_id(NULL),
                       ouput_egl_buffers(false),
                       h264_parser(NULL),
                       client_extradata(0),
+                      m_sep_extradata(false),
+                      m_out_extradata(NULL),
+                      m_out_extradata_stride(0),
+                      m_extradata_tmpl(NULL),
+                      m_extradata_tmpl_len(0),
+                      m_tmpl_interlace_off(-1),
+                      m_tmpl_frameinfo_off(-1),
+                      m_extradata_tmpl_dirty(true),
+                      m_deferred_nal(NULL),
+                      m_deferred_nal_len(0),
                       h264_last_au_ts(LLONG_MAX),
                       h264_last_au_flags(0),
                       m_inp_err_count(0),
@@ -474,6 +501,7 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
                     ,m_desc_buffer_ptr(NULL)
 {
   /* Assumption is that , to begin with , we have all the frames with decoder */
+  vidc_log_init();
   DEBUG_PRINT_HIGH("In OMX vdec Constructor");
 #ifdef _ANDROID_
   char property_value[PROPERTY_VALUE_MAX] = {0};
@@ -483,7 +511,7 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
   {
     DEBUG_PRINT_HIGH("vidc.dec.debug.perf is %d", perf_flag);
     dec_time.start();
-    proc_frms = latency = 0;
+    proc_frms = 0;
   }
   property_value[0] = NULL;
   property_get("vidc.dec.debug.ts", property_value, "0");
@@ -500,6 +528,28 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
   m_debug_concealedmb = atoi(property_value);
   DEBUG_PRINT_HIGH("vidc.dec.debug.concealedmb value is %d",m_debug_concealedmb);
 
+#endif
+  m_trace_file[0] = 0;
+#ifdef _ANDROID_
+  // Number of events to keep, 0 disables the tracer
+  property_value[0] = NULL;
+  property_get("vidc.dec.debug.trace", property_value, "0");
+  if (atoi(property_value) > 0)
+  {
+    m_tracer.enable(atoi(property_value));
+    property_get("vidc.dec.debug.trace.file", m_trace_file, "");
+    DEBUG_PRINT_HIGH("vidc.dec.debug.trace is %d, dump to '%s'",
+                     atoi(property_value), m_trace_file);
+  }
+  // Per call site wait/hold times of m_lock, reported at deinit
+  property_value[0] = NULL;
+  property_get("vidc.dec.debug.lockstats", property_value, "0");
+  m_lock.set_instrumented(atoi(property_value) != 0);
+  // Hardware counters per pipeline stage, also switchable at run time
+  property_value[0] = NULL;
+  property_get("vidc.dec.debug.perf", property_value, "0");
+  if (atoi(property_value))
+    m_perf.enable(true);
 #endif
   memset(&m_cmp,0,sizeof(m_cmp));
   memset(&m_cb,0,sizeof(m_cb));
@@ -507,16 +557,21 @@ omx_vdec::omx_vdec(): m_state(OMX_StateInvalid),
   memset (&h264_scratch,0,sizeof (OMX_BUFFERHEADERTYPE));
   memset (m_hwdevice_name,0,sizeof(m_hwdevice_name));
   memset(&op_buf_rcnfg, 0 ,sizeof(vdec_allocatorproperty));
-  memset(m_demux_offsets, 0, ( sizeof(OMX_U32) * 8192) );
+  memset(&m_inp_arena, 0, sizeof(m_inp_arena));
+  memset(&m_out_arena, 0, sizeof(m_out_arena));
+  memset(m_mem_out_size, 0, sizeof(m_mem_out_size));
+  memset(m_mem_out_extradata, 0, sizeof(m_mem_out_extradata));
   m_demux_entries = 0;
+  m_demux_last_offset = 0;
 #ifdef _ANDROID_ICS_
   memset(&native_buffer, 0 ,(sizeof(struct nativebuffer) * MAX_NUM_INPUT_OUTPUT_BUFFERS));
 #endif
   drv_ctx.timestamp_adjust = false;
   drv_ctx.video_driver_fd = -1;
   m_vendor_config.pData = NULL;
-  pthread_mutex_init(&m_lock, NULL);
+  memset(&m_conceal_stats, 0, sizeof(m_conceal_stats));
   sem_init(&m_cmd_lock,0,0);
+  pthread_mutex_init(&m_parser_lock, NULL);
 #ifdef _ANDROID_
   char extradata_value[PROPERTY_VALUE_MAX] = {0};
   property_get("vidc.dec.debug.extradata", extradata_value, "0");
@@ -551,8 +606,9 @@ omx_vdec::~omx_vdec()
   pthread_join(msg_thread_id,NULL);
   DEBUG_PRINT_HIGH("Waiting on OMX Async Thread exit");
   pthread_join(async_thread_id,NULL);
-  pthread_mutex_destroy(&m_lock);
+  m_thread_stats.report(drv_ctx.kind);
   sem_destroy(&m_cmd_lock);
+  pthread_mutex_destroy(&m_parser_lock);
   if (perf_flag)
   {
     DEBUG_PRINT_HIGH("--> TOTAL PROCESSING TIME");
@@ -595,11 +651,12 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
     return;
   }
 
+  pThis->m_perf.begin(QOMX_VIDEO_PERF_EVENT);
   // Protect the shared queue data structure
   do
   {
     /*Read the message id's from the queue*/
-    pthread_mutex_lock(&pThis->m_lock);
+    VIDC_MUTEX_LOCK(&pThis->m_lock);
     qsize = pThis->m_cmd_q.m_size;
     if(qsize)
     {
@@ -623,7 +680,7 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
         pThis->m_etb_q.pop_entry(&p1,&p2,&ident);
       }
     }
-    pthread_mutex_unlock(&pThis->m_lock);
+    VIDC_MUTEX_UNLOCK(&pThis->m_lock);
 
     /*process message if we have one*/
     if(qsize > 0)
@@ -640,6 +697,7 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
                 pThis->m_state = (OMX_STATETYPE) p2;
                 DEBUG_PRINT_HIGH("\n OMX_CommandStateSet complete, m_state = %d",
                     pThis->m_state);
+                pThis->startup_state_reached(pThis->m_state);
                 pThis->m_cb.EventHandler(&pThis->m_cmp, pThis->m_app_data,
                                       OMX_EventCmdComplete, p1, p2, NULL);
                 break;
@@ -688,6 +746,9 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
                 break;
               case OMX_CommandPortEnable:
                 DEBUG_PRINT_HIGH("\n OMX_CommandPortEnable complete for port [%d]", p2);
+                if (p2 == OMX_CORE_OUTPUT_PORT_INDEX &&
+                    pThis->m_startup.end(QOMX_VIDEO_STARTUP_PORT_RECONFIG))
+                  pThis->m_startup.begin(QOMX_VIDEO_STARTUP_FIRST_FBD);
                 pThis->m_cb.EventHandler(&pThis->m_cmp, pThis->m_app_data,\
                                       OMX_EventCmdComplete, p1, p2, NULL );
                 break;
@@ -933,6 +994,7 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
                 // Send the callback now
                 BITMASK_CLEAR((&pThis->m_flags),OMX_COMPONENT_EXECUTE_PENDING);
                 pThis->m_state = OMX_StateExecuting;
+                pThis->startup_state_reached(OMX_StateExecuting);
                 pThis->m_cb.EventHandler(&pThis->m_cmp, pThis->m_app_data,
                                        OMX_EventCmdComplete,OMX_CommandStateSet,
                                        OMX_StateExecuting, NULL);
@@ -1056,6 +1118,8 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
           {
             if (pThis->in_reconfig)
             {
+              if (pThis->m_startup.end(QOMX_VIDEO_STARTUP_HEADER_PARSE))
+                pThis->m_startup.begin(QOMX_VIDEO_STARTUP_PORT_RECONFIG);
               if (pThis->m_cb.EventHandler) {
                 pThis->m_cb.EventHandler(&pThis->m_cmp, pThis->m_app_data,
                     OMX_EventPortSettingsChanged, OMX_CORE_OUTPUT_PORT_INDEX, 0, NULL );
@@ -1091,8 +1155,7 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
           } else {
             DEBUG_PRINT_ERROR("ERROR: %s()::EventHandler is NULL", __func__);
           }
-          pThis->prev_ts = LLONG_MAX;
-          pThis->rst_prev_ts = true;
+          pThis->m_pts.reset();
           break;
 
         case OMX_COMPONENT_GENERATE_HARDWARE_ERROR:
@@ -1113,14 +1176,14 @@ void omx_vdec::process_event_cb(void *ctxt, unsigned char id)
           break;
         }
       }
-    pthread_mutex_lock(&pThis->m_lock);
+    VIDC_MUTEX_LOCK(&pThis->m_lock);
     qsize = pThis->m_cmd_q.m_size;
     if (pThis->m_state != OMX_StatePause)
         qsize += (pThis->m_ftb_q.m_size + pThis->m_etb_q.m_size);
-    pthread_mutex_unlock(&pThis->m_lock);
+    VIDC_MUTEX_UNLOCK(&pThis->m_lock);
   }
   while(qsize>0);
-
+  pThis->m_perf.end();
 }
 
 
@@ -1165,6 +1228,7 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
   DEBUG_PRINT_HIGH("\n omx_vdec::component_init(): Start of New Playback : role  = %s : DEVICE = %s",
         role, device_name);
 
+  m_startup.begin(QOMX_VIDEO_STARTUP_DEVICE_OPEN);
   drv_ctx.video_driver_fd = open(device_name, O_RDWR | O_NONBLOCK);
 
   DEBUG_PRINT_HIGH("\n omx_vdec::component_init(): Open returned fd %d, errno %d",
@@ -1188,6 +1252,8 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
       DEBUG_PRINT_ERROR("Omx_vdec::Comp Init Returning failure, errno %d\n", errno);
       return OMX_ErrorInsufficientResources;
   }
+  m_startup.end(QOMX_VIDEO_STARTUP_DEVICE_OPEN);
+  m_startup.begin(QOMX_VIDEO_STARTUP_DEVICE_SETUP);
   drv_ctx.frame_rate.fps_numerator = DEFAULT_FPS;
   drv_ctx.frame_rate.fps_denominator = 1;
 
@@ -1195,12 +1261,6 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
 #ifdef INPUT_BUFFER_LOG
     strcpy(inputfilename, INPUT_BUFFER_FILE_NAME);
 #endif
-#ifdef OUTPUT_BUFFER_LOG
-  outputBufferFile1 = fopen (outputfilename, "ab");
-#endif
-#ifdef OUTPUT_EXTRADATA_LOG
-  outputExtradataFile = fopen (ouputextradatafilename, "ab");
-#endif
 
   // Copy the role information which provides the decoder kind
   strlcpy(drv_ctx.kind,role,128);
@@ -1361,11 +1421,9 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
     DEBUG_PRINT_ERROR("\nERROR:Unknown Component\n");
     eRet = OMX_ErrorInvalidComponentName;
   }
-#ifdef INPUT_BUFFER_LOG
-  inputBufferFile1 = fopen (inputfilename, "ab");
-#endif
   if (eRet == OMX_ErrorNone)
   {
+    init_dumps();
 #ifdef MAX_RES_720P
     drv_ctx.output_format = VDEC_YUV_FORMAT_NV12;
 
@@ -1557,6 +1615,7 @@ OMX_ERRORTYPE omx_vdec::component_init(OMX_STRING role)
   else
   {
     DEBUG_PRINT_HIGH("\n omx_vdec::component_init() success");
+    m_startup.end(QOMX_VIDEO_STARTUP_DEVICE_SETUP);
   }
 
   memset(&h264_mv_buff,0,sizeof(struct h264_mv_buffer));
@@ -1631,6 +1690,7 @@ OMX_ERRORTYPE  omx_vdec::send_command(OMX_IN OMX_HANDLETYPE hComp,
         "to invalid port: %d", param1);
       return OMX_ErrorBadPortIndex;
     }
+    m_recorder.command(cmd, param1);
     post_event((unsigned)cmd,(unsigned)param1,OMX_COMPONENT_GENERATE_COMMAND);
     sem_wait(&m_cmd_lock);
     DEBUG_PRINT_LOW("\n send_command: Command Processed\n");
@@ -1669,6 +1729,10 @@ OMX_ERRORTYPE  omx_vdec::send_command_proxy(OMX_IN OMX_HANDLETYPE hComp,
   {
     DEBUG_PRINT_HIGH("\n send_command_proxy(): OMX_CommandStateSet issued");
     DEBUG_PRINT_HIGH("\n Current State %d, Expected State %d", m_state, eState);
+    if (m_state == OMX_StateLoaded && eState == OMX_StateIdle)
+      m_startup.begin(QOMX_VIDEO_STARTUP_LOADED_TO_IDLE);
+    else if (m_state == OMX_StateIdle && eState == OMX_StateExecuting)
+      m_startup.begin(QOMX_VIDEO_STARTUP_IDLE_TO_EXECUTING);
     /***************************/
     /* Current State is Loaded */
     /***************************/
@@ -2250,7 +2314,8 @@ bool omx_vdec::execute_output_flush()
   bool bRet = true;
 
   /*Generate FBD for all Buffers in the FTBq*/
-  pthread_mutex_lock(&m_lock);
+  m_live_stats.output_flushed();
+  VIDC_MUTEX_LOCK(&m_lock);
   DEBUG_PRINT_LOW("\n Initiate Output Flush");
   while (m_ftb_q.m_size)
   {
@@ -2268,13 +2333,12 @@ bool omx_vdec::execute_output_flush()
       fill_buffer_done(&m_cmp,(OMX_BUFFERHEADERTYPE *)p1);
     }
   }
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   output_flush_progress = false;
 
   if (arbitrary_bytes)
   {
-    prev_ts = LLONG_MAX;
-    rst_prev_ts = true;
+    m_pts.reset();
   }
   DEBUG_PRINT_HIGH("\n OMX flush o/p Port complete PenBuf(%d)", pending_output_buffers);
   return bRet;
@@ -2301,8 +2365,9 @@ bool omx_vdec::execute_input_flush()
 
   /*Generate EBD for all Buffers in the ETBq*/
   DEBUG_PRINT_LOW("\n Initiate Input Flush \n");
+  m_live_stats.input_flushed();
 
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
   DEBUG_PRINT_LOW("\n Check if the Queue is empty \n");
   while (m_etb_q.m_size)
   {
@@ -2338,7 +2403,6 @@ bool omx_vdec::execute_input_flush()
     frame_count = 0;
     h264_last_au_ts = LLONG_MAX;
     h264_last_au_flags = 0;
-    memset(m_demux_offsets, 0, ( sizeof(OMX_U32) * 8192) );
     m_demux_entries = 0;
     DEBUG_PRINT_LOW("\n Initialize parser");
     if (m_frame_parser.mutils)
@@ -2366,12 +2430,11 @@ bool omx_vdec::execute_input_flush()
     }
     m_frame_parser.flush();
   }
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   input_flush_progress = false;
   if (!arbitrary_bytes)
   {
-    prev_ts = LLONG_MAX;
-    rst_prev_ts = true;
+    m_pts.reset();
   }
 #ifdef _ANDROID_
   if (m_debug_timestamp)
@@ -2406,29 +2469,32 @@ bool omx_vdec::post_event(unsigned int p1,
   bool bRet      =                      false;
 
 
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
 
   if (id == OMX_COMPONENT_GENERATE_FTB ||
       id == OMX_COMPONENT_GENERATE_FBD)
   {
     m_ftb_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_FTB, m_ftb_q.m_size);
   }
   else if (id == OMX_COMPONENT_GENERATE_ETB ||
            id == OMX_COMPONENT_GENERATE_EBD ||
            id == OMX_COMPONENT_GENERATE_ETB_ARBITRARY)
   {
     m_etb_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_ETB, m_etb_q.m_size);
   }
   else
   {
     m_cmd_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_CMD, m_cmd_q.m_size);
   }
 
   bRet = true;
   DEBUG_PRINT_LOW("\n Value of this pointer in post_event %p",this);
   post_message(this, id);
 
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
 
   return bRet;
 }
@@ -2636,7 +2702,9 @@ OMX_ERRORTYPE  omx_vdec::get_parameter(OMX_IN OMX_HANDLETYPE     hComp,
       DEBUG_PRINT_LOW("get_parameter: OMX_IndexParamPortDefinition\n");
       eRet = update_portdef(portDefn);
       if (eRet == OMX_ErrorNone)
+      {
           m_port_def = *portDefn;
+      }
       break;
     }
     case OMX_IndexParamVideoInit:
@@ -2934,6 +3002,7 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
         DEBUG_PRINT_ERROR("Set Param in Invalid State \n");
         return OMX_ErrorIncorrectStateOperation;
     }
+  m_recorder.parameter(VIDC_RECORD_SET_PARAMETER, paramIndex, paramData);
   switch(paramIndex)
   {
     case OMX_IndexParamPortDefinition:
@@ -2956,7 +3025,10 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
               drv_ctx.op_buf.buffer_size = portDefn->nBufferSize;
               eRet = set_buffer_req(&drv_ctx.op_buf);
               if (eRet == OMX_ErrorNone)
+              {
                   m_port_def = *portDefn;
+                  m_extradata_tmpl_dirty = true;
+              }
           }
           else
           {
@@ -2987,16 +3059,16 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
               drv_ctx.frame_rate.fps_numerator = (int)
                   drv_ctx.frame_rate.fps_numerator / drv_ctx.frame_rate.fps_denominator;
               drv_ctx.frame_rate.fps_denominator = 1;
-            frm_int = drv_ctx.frame_rate.fps_denominator * 1e6 /
-                      drv_ctx.frame_rate.fps_numerator;
+            m_pts.set_frame_interval(drv_ctx.frame_rate.fps_denominator * 1e6 /
+                                     drv_ctx.frame_rate.fps_numerator);
             ioctl_msg.in = &drv_ctx.frame_rate;
             if (ioctl (drv_ctx.video_driver_fd, VDEC_IOCTL_SET_FRAME_RATE,
                        (void*)&ioctl_msg) < 0)
             {
               DEBUG_PRINT_ERROR("Setting frame rate to driver failed");
             }
-            DEBUG_PRINT_LOW("set_parameter: frm_int(%u) fps(%.2f)",
-                             frm_int, drv_ctx.frame_rate.fps_numerator /
+            DEBUG_PRINT_LOW("set_parameter: frm_int(%lu) fps(%.2f)",
+                             m_pts.get_min_interval(), drv_ctx.frame_rate.fps_numerator /
                              (float)drv_ctx.frame_rate.fps_denominator);
         }
          DEBUG_PRINT_LOW("set_parameter: OMX_IndexParamPortDefinition IP port\n");
@@ -3381,6 +3453,41 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
           eRet = OMX_ErrorUnsupportedSetting;
       }
       break;
+    case QOMX_IndexParamVideoStreamInfoExtraData:
+#ifdef PROCESS_EXTRADATA_IN_OUTPUT_PORT
+      if(!secure_mode)
+          eRet = enable_extradata(OMX_STREAMINFO_EXTRADATA,
+                              ((QOMX_ENABLETYPE *)paramData)->bEnable);
+      else {
+          DEBUG_PRINT_ERROR("\n secure mode setting not supported");
+          eRet = OMX_ErrorUnsupportedSetting;
+      }
+#else
+      // The records are only produced by the output port extradata path
+      DEBUG_PRINT_ERROR("\n stream info extradata not supported in this build");
+      eRet = OMX_ErrorUnsupportedSetting;
+#endif
+      break;
+    case QOMX_IndexParamVideoSeparateExtradata:
+      {
+        bool enable = (((QOMX_ENABLETYPE *)paramData)->bEnable == OMX_TRUE);
+        DEBUG_PRINT_HIGH("set_parameter: Separate extradata %d", enable);
+        if (m_state != OMX_StateLoaded || m_out_mem_ptr)
+        {
+          DEBUG_PRINT_ERROR("ERROR: separate extradata allowed in Loaded state"
+                            " before output buffers are allocated");
+          eRet = OMX_ErrorIncorrectStateOperation;
+        }
+        else if (enable != m_sep_extradata)
+        {
+          m_sep_extradata = enable;
+          // Recompute from the driver size, get_extradata_size() now
+          // leaves the OMX extradata out of (or puts it back into) frames
+          if (get_omx_extradata_size())
+            eRet = get_buffer_req(&drv_ctx.op_buf);
+        }
+      }
+      break;
     case OMX_QcomIndexParamVideoDivx:
       {
 #ifdef MAX_RES_720P
@@ -3487,7 +3594,7 @@ OMX_ERRORTYPE  omx_vdec::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
         QOMX_INDEXTIMESTAMPREORDER *reorder = (QOMX_INDEXTIMESTAMPREORDER *)paramData;
         if (drv_ctx.picture_order == QOMX_VIDEO_DISPLAY_ORDER) {
           if (reorder->bEnable == OMX_TRUE) {
-              frm_int =0;
+              m_pts.set_frame_interval(0);
               time_stamp_dts.set_timestamp_reorder_mode(true);
           }
           else
@@ -3590,7 +3697,10 @@ OMX_ERRORTYPE  omx_vdec::get_config(OMX_IN OMX_HANDLETYPE      hComp,
       {
         OMX_QCOM_FRAME_PACK_ARRANGEMENT *configFmt =
           (OMX_QCOM_FRAME_PACK_ARRANGEMENT *) configData;
+        pthread_mutex_lock(&m_parser_lock);
+        parse_deferred_extradata();
         h264_parser->get_frame_pack_data(configFmt);
+        pthread_mutex_unlock(&m_parser_lock);
       }
       else
       {
@@ -3598,6 +3708,122 @@ OMX_ERRORTYPE  omx_vdec::get_config(OMX_IN OMX_HANDLETYPE      hComp,
       }
       break;
     }
+    case QOMX_IndexConfigVideoMemoryStats:
+    {
+      QOMX_VIDEO_MEMORY_STATS *mem_stats =
+        (QOMX_VIDEO_MEMORY_STATS *) configData;
+      eRet = m_mem_stats.get_stats(mem_stats);
+      break;
+    }
+    case QOMX_IndexConfigVideoTrace:
+    {
+      eRet = m_tracer.get_config((QOMX_VIDEO_TRACE *) configData);
+      break;
+    }
+    case QOMX_IndexConfigVideoLockStats:
+    {
+      eRet = m_lock.get_stats((QOMX_VIDEO_LOCK_STATS *) configData);
+      break;
+    }
+    case QOMX_IndexConfigVideoPerfStats:
+    {
+      eRet = m_perf.get_stats((QOMX_VIDEO_PERF_STATS *) configData);
+      break;
+    }
+    case QOMX_IndexConfigVideoThreadStats:
+    {
+      eRet = m_thread_stats.get_stats((QOMX_VIDEO_THREAD_STATS *) configData);
+      break;
+    }
+    case QOMX_IndexConfigVideoStartupStats:
+    {
+      eRet = m_startup.get_stats((QOMX_VIDEO_STARTUP_STATS *) configData);
+      break;
+    }
+    case QOMX_IndexConfigVideoDump:
+    {
+      QOMX_VIDEO_DUMP *dump = (QOMX_VIDEO_DUMP *) configData;
+      if (dump->nPortIndex == OMX_CORE_INPUT_PORT_INDEX)
+        eRet = m_input_dump.get_config(dump);
+      else if (dump->nPortIndex == OMX_CORE_OUTPUT_PORT_INDEX)
+        eRet = m_output_dump.get_config(dump);
+      else
+        eRet = OMX_ErrorBadPortIndex;
+      break;
+    }
+    case QOMX_IndexConfigVideoLiveStats:
+    {
+      QOMX_VIDEO_LIVE_STATS *live_stats =
+        (QOMX_VIDEO_LIVE_STATS *) configData;
+      eRet = m_live_stats.get_stats(live_stats);
+      if (eRet != OMX_ErrorNone)
+        break;
+      live_stats->sQueue[QOMX_VIDEO_QUEUE_ETB].nCurrent = m_etb_q.m_size;
+      live_stats->sQueue[QOMX_VIDEO_QUEUE_FTB].nCurrent = m_ftb_q.m_size;
+      live_stats->sQueue[QOMX_VIDEO_QUEUE_CMD].nCurrent = m_cmd_q.m_size;
+      live_stats->nPendingInputBuffers = pending_input_buffers;
+      live_stats->nPendingOutputBuffers = pending_output_buffers;
+      live_stats->nConcealedMBs = m_conceal_stats.nConcealedMBs;
+      break;
+    }
+    case QOMX_IndexConfigVideoConcealStats:
+    {
+      QOMX_VIDEO_CONCEAL_STATS *conceal_stats =
+        (QOMX_VIDEO_CONCEAL_STATS *) configData;
+      conceal_stats->nLastConcealedMBs = m_conceal_stats.nLastConcealedMBs;
+      conceal_stats->nLastConcealPercent = m_conceal_stats.nLastConcealPercent;
+      conceal_stats->nFrames = m_conceal_stats.nFrames;
+      conceal_stats->nFramesWithErrors = m_conceal_stats.nFramesWithErrors;
+      conceal_stats->nConcealedMBs = m_conceal_stats.nConcealedMBs;
+      break;
+    }
+    case QOMX_IndexConfigVideoStreamInfo:
+    {
+      QOMX_VIDEO_STREAM_INFO *stream_info =
+        (QOMX_VIDEO_STREAM_INFO *) configData;
+      if (drv_ctx.decoder_format != VDEC_CODECTYPE_H264 || !h264_parser)
+      {
+        DEBUG_PRINT_ERROR("get_config: Stream info not supported for non H264 codecs");
+        eRet = OMX_ErrorUnsupportedIndex;
+        break;
+      }
+      stream_info->nFrameRate = 0;
+      stream_info->nNumReorderFrames = 0;
+      stream_info->nMaxDecFrameBuffering = 0;
+      memset(&stream_info->sAspectRatio, 0, sizeof(stream_info->sAspectRatio));
+      pthread_mutex_lock(&m_parser_lock);
+      parse_deferred_extradata();
+      h264_parser->get_frame_rate(&stream_info->nFrameRate);
+      h264_parser->fill_aspect_ratio_info(&stream_info->sAspectRatio);
+      h264_parser->get_reorder_depth(&stream_info->nNumReorderFrames,
+                                     &stream_info->nMaxDecFrameBuffering);
+      pthread_mutex_unlock(&m_parser_lock);
+      break;
+    }
+    case QOMX_IndexConfigVideoExtradataBuffer:
+    {
+      QOMX_VIDEO_EXTRADATA_BUFFER *extra_buf =
+        (QOMX_VIDEO_EXTRADATA_BUFFER *) configData;
+      if (extra_buf->nPortIndex != OMX_CORE_OUTPUT_PORT_INDEX)
+      {
+        DEBUG_PRINT_ERROR("get_config: Extradata buffer on port %lu",
+                          extra_buf->nPortIndex);
+        eRet = OMX_ErrorBadPortIndex;
+        break;
+      }
+      extra_buf->pExtraData =
+        (OMX_U8 *)get_separate_extradata(extra_buf->pBufferHdr);
+      if (!extra_buf->pExtraData)
+      {
+        DEBUG_PRINT_ERROR("get_config: No extradata buffer for %p",
+                          extra_buf->pBufferHdr);
+        extra_buf->nAllocLen = 0;
+        eRet = OMX_ErrorBadParameter;
+        break;
+      }
+      extra_buf->nAllocLen = m_out_extradata_stride;
+      break;
+    }
     default:
     {
       DEBUG_PRINT_ERROR("get_config: unknown param %d\n",configIndex);
@@ -3636,6 +3862,50 @@ OMX_ERRORTYPE  omx_vdec::set_config(OMX_IN OMX_HANDLETYPE      hComp,
   OMX_VIDEO_CONFIG_NALSIZE *pNal;
 
   DEBUG_PRINT_LOW("\n Set Config Called");
+  m_recorder.parameter(VIDC_RECORD_SET_CONFIG, configIndex, configData);
+
+  if (configIndex == (OMX_INDEXTYPE)QOMX_IndexConfigVideoTrace)
+  {
+    // Tracing is switched on and dumped while decoding
+    ret = m_tracer.set_config((QOMX_VIDEO_TRACE *) configData, drv_ctx.kind);
+    if (ret != OMX_ErrorNone)
+      DEBUG_PRINT_ERROR("set_config: trace config failed %x", ret);
+    return ret;
+  }
+
+  if (configIndex == (OMX_INDEXTYPE)QOMX_IndexConfigVideoPerfStats)
+  {
+    ret = m_perf.set_config((QOMX_VIDEO_PERF_STATS *) configData);
+    if (ret != OMX_ErrorNone)
+      DEBUG_PRINT_ERROR("set_config: perf counters unavailable %x", ret);
+    return ret;
+  }
+
+  if (configIndex == (OMX_INDEXTYPE)QOMX_IndexConfigVideoDump)
+  {
+    // Dumps are opened, sampled and paused while decoding
+    QOMX_VIDEO_DUMP *dump = (QOMX_VIDEO_DUMP *) configData;
+    if (!dump)
+      ret = OMX_ErrorBadParameter;
+    else if (dump->nPortIndex == OMX_CORE_INPUT_PORT_INDEX)
+      ret = m_input_dump.set_config(dump);
+    else if (dump->nPortIndex == OMX_CORE_OUTPUT_PORT_INDEX)
+    {
+      ret = m_output_dump.set_config(dump);
+      // An extradata dump follows the frames it belongs to
+      if (ret == OMX_ErrorNone && m_extradata_dump.is_open())
+      {
+        m_extradata_dump.set_sampling(dump->nSampleInterval,
+                                      dump->bErrorsOnly == OMX_TRUE);
+        m_extradata_dump.set_active(dump->bEnable == OMX_TRUE);
+      }
+    }
+    else
+      ret = OMX_ErrorBadPortIndex;
+    if (ret != OMX_ErrorNone)
+      DEBUG_PRINT_ERROR("set_config: dump config failed %x", ret);
+    return ret;
+  }
 
   if (m_state == OMX_StateExecuting)
   {
@@ -3802,6 +4072,45 @@ OMX_ERRORTYPE  omx_vdec::get_extension_index(OMX_IN OMX_HANDLETYPE      hComp,
     else if (!strncmp(paramName, "OMX.QCOM.index.param.video.SyncFrameDecodingMode",sizeof("OMX.QCOM.index.param.video.SyncFrameDecodingMode") - 1)) {
         *indexType = (OMX_INDEXTYPE)OMX_QcomIndexParamVideoSyncFrameDecodingMode;
     }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_MEMORY_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_MEMORY_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoMemoryStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_PARAM_VIDEO_SEPARATE_EXTRADATA,sizeof(OMX_QCOM_INDEX_PARAM_VIDEO_SEPARATE_EXTRADATA) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexParamVideoSeparateExtradata;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_EXTRADATA_BUFFER,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_EXTRADATA_BUFFER) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoExtradataBuffer;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_PARAM_VIDEO_STREAM_INFO_EXTRADATA,sizeof(OMX_QCOM_INDEX_PARAM_VIDEO_STREAM_INFO_EXTRADATA) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexParamVideoStreamInfoExtraData;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_STREAM_INFO,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_STREAM_INFO) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoStreamInfo;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_CONCEAL_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_CONCEAL_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoConcealStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_TRACE,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_TRACE) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoTrace;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_LIVE_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_LIVE_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoLiveStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_LOCK_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_LOCK_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoLockStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoPerfStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoThreadStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_STARTUP_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_STARTUP_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoStartupStats;
+    }
+    else if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_DUMP,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_DUMP) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoDump;
+    }
 #ifdef MAX_RES_1080P
     else if (!strncmp(paramName, "OMX.QCOM.index.param.IndexExtraData",sizeof("OMX.QCOM.index.param.IndexExtraData") - 1))
     {
@@ -4022,6 +4331,7 @@ OMX_ERRORTYPE  omx_vdec::use_output_buffer(
               return OMX_ErrorInsufficientResources;
             }
         }
+        update_output_mem_stats(i, true);
         drv_ctx.ptr_outputbuffer[i].offset = 0;
         privateAppData = appData;
      }
@@ -4198,6 +4508,7 @@ OMX_ERRORTYPE  omx_vdec::use_buffer(
     DEBUG_PRINT_ERROR("Use Buffer in Invalid State\n");
     return OMX_ErrorInvalidState;
   }
+  OMX_U64 alloc_start = vidc_startup_stats::now_us();
   if(port == OMX_CORE_INPUT_PORT_INDEX)
     error = use_input_heap_buffers(hComp, bufferHdr, port, appData, bytes, buffer);
   else if(port == OMX_CORE_OUTPUT_PORT_INDEX)
@@ -4210,6 +4521,8 @@ OMX_ERRORTYPE  omx_vdec::use_buffer(
   DEBUG_PRINT_LOW("Use Buffer: port %u, buffer %p, eRet %d", port, *bufferHdr, error);
   if(error == OMX_ErrorNone)
   {
+    m_startup.add(QOMX_VIDEO_STARTUP_BUFFER_ALLOC, alloc_start);
+    m_recorder.buffer(VIDC_RECORD_USE_BUFFER, port, *bufferHdr);
     if(allocate_done() && BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
     {
       // Send the callback now
@@ -4288,14 +4601,23 @@ OMX_ERRORTYPE omx_vdec::free_input_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
                         drv_ctx.ptr_inputbuffer[index].bufferaddr);
            munmap (drv_ctx.ptr_inputbuffer[index].bufferaddr,
                    drv_ctx.ptr_inputbuffer[index].mmaped_size);
+           m_mem_stats.unmapped(QOMX_VIDEO_MEM_INPUT,
+                   drv_ctx.ptr_inputbuffer[index].mmaped_size);
        }
+       m_mem_stats.released(QOMX_VIDEO_MEM_INPUT,
+                   drv_ctx.ptr_inputbuffer[index].mmaped_size);
        close (drv_ctx.ptr_inputbuffer[index].pmem_fd);
        drv_ctx.ptr_inputbuffer[index].pmem_fd = -1;
        if (m_desc_buffer_ptr && m_desc_buffer_ptr[index].buf_addr)
        {
+         m_mem_stats.unmapped(QOMX_VIDEO_MEM_DESC,
+                   m_desc_buffer_ptr[index].alloc_size);
+         m_mem_stats.released(QOMX_VIDEO_MEM_DESC,
+                   m_desc_buffer_ptr[index].alloc_size);
          free(m_desc_buffer_ptr[index].buf_addr);
          m_desc_buffer_ptr[index].buf_addr = NULL;
          m_desc_buffer_ptr[index].desc_data_size = 0;
+         m_desc_buffer_ptr[index].alloc_size = 0;
        }
 #ifdef USE_ION
        free_ion_memory(&drv_ctx.ip_buf_ion_info[index]);
@@ -4359,6 +4681,7 @@ OMX_ERRORTYPE omx_vdec::free_output_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
                     munmap (drv_ctx.ptr_outputbuffer[index].bufferaddr,
                             drv_ctx.ptr_outputbuffer[index].mmaped_size);
                }
+               update_output_mem_stats(index, false);
 #ifdef _ANDROID_
                 m_heap_ptr[index].video_heap_ptr = NULL;
                 m_heap_count = m_heap_count - 1;
@@ -4514,38 +4837,12 @@ OMX_ERRORTYPE  omx_vdec::allocate_input_buffer(
       drv_ctx.ip_buf.actualcount,
       drv_ctx.ip_buf.buffer_size);
 
-    m_inp_mem_ptr = (OMX_BUFFERHEADERTYPE*) \
-    calloc( (sizeof(OMX_BUFFERHEADERTYPE)), drv_ctx.ip_buf.actualcount);
-
-    if (m_inp_mem_ptr == NULL)
+    if (allocate_input_arena() != OMX_ErrorNone)
     {
       return OMX_ErrorInsufficientResources;
     }
-
-    drv_ctx.ptr_inputbuffer = (struct vdec_bufferpayload *) \
-    calloc ((sizeof (struct vdec_bufferpayload)),drv_ctx.ip_buf.actualcount);
-
-    if (drv_ctx.ptr_inputbuffer == NULL)
-    {
-      return OMX_ErrorInsufficientResources;
-    }
-#ifdef USE_ION
-    drv_ctx.ip_buf_ion_info = (struct vdec_ion *) \
-    calloc ((sizeof (struct vdec_ion)),drv_ctx.ip_buf.actualcount);
-
-    if (drv_ctx.ip_buf_ion_info == NULL)
-    {
-      return OMX_ErrorInsufficientResources;
-    }
-#endif
-
-    for (i=0; i < drv_ctx.ip_buf.actualcount; i++)
-    {
-      drv_ctx.ptr_inputbuffer [i].pmem_fd = -1;
-#ifdef USE_ION
-      drv_ctx.ip_buf_ion_info[i].ion_device_fd = -1;
-#endif
-    }
+    // Every queued input plus the frames a decoder may hold back
+    time_stamp_dts.set_depth(drv_ctx.ip_buf.actualcount + TS_REORDER_DEPTH);
   }
 
   for(i=0; i< drv_ctx.ip_buf.actualcount; i++)
@@ -4613,6 +4910,9 @@ OMX_ERRORTYPE  omx_vdec::allocate_input_buffer(
           return OMX_ErrorInsufficientResources;
         }
     }
+    m_mem_stats.allocated(QOMX_VIDEO_MEM_INPUT, drv_ctx.ip_buf.buffer_size);
+    if (!secure_mode)
+        m_mem_stats.mapped(QOMX_VIDEO_MEM_INPUT, drv_ctx.ip_buf.buffer_size);
     *bufferHdr = (m_inp_mem_ptr + i);
     if (secure_mode)
         drv_ctx.ptr_inputbuffer [i].bufferaddr = *bufferHdr;
@@ -4691,171 +4991,44 @@ OMX_ERRORTYPE  omx_vdec::allocate_output_buffer(
   struct vdec_ioctl_msg ioctl_msg = {NULL,NULL};
   struct vdec_setbuffer_cmd setbuffers;
 
-  int nBufHdrSize        = 0;
-  int nPlatformEntrySize = 0;
-  int nPlatformListSize  = 0;
-  int nPMEMInfoSize = 0;
   int pmem_fd = -1;
   unsigned char *pmem_baseaddress = NULL;
 
-  OMX_QCOM_PLATFORM_PRIVATE_LIST      *pPlatformList;
-  OMX_QCOM_PLATFORM_PRIVATE_ENTRY     *pPlatformEntry;
-  OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *pPMEMInfo;
-
   if (!m_out_mem_ptr)
   {
     DEBUG_PRINT_HIGH("\n Allocate o/p buffer Header: Cnt(%d) Sz(%d)",
       drv_ctx.op_buf.actualcount,
       drv_ctx.op_buf.buffer_size);
 
-    DEBUG_PRINT_LOW("Allocating First Output Buffer(%d)\n",
-      drv_ctx.op_buf.actualcount);
-
-    nBufHdrSize        = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_BUFFERHEADERTYPE);
-
-    nPMEMInfoSize      = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO);
-    nPlatformListSize  = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_LIST);
-    nPlatformEntrySize = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_ENTRY);
-
-    DEBUG_PRINT_LOW("TotalBufHdr %d BufHdrSize %d PMEM %d PL %d\n",nBufHdrSize,
-                         sizeof(OMX_BUFFERHEADERTYPE),
-                         nPMEMInfoSize,
-                         nPlatformListSize);
-    DEBUG_PRINT_LOW("PE %d OutputBuffer Count %d \n",nPlatformEntrySize,
-                         drv_ctx.op_buf.actualcount);
-
-    m_out_mem_ptr = (OMX_BUFFERHEADERTYPE  *)calloc(nBufHdrSize,1);
-    // Alloc mem for platform specific info
-    char *pPtr=NULL;
-    pPtr = (char*) calloc(nPlatformListSize + nPlatformEntrySize +
-                                     nPMEMInfoSize,1);
-    drv_ctx.ptr_outputbuffer = (struct vdec_bufferpayload *)\
-      calloc (sizeof(struct vdec_bufferpayload),
-      drv_ctx.op_buf.actualcount);
-    drv_ctx.ptr_respbuffer = (struct vdec_output_frameinfo  *)\
-      calloc (sizeof (struct vdec_output_frameinfo),
-      drv_ctx.op_buf.actualcount);
-#ifdef USE_ION
-    drv_ctx.op_buf_ion_info = (struct vdec_ion *)\
-      calloc (sizeof(struct vdec_ion),
-      drv_ctx.op_buf.actualcount);
-#endif
+    if (allocate_output_arena() != OMX_ErrorNone)
+    {
+      return OMX_ErrorInsufficientResources;
+    }
 #ifdef _ANDROID_
     m_heap_ptr = (struct vidc_heap *)\
        calloc (sizeof(struct vidc_heap),
       drv_ctx.op_buf.actualcount);
+    if (!m_heap_ptr)
+    {
+      DEBUG_PRINT_ERROR("\n Output heap pointer alloc failed");
+      free_output_buffer_header();
+      return OMX_ErrorInsufficientResources;
+    }
 #endif
-
-    if(m_out_mem_ptr && pPtr && drv_ctx.ptr_outputbuffer
-       && drv_ctx.ptr_respbuffer && m_heap_ptr)
-    {
-      drv_ctx.ptr_outputbuffer[0].mmaped_size =
-        (drv_ctx.op_buf.buffer_size *
-         drv_ctx.op_buf.actualcount);
-      bufHdr          =  m_out_mem_ptr;
-      m_platform_list = (OMX_QCOM_PLATFORM_PRIVATE_LIST *)(pPtr);
-      m_platform_entry= (OMX_QCOM_PLATFORM_PRIVATE_ENTRY *)
-                        (((char *) m_platform_list)  + nPlatformListSize);
-      m_pmem_info     = (OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *)
-                        (((char *) m_platform_entry) + nPlatformEntrySize);
-      pPlatformList   = m_platform_list;
-      pPlatformEntry  = m_platform_entry;
-      pPMEMInfo       = m_pmem_info;
-
-      DEBUG_PRINT_LOW("Memory Allocation Succeeded for OUT port%p\n",m_out_mem_ptr);
-
-      // Settting the entire storage nicely
-      DEBUG_PRINT_LOW("bHdr %p OutMem %p PE %p\n",bufHdr, m_out_mem_ptr,pPlatformEntry);
-      DEBUG_PRINT_LOW(" Pmem Info = %p \n",pPMEMInfo);
-      for(i=0; i < drv_ctx.op_buf.actualcount ; i++)
-      {
-        bufHdr->nSize              = sizeof(OMX_BUFFERHEADERTYPE);
-        bufHdr->nVersion.nVersion  = OMX_SPEC_VERSION;
-        // Set the values when we determine the right HxW param
-        bufHdr->nAllocLen          = 0;
-        bufHdr->nFilledLen         = 0;
-        bufHdr->pAppPrivate        = NULL;
-        bufHdr->nOutputPortIndex   = OMX_CORE_OUTPUT_PORT_INDEX;
-        // Platform specific PMEM Information
-        // Initialize the Platform Entry
-        //DEBUG_PRINT_LOW("Initializing the Platform Entry for %d\n",i);
-        pPlatformEntry->type       = OMX_QCOM_PLATFORM_PRIVATE_PMEM;
-        pPlatformEntry->entry      = pPMEMInfo;
-        // Initialize the Platform List
-        pPlatformList->nEntries    = 1;
-        pPlatformList->entryList   = pPlatformEntry;
-        // Keep pBuffer NULL till vdec is opened
-        bufHdr->pBuffer            = NULL;
-
-        pPMEMInfo->offset          =  0;
-        pPMEMInfo->pmem_fd = 0;
-        bufHdr->pPlatformPrivate = pPlatformList;
-        drv_ctx.ptr_outputbuffer[i].pmem_fd = -1;
-#ifdef USE_ION
-        drv_ctx.op_buf_ion_info[i].ion_device_fd =-1;
-#endif
-        /*Create a mapping between buffers*/
-        bufHdr->pOutputPortPrivate = &drv_ctx.ptr_respbuffer[i];
-        drv_ctx.ptr_respbuffer[i].client_data = (void *)\
-                                            &drv_ctx.ptr_outputbuffer[i];
-#ifdef _ANDROID_
-        m_heap_ptr[i].video_heap_ptr = NULL;
-#endif
-        // Move the buffer and buffer header pointers
-        bufHdr++;
-        pPMEMInfo++;
-        pPlatformEntry++;
-        pPlatformList++;
-      }
+    drv_ctx.ptr_outputbuffer[0].mmaped_size =
+      (drv_ctx.op_buf.buffer_size *
+       drv_ctx.op_buf.actualcount);
 #ifdef MAX_RES_1080P
-      if(eRet == OMX_ErrorNone && drv_ctx.decoder_format == VDEC_CODECTYPE_H264)
-      {
-        //Allocate the h264_mv_buffer
-        eRet = vdec_alloc_h264_mv();
-        if(eRet) {
-          DEBUG_PRINT_ERROR("ERROR in allocating MV buffers\n");
-          return OMX_ErrorInsufficientResources;
-        }
-      }
-#endif
-    }
-    else
+    if(drv_ctx.decoder_format == VDEC_CODECTYPE_H264)
     {
-      DEBUG_PRINT_ERROR("Output buf mem alloc failed[0x%x][0x%x]\n",\
-                                        m_out_mem_ptr, pPtr);
-      if(m_out_mem_ptr)
-      {
-        free(m_out_mem_ptr);
-        m_out_mem_ptr = NULL;
-      }
-      if(pPtr)
-      {
-        free(pPtr);
-        pPtr = NULL;
-      }
-      if(drv_ctx.ptr_outputbuffer)
-      {
-        free(drv_ctx.ptr_outputbuffer);
-        drv_ctx.ptr_outputbuffer = NULL;
-      }
-      if(drv_ctx.ptr_respbuffer)
-      {
-        free(drv_ctx.ptr_respbuffer);
-        drv_ctx.ptr_respbuffer = NULL;
-      }
-#ifdef USE_ION
-      if (drv_ctx.op_buf_ion_info) {
-        DEBUG_PRINT_LOW("\n Free o/p ion context");
-	free(drv_ctx.op_buf_ion_info);
-        drv_ctx.op_buf_ion_info = NULL;
+      //Allocate the h264_mv_buffer
+      eRet = vdec_alloc_h264_mv();
+      if(eRet) {
+        DEBUG_PRINT_ERROR("ERROR in allocating MV buffers\n");
+        return OMX_ErrorInsufficientResources;
       }
-#endif
-      return OMX_ErrorInsufficientResources;
     }
+#endif
   }
 
   for (i=0; i< drv_ctx.op_buf.actualcount; i++)
@@ -4927,6 +5100,7 @@ OMX_ERRORTYPE  omx_vdec::allocate_output_buffer(
         }
     }
 
+    update_output_mem_stats(i, true);
     *bufferHdr = (m_out_mem_ptr + i);
     if (secure_mode)
         drv_ctx.ptr_outputbuffer [i].bufferaddr = *bufferHdr;
@@ -5020,6 +5194,7 @@ OMX_ERRORTYPE  omx_vdec::allocate_buffer(OMX_IN OMX_HANDLETYPE                hC
         return OMX_ErrorInvalidState;
     }
 
+    OMX_U64 alloc_start = vidc_startup_stats::now_us();
     if(port == OMX_CORE_INPUT_PORT_INDEX)
     {
       if (arbitrary_bytes)
@@ -5043,6 +5218,8 @@ OMX_ERRORTYPE  omx_vdec::allocate_buffer(OMX_IN OMX_HANDLETYPE                hC
     DEBUG_PRINT_LOW("Checking for Output Allocate buffer Done");
     if(eRet == OMX_ErrorNone)
     {
+        m_startup.add(QOMX_VIDEO_STARTUP_BUFFER_ALLOC, alloc_start);
+        m_recorder.buffer(VIDC_RECORD_ALLOCATE_BUFFER, port, *bufferHdr);
         if(allocate_done()){
             if(BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
             {
@@ -5099,6 +5276,7 @@ OMX_ERRORTYPE  omx_vdec::free_buffer(OMX_IN OMX_HANDLETYPE         hComp,
     unsigned int nPortIndex;
 
     DEBUG_PRINT_LOW("In for decoder free_buffer \n");
+    m_recorder.buffer(VIDC_RECORD_FREE_BUFFER, port, buffer);
 
     if(m_state == OMX_StateIdle &&
        (BITMASK_PRESENT(&m_flags ,OMX_COMPONENT_LOADING_PENDING)))
@@ -5290,6 +5468,8 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
     return OMX_ErrorBadPortIndex;
   }
 
+  // Recorded as the client handed it in, before any decryption
+  m_recorder.etb(buffer);
 #ifdef _ANDROID_
   if(iDivXDrmDecrypt)
   {
@@ -5300,14 +5480,10 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
     }
   }
 #endif //_ANDROID_
-  if (perf_flag)
+  if (m_startup.end(QOMX_VIDEO_STARTUP_FIRST_ETB))
   {
-    if (!latency)
-    {
-      dec_time.stop();
-      latency = dec_time.processing_time_us();
-      dec_time.start();
-    }
+    m_startup.begin(QOMX_VIDEO_STARTUP_HEADER_PARSE);
+    m_startup.begin(QOMX_VIDEO_STARTUP_FIRST_FBD);
   }
 
   if (arbitrary_bytes)
@@ -5339,6 +5515,8 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
 
   DEBUG_PRINT_LOW("[ETB] BHdr(%p) pBuf(%p) nTS(%lld) nFL(%lu)",
     buffer, buffer->pBuffer, buffer->nTimeStamp, buffer->nFilledLen);
+  m_tracer.record(VIDC_TRACE_ETB, nBufferIndex, buffer->nTimeStamp);
+  m_live_stats.input_queued(buffer->nTimeStamp);
   if (arbitrary_bytes)
   {
     post_event ((unsigned)hComp,(unsigned)buffer,
@@ -5370,6 +5548,17 @@ RETURN VALUE
 ========================================================================== */
 OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         hComp,
                                                  OMX_IN OMX_BUFFERHEADERTYPE* buffer)
+{
+  OMX_ERRORTYPE ret;
+
+  m_perf.begin(QOMX_VIDEO_PERF_ETB);
+  ret = empty_this_buffer_proxy_internal(hComp, buffer);
+  m_perf.end();
+  return ret;
+}
+
+OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy_internal(OMX_IN OMX_HANDLETYPE         hComp,
+                                                 OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
   int push_cnt = 0,i=0;
   unsigned nPortIndex = 0;
@@ -5398,6 +5587,9 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
         nPortIndex);
     return OMX_ErrorBadParameter;
   }
+  // Arbitrary bytes reach here once the frame parser completed a frame
+  if (arbitrary_bytes)
+    m_tracer.record(VIDC_TRACE_PARSE_DONE, nPortIndex, buffer->nTimeStamp);
 
   pending_input_buffers++;
 
@@ -5508,6 +5700,21 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
 #ifdef _ANDROID_
   if (m_debug_timestamp)
   {
+    OMX_U32 num_reorder_frames = 0, max_dec_frame_buffering = 0;
+    // Room for every queued input plus the pictures held in the DPB
+    bool depth_known = false;
+    if (h264_parser)
+    {
+      pthread_mutex_lock(&m_parser_lock);
+      depth_known = h264_parser->get_reorder_depth(&num_reorder_frames,
+                                                   &max_dec_frame_buffering);
+      pthread_mutex_unlock(&m_parser_lock);
+    }
+    // Some streams signal a DPB smaller than their reorder depth
+    if (depth_known)
+      m_timestamp_list.set_depth(drv_ctx.ip_buf.actualcount + 1 +
+        (max_dec_frame_buffering > num_reorder_frames ?
+         max_dec_frame_buffering : num_reorder_frames));
     if(arbitrary_bytes)
     {
       DEBUG_PRINT_LOW("\n Inserting TIMESTAMP (%lld) into queue", buffer->nTimeStamp);
@@ -5521,13 +5728,8 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
   }
 #endif
 
-#ifdef INPUT_BUFFER_LOG
-  if (inputBufferFile1)
-  {
-    fwrite((const char *)temp_buffer->bufferaddr,
-      temp_buffer->buffer_len,1,inputBufferFile1);
-  }
-#endif
+  m_input_dump.write(temp_buffer->bufferaddr, temp_buffer->buffer_len,
+                     (buffer->nFlags & OMX_BUFFERFLAG_DATACORRUPT) != 0);
 
   if(buffer->nFlags & QOMX_VIDEO_BUFFERFLAG_EOSEQ)
   {
@@ -5548,7 +5750,6 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
     m_frame_parser.flush();
     h264_last_au_ts = LLONG_MAX;
     h264_last_au_flags = 0;
-    memset(m_demux_offsets, 0, ( sizeof(OMX_U32) * 8192) );
     m_demux_entries = 0;
   }
 
@@ -5568,8 +5769,10 @@ OMX_ERRORTYPE  omx_vdec::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         h
                        OMX_COMPONENT_GENERATE_EBD);
     }
     return OMX_ErrorBadParameter;
-  } else
+  } else {
       time_stamp_dts.insert_timestamp(buffer);
+      m_tracer.record(VIDC_TRACE_DRV_SUBMIT, nPortIndex, frameinfo.timestamp);
+  }
 
   return ret;
 }
@@ -5617,6 +5820,8 @@ OMX_ERRORTYPE  omx_vdec::fill_this_buffer(OMX_IN OMX_HANDLETYPE  hComp,
   }
 
   DEBUG_PRINT_LOW("[FTB] bufhdr = %p, bufhdr->pBuffer = %p", buffer, buffer->pBuffer);
+  m_tracer.record(VIDC_TRACE_FTB, buffer - m_out_mem_ptr, buffer->nTimeStamp);
+  m_recorder.buffer(VIDC_RECORD_FTB, OMX_CORE_OUTPUT_PORT_INDEX, buffer);
   post_event((unsigned) hComp, (unsigned)buffer,OMX_COMPONENT_GENERATE_FTB);
   return OMX_ErrorNone;
 }
@@ -5747,6 +5952,7 @@ OMX_ERRORTYPE  omx_vdec::set_callbacks(OMX_IN OMX_HANDLETYPE        hComp,
   DEBUG_PRINT_LOW("\n Callbacks Set %p %p %p",m_cb.EmptyBufferDone,\
                m_cb.EventHandler,m_cb.FillBufferDone);
   m_app_data =    appData;
+  m_recorder.wrap_callbacks(&m_cb, &m_app_data);
   return OMX_ErrorNotImplemented;
 }
 
@@ -5785,6 +5991,16 @@ OMX_ERRORTYPE  omx_vdec::component_deinit(OMX_IN OMX_HANDLETYPE hComp)
       DEBUG_PRINT_HIGH("\n Playback Ended - PASSED");
     }
 
+    if (m_trace_file[0] && m_tracer.is_enabled())
+    {
+      m_tracer.disable();
+      if (!m_tracer.dump(m_trace_file, drv_ctx.kind))
+        DEBUG_PRINT_ERROR("Failed to write trace to %s", m_trace_file);
+    }
+    m_lock.report(drv_ctx.kind);
+    m_perf.report(drv_ctx.kind);
+    vidc_log_flush();
+
     /*Check if the output buffers have to be cleaned up*/
     if(m_out_mem_ptr)
     {
@@ -5835,12 +6051,20 @@ OMX_ERRORTYPE  omx_vdec::component_deinit(OMX_IN OMX_HANDLETYPE hComp)
         delete h264_parser;
 	h264_parser = NULL;
     }
-
-    if(m_platform_list)
+    if (m_deferred_nal)
+    {
+        free(m_deferred_nal);
+        m_deferred_nal = NULL;
+        m_deferred_nal_len = 0;
+    }
+    if (m_extradata_tmpl)
     {
-        free(m_platform_list);
-        m_platform_list = NULL;
+        free(m_extradata_tmpl);
+        m_extradata_tmpl = NULL;
+        m_extradata_tmpl_len = 0;
+        m_extradata_tmpl_dirty = true;
     }
+
     if(m_vendor_config.pData)
     {
         free(m_vendor_config.pData);
@@ -5882,15 +6106,11 @@ OMX_ERRORTYPE  omx_vdec::component_deinit(OMX_IN OMX_HANDLETYPE hComp)
      }
 #endif // _ANDROID_
     close(drv_ctx.video_driver_fd);
-#ifdef INPUT_BUFFER_LOG
-    fclose (inputBufferFile1);
-#endif
-#ifdef OUTPUT_BUFFER_LOG
-    fclose (outputBufferFile1);
-#endif
-#ifdef OUTPUT_EXTRADATA_LOG
-    fclose (outputExtradataFile);
-#endif
+    // Flushes whatever the writers still hold
+    m_input_dump.close();
+    m_output_dump.close();
+    m_extradata_dump.close();
+    m_recorder.close();
   DEBUG_PRINT_HIGH("\n omx_vdec::component_deinit() complete");
   return OMX_ErrorNone;
 }
@@ -6322,8 +6542,20 @@ bool omx_vdec::release_input_done(void)
 
 OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
                                OMX_BUFFERHEADERTYPE * buffer)
+{
+  OMX_ERRORTYPE ret;
+
+  m_perf.begin(QOMX_VIDEO_PERF_FBD);
+  ret = fill_buffer_done_internal(hComp, buffer);
+  m_perf.end();
+  return ret;
+}
+
+OMX_ERRORTYPE omx_vdec::fill_buffer_done_internal(OMX_HANDLETYPE hComp,
+                               OMX_BUFFERHEADERTYPE * buffer)
 {
   OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *pPMEMInfo = NULL;
+  OMX_S64 drv_timestamp;
   if (!buffer || (buffer - m_out_mem_ptr) >= drv_ctx.op_buf.actualcount)
   {
     DEBUG_PRINT_ERROR("\n [FBD] ERROR in ptr(%p)", buffer);
@@ -6338,10 +6570,20 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
     buffer->nFlags &= ~QOMX_VIDEO_BUFFERFLAG_EOSEQ;
     buffer->nFlags &= ~OMX_BUFFERFLAG_DATACORRUPT;
   }
+  // Traced as returned by the driver, so it closes the submit's span
+  drv_timestamp = buffer->nTimeStamp;
 
   DEBUG_PRINT_LOW("\n fill_buffer_done: bufhdr = %p, bufhdr->pBuffer = %p",
       buffer, buffer->pBuffer);
   pending_output_buffers --;
+  // Sample before the timestamp is reordered or adjusted below
+  if (!output_flush_progress)
+    m_live_stats.output_done(buffer->nTimeStamp, buffer->nFilledLen);
+  if (!output_flush_progress && buffer->nFilledLen)
+  {
+    m_perf.frame_done();
+    m_startup.first_frame();
+  }
 
   if (buffer->nFlags & OMX_BUFFERFLAG_EOS)
   {
@@ -6363,13 +6605,6 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
   }
 
   DEBUG_PRINT_LOW("\n In fill Buffer done call address %p ",buffer);
-#ifdef OUTPUT_BUFFER_LOG
-  if (outputBufferFile1)
-  {
-    fwrite (buffer->pBuffer,1,buffer->nFilledLen,
-                  outputBufferFile1);
-  }
-#endif
 
   /* For use buffer we need to copy the data */
   if (!output_flush_progress)
@@ -6382,21 +6617,20 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
   {
     if (buffer->nFilledLen > 0)
     {
+      OMX_U32 error_frames = m_conceal_stats.nFramesWithErrors;
       if (client_extradata)
+      {
+        pthread_mutex_lock(&m_parser_lock);
         handle_extradata(buffer);
-      if (client_extradata & OMX_TIMEINFO_EXTRADATA)
-        // Keep min timestamp interval to handle corrupted bit stream scenario
-        set_frame_rate(buffer->nTimeStamp);
-      else if (arbitrary_bytes)
+        pthread_mutex_unlock(&m_parser_lock);
+      }
+      if ((client_extradata & OMX_TIMEINFO_EXTRADATA) || arbitrary_bytes)
         adjust_timestamp(buffer->nTimeStamp);
       if (perf_flag)
       {
         if (!proc_frms)
         {
-          dec_time.stop();
-          latency = dec_time.processing_time_us() - latency;
-          DEBUG_PRINT_HIGH(">>> FBD Metrics: Latency(%.2f)mS", latency / 1e3);
-          dec_time.start();
+          m_startup.report(drv_ctx.kind);
           fps_metrics.start();
         }
         proc_frms++;
@@ -6412,31 +6646,12 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
         }
       }
 
-#ifdef OUTPUT_EXTRADATA_LOG
-  if (outputExtradataFile)
-  {
-
-    OMX_OTHER_EXTRADATATYPE *p_extra = NULL;
-    p_extra = (OMX_OTHER_EXTRADATATYPE *)
-           ((unsigned)(buffer->pBuffer + buffer->nOffset +
-            buffer->nFilledLen + 3)&(~3));
-    while(p_extra &&
-          (OMX_U8*)p_extra < (buffer->pBuffer + buffer->nAllocLen) )
-    {
-      DEBUG_PRINT_LOW("\nWRITING extradata, size=%d,type=%d",p_extra->nSize, p_extra->eType);
-      fwrite (p_extra,1,p_extra->nSize,outputExtradataFile);
-      if (p_extra->eType == OMX_ExtraDataNone)
-      {
-        break;
-      }
-      p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
-    }
-  }
-#endif
+      // Concealment is only known once the extradata has been parsed
+      dump_output(buffer, (buffer->nFlags & OMX_BUFFERFLAG_DATACORRUPT) ||
+                  m_conceal_stats.nFramesWithErrors != error_frames);
     }
     if (buffer->nFlags & OMX_BUFFERFLAG_EOS){
-      prev_ts = LLONG_MAX;
-      rst_prev_ts = true;
+      m_pts.reset();
       }
 
     pPMEMInfo = (OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *)
@@ -6457,6 +6672,7 @@ OMX_ERRORTYPE omx_vdec::fill_buffer_done(OMX_HANDLETYPE hComp,
      }
     }
 #endif
+    m_tracer.record(VIDC_TRACE_FBD, buffer - m_out_mem_ptr, drv_timestamp);
     m_cb.FillBufferDone (hComp,m_app_data,buffer);
     DEBUG_PRINT_LOW("\n After Fill Buffer Done callback %d",pPMEMInfo->pmem_fd);
   }
@@ -6598,6 +6814,9 @@ int omx_vdec::async_message_process (void *context, void* message)
        omxhdr = NULL;
        vdec_msg->status_code = VDEC_S_EFATAL;
     }
+    else
+      omx->m_tracer.record(VIDC_TRACE_DRV_INPUT_DONE,
+                           omxhdr - omx->m_inp_mem_ptr, omxhdr->nTimeStamp);
 
     omx->post_event ((unsigned int)omxhdr,vdec_msg->status_code,
                      OMX_COMPONENT_GENERATE_EBD);
@@ -6609,6 +6828,7 @@ int omx_vdec::async_message_process (void *context, void* message)
         *timestamp = vdec_msg->msgdata.output_frame.time_stamp;
         omx->post_event ((unsigned int)timestamp, vdec_msg->status_code,
                          OMX_COMPONENT_GENERATE_INFO_FIELD_DROPPED);
+        omx->m_live_stats.frame_dropped();
         DEBUG_PRINT_HIGH("\nField dropped time stamp is %lld",
              vdec_msg->msgdata.output_frame.time_stamp);
       }
@@ -6649,6 +6869,8 @@ int omx_vdec::async_message_process (void *context, void* message)
         omxhdr->nOffset = vdec_msg->msgdata.output_frame.offset;
         omxhdr->nTimeStamp = vdec_msg->msgdata.output_frame.time_stamp;
         omxhdr->nFlags = (vdec_msg->msgdata.output_frame.flags);
+        omx->m_tracer.record(VIDC_TRACE_DRV_OUTPUT_DONE,
+                             omxhdr - omx->m_out_mem_ptr, omxhdr->nTimeStamp);
 
         output_respbuf = (struct vdec_output_frameinfo *)\
                           omxhdr->pOutputPortPrivate;
@@ -6697,6 +6919,7 @@ int omx_vdec::async_message_process (void *context, void* message)
     OMX_ERRORTYPE eRet = OMX_ErrorNone;
     omx->m_port_def.nPortIndex = 1;
     eRet = omx->update_portdef(&(omx->m_port_def));
+    omx->m_extradata_tmpl_dirty = true;
     omx->post_event ((unsigned int)omxhdr,vdec_msg->status_code,
                      OMX_COMPONENT_GENERATE_INFO_PORT_RECONFIG);
     break;
@@ -6794,6 +7017,8 @@ OMX_ERRORTYPE omx_vdec::push_input_buffer (OMX_HANDLETYPE hComp)
 
   while ((pdest_frame != NULL) && (psource_frame != NULL))
   {
+    // Frames the parser completes are queued inside, as the ETB stage
+    m_perf.begin(QOMX_VIDEO_PERF_PARSER);
     switch (codec_type_parse)
     {
       case CODEC_TYPE_MPEG4:
@@ -6808,6 +7033,7 @@ OMX_ERRORTYPE omx_vdec::push_input_buffer (OMX_HANDLETYPE hComp)
         ret = push_input_vc1(hComp);
       break;
     }
+    m_perf.end();
     if (ret != OMX_ErrorNone)
     {
       DEBUG_PRINT_ERROR("\n Pushing input Buffer Failed");
@@ -7010,6 +7236,7 @@ OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
       DEBUG_PRINT_LOW("\n Parsed New NAL Length = %d",h264_scratch.nFilledLen);
       if(h264_scratch.nFilledLen)
       {
+          pthread_mutex_lock(&m_parser_lock);
           h264_parser->parse_nal((OMX_U8*)h264_scratch.pBuffer, h264_scratch.nFilledLen,
                                  NALU_TYPE_SPS);
 #ifndef PROCESS_EXTRADATA_IN_OUTPUT_PORT
@@ -7045,6 +7272,7 @@ OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
 #endif
         } else
           h264_last_au_ts = LLONG_MAX;
+        pthread_mutex_unlock(&m_parser_lock);
       }
 
       if (!isNewFrame)
@@ -7163,7 +7391,9 @@ OMX_ERRORTYPE omx_vdec::push_input_h264 (OMX_HANDLETYPE hComp)
 #ifndef PROCESS_EXTRADATA_IN_OUTPUT_PORT
         if (client_extradata & OMX_TIMEINFO_EXTRADATA)
         {
+          pthread_mutex_lock(&m_parser_lock);
           OMX_S64 ts_in_sei = h264_parser->process_ts_with_sei_vui(pdest_frame->nTimeStamp);
+          pthread_mutex_unlock(&m_parser_lock);
           if (!VALID_TS(pdest_frame->nTimeStamp))
             pdest_frame->nTimeStamp = ts_in_sei;
         }
@@ -7362,34 +7592,23 @@ void omx_vdec::free_output_buffer_header()
   output_use_buffer = false;
   ouput_egl_buffers = false;
 
-  if (m_out_mem_ptr)
-  {
-    free (m_out_mem_ptr);
-    m_out_mem_ptr = NULL;
-  }
-
-  if(m_platform_list)
-  {
-    free(m_platform_list);
-    m_platform_list = NULL;
-  }
-
-  if (drv_ctx.ptr_respbuffer)
+  if (m_out_extradata)
   {
-    free (drv_ctx.ptr_respbuffer);
-    drv_ctx.ptr_respbuffer = NULL;
-  }
-  if (drv_ctx.ptr_outputbuffer)
-  {
-    free (drv_ctx.ptr_outputbuffer);
-    drv_ctx.ptr_outputbuffer = NULL;
+    m_mem_stats.unmapped(QOMX_VIDEO_MEM_EXTRADATA,
+                         drv_ctx.op_buf.actualcount * m_out_extradata_stride);
+    m_mem_stats.released(QOMX_VIDEO_MEM_EXTRADATA,
+                         drv_ctx.op_buf.actualcount * m_out_extradata_stride);
+    m_out_extradata = NULL;
   }
+  free_port_arena(&m_out_arena);
+  m_out_mem_ptr = NULL;
+  m_platform_list = NULL;
+  m_platform_entry = NULL;
+  m_pmem_info = NULL;
+  drv_ctx.ptr_respbuffer = NULL;
+  drv_ctx.ptr_outputbuffer = NULL;
 #ifdef USE_ION
-    if (drv_ctx.op_buf_ion_info) {
-        DEBUG_PRINT_LOW("\n Free o/p ion context");
-	free(drv_ctx.op_buf_ion_info);
-        drv_ctx.op_buf_ion_info = NULL;
-    }
+  drv_ctx.op_buf_ion_info = NULL;
 #endif
 }
 
@@ -7422,22 +7641,354 @@ void omx_vdec::free_input_buffer_header()
     if (m_inp_mem_ptr)
     {
       DEBUG_PRINT_LOW("\n Free input pmem Pointer area");
-      free (m_inp_mem_ptr);
-      m_inp_mem_ptr = NULL;
     }
-    if (drv_ctx.ptr_inputbuffer)
+    free_port_arena(&m_inp_arena);
+    m_inp_mem_ptr = NULL;
+    drv_ctx.ptr_inputbuffer = NULL;
+#ifdef USE_ION
+    drv_ctx.ip_buf_ion_info = NULL;
+#endif
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::free_port_arena
+
+DESCRIPTION
+  Releases the block backing one port's buffer headers and driver
+  contexts. Pointers carved out of it must be reset by the caller.
+
+PARAMETERS
+  arena - port arena to release.
+
+RETURN VALUE
+  None.
+
+========================================================================== */
+void omx_vdec::free_port_arena(struct vdec_port_arena *arena)
+{
+  if (arena && arena->base)
+  {
+    DEBUG_PRINT_LOW("\n Free port arena %p size %u", arena->base, arena->size);
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = 0;
+  }
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::allocate_input_arena
+
+DESCRIPTION
+  Allocates the input buffer headers, driver payloads and ION contexts
+  for drv_ctx.ip_buf.actualcount buffers from a single zeroed block.
+  Each array starts on a cache line so ETB only touches the lines of
+  the buffer being queued.
+
+PARAMETERS
+  None.
+
+RETURN VALUE
+  OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::allocate_input_arena()
+{
+  unsigned count = drv_ctx.ip_buf.actualcount;
+  unsigned nBufHdrSize = VDEC_CACHE_ALIGN(count * sizeof(OMX_BUFFERHEADERTYPE));
+  unsigned nPayloadSize = VDEC_CACHE_ALIGN(count * sizeof(struct vdec_bufferpayload));
+  unsigned nIonSize = 0;
+  unsigned i = 0;
+  char *pPtr = NULL;
+
+#ifdef USE_ION
+  nIonSize = VDEC_CACHE_ALIGN(count * sizeof(struct vdec_ion));
+#endif
+  m_inp_arena.size = nBufHdrSize + nPayloadSize + nIonSize;
+  m_inp_arena.base = calloc(m_inp_arena.size + VDEC_CACHE_LINE_SIZE - 1, 1);
+  if (!m_inp_arena.base)
+  {
+    DEBUG_PRINT_ERROR("\n Input arena alloc failed size %u", m_inp_arena.size);
+    m_inp_arena.size = 0;
+    return OMX_ErrorInsufficientResources;
+  }
+  pPtr = (char *)VDEC_CACHE_ALIGN((unsigned long)m_inp_arena.base);
+
+  m_inp_mem_ptr = (OMX_BUFFERHEADERTYPE *)pPtr;
+  pPtr += nBufHdrSize;
+  drv_ctx.ptr_inputbuffer = (struct vdec_bufferpayload *)pPtr;
+  pPtr += nPayloadSize;
+#ifdef USE_ION
+  drv_ctx.ip_buf_ion_info = (struct vdec_ion *)pPtr;
+#endif
+
+  for (i=0; i < count; i++)
+  {
+    drv_ctx.ptr_inputbuffer [i].pmem_fd = -1;
+#ifdef USE_ION
+    drv_ctx.ip_buf_ion_info[i].ion_device_fd = -1;
+#endif
+  }
+  return OMX_ErrorNone;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::allocate_output_arena
+
+DESCRIPTION
+  Allocates the output buffer headers, platform private list/entry/pmem
+  info, driver payloads, response buffers and ION contexts for
+  drv_ctx.op_buf.actualcount buffers from a single zeroed block, and
+  links them together. Each array starts on a cache line.
+
+PARAMETERS
+  None.
+
+RETURN VALUE
+  OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::allocate_output_arena()
+{
+  unsigned count = drv_ctx.op_buf.actualcount;
+  unsigned nBufHdrSize = VDEC_CACHE_ALIGN(count * sizeof(OMX_BUFFERHEADERTYPE));
+  unsigned nPlatformListSize = VDEC_CACHE_ALIGN(count *
+                               sizeof(OMX_QCOM_PLATFORM_PRIVATE_LIST));
+  unsigned nPlatformEntrySize = VDEC_CACHE_ALIGN(count *
+                                sizeof(OMX_QCOM_PLATFORM_PRIVATE_ENTRY));
+  unsigned nPMEMInfoSize = VDEC_CACHE_ALIGN(count *
+                           sizeof(OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO));
+  unsigned nPayloadSize = VDEC_CACHE_ALIGN(count * sizeof(struct vdec_bufferpayload));
+  unsigned nRespSize = VDEC_CACHE_ALIGN(count * sizeof(struct vdec_output_frameinfo));
+  unsigned nIonSize = 0;
+  unsigned nExtraSize = 0;
+  unsigned i = 0;
+  char *pPtr = NULL;
+  OMX_BUFFERHEADERTYPE                *bufHdr;
+  OMX_QCOM_PLATFORM_PRIVATE_LIST      *pPlatformList;
+  OMX_QCOM_PLATFORM_PRIVATE_ENTRY     *pPlatformEntry;
+  OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *pPMEMInfo;
+
+#ifdef USE_ION
+  nIonSize = VDEC_CACHE_ALIGN(count * sizeof(struct vdec_ion));
+#endif
+  m_out_extradata_stride = 0;
+  if (m_sep_extradata)
+  {
+    m_out_extradata_stride = get_omx_extradata_size();
+    if (client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP)
+    {
+      if (!m_out_extradata_stride) // Space for terminator
+        m_out_extradata_stride = sizeof(OMX_OTHER_EXTRADATATYPE);
+      // Copy of the conceal MB map, one bit per MB
+      m_out_extradata_stride += (sizeof(OMX_OTHER_EXTRADATATYPE) +
+        ((((drv_ctx.video_resolution.frame_width + 15) *
+           (drv_ctx.video_resolution.frame_height + 15)) >> 8) + 7) / 8 + 3) & (~3);
+    }
+    // The append checks in handle_extradata keep a frame info record
+    // of headroom, so does the side buffer
+    if (m_out_extradata_stride)
+      m_out_extradata_stride = VDEC_CACHE_ALIGN(m_out_extradata_stride +
+                                                OMX_FRAMEINFO_EXTRADATA_SIZE);
+    nExtraSize = count * m_out_extradata_stride;
+  }
+  m_out_arena.size = nBufHdrSize + nPlatformListSize + nPlatformEntrySize +
+                     nPMEMInfoSize + nPayloadSize + nRespSize + nIonSize +
+                     nExtraSize;
+  DEBUG_PRINT_LOW("Output arena: Cnt %d BufHdr %d PL %d PE %d PMEM %d Total %d\n",
+                  count, nBufHdrSize, nPlatformListSize, nPlatformEntrySize,
+                  nPMEMInfoSize, m_out_arena.size);
+  m_out_arena.base = calloc(m_out_arena.size + VDEC_CACHE_LINE_SIZE - 1, 1);
+  if (!m_out_arena.base)
+  {
+    DEBUG_PRINT_ERROR("Output buf mem alloc failed size %u\n", m_out_arena.size);
+    m_out_arena.size = 0;
+    return OMX_ErrorInsufficientResources;
+  }
+  pPtr = (char *)VDEC_CACHE_ALIGN((unsigned long)m_out_arena.base);
+
+  m_out_mem_ptr = (OMX_BUFFERHEADERTYPE *)pPtr;
+  pPtr += nBufHdrSize;
+  m_platform_list = (OMX_QCOM_PLATFORM_PRIVATE_LIST *)pPtr;
+  pPtr += nPlatformListSize;
+  m_platform_entry = (OMX_QCOM_PLATFORM_PRIVATE_ENTRY *)pPtr;
+  pPtr += nPlatformEntrySize;
+  m_pmem_info = (OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *)pPtr;
+  pPtr += nPMEMInfoSize;
+  drv_ctx.ptr_outputbuffer = (struct vdec_bufferpayload *)pPtr;
+  pPtr += nPayloadSize;
+  drv_ctx.ptr_respbuffer = (struct vdec_output_frameinfo *)pPtr;
+  pPtr += nRespSize;
+#ifdef USE_ION
+  drv_ctx.op_buf_ion_info = (struct vdec_ion *)pPtr;
+#endif
+  pPtr += nIonSize;
+  m_out_extradata = nExtraSize ? (OMX_U8 *)pPtr : NULL;
+  if (nExtraSize)
+  {
+    DEBUG_PRINT_HIGH("Separate extradata: %u bytes per buffer", m_out_extradata_stride);
+    m_mem_stats.allocated(QOMX_VIDEO_MEM_EXTRADATA, nExtraSize);
+    m_mem_stats.mapped(QOMX_VIDEO_MEM_EXTRADATA, nExtraSize);
+  }
+
+  DEBUG_PRINT_LOW("Memory Allocation Succeeded for OUT port%p\n",m_out_mem_ptr);
+  bufHdr          = m_out_mem_ptr;
+  pPlatformList   = m_platform_list;
+  pPlatformEntry  = m_platform_entry;
+  pPMEMInfo       = m_pmem_info;
+  for(i=0; i < count; i++)
+  {
+    bufHdr->nSize              = sizeof(OMX_BUFFERHEADERTYPE);
+    bufHdr->nVersion.nVersion  = OMX_SPEC_VERSION;
+    // Set the values when we determine the right HxW param
+    bufHdr->nAllocLen          = 0;
+    bufHdr->nFilledLen         = 0;
+    bufHdr->pAppPrivate        = NULL;
+    bufHdr->nOutputPortIndex   = OMX_CORE_OUTPUT_PORT_INDEX;
+    // Initialize the Platform Entry
+    pPlatformEntry->type       = OMX_QCOM_PLATFORM_PRIVATE_PMEM;
+    pPlatformEntry->entry      = pPMEMInfo;
+    // Initialize the Platform List
+    pPlatformList->nEntries    = 1;
+    pPlatformList->entryList   = pPlatformEntry;
+    // Keep pBuffer NULL till vdec is opened
+    bufHdr->pBuffer            = NULL;
+    pPMEMInfo->offset          =  0;
+    pPMEMInfo->pmem_fd = 0;
+    bufHdr->pPlatformPrivate = pPlatformList;
+    drv_ctx.ptr_outputbuffer[i].pmem_fd = -1;
+#ifdef USE_ION
+    drv_ctx.op_buf_ion_info[i].ion_device_fd =-1;
+#endif
+    /*Create a mapping between buffers*/
+    bufHdr->pOutputPortPrivate = &drv_ctx.ptr_respbuffer[i];
+    drv_ctx.ptr_respbuffer[i].client_data = (void *) \
+                                        &drv_ctx.ptr_outputbuffer[i];
+    bufHdr++;
+    pPMEMInfo++;
+    pPlatformEntry++;
+    pPlatformList++;
+  }
+  return OMX_ErrorNone;
+}
+
+/* Extradata space reserved at the tail of every output frame */
+OMX_U32 omx_vdec::get_extradata_size()
+{
+  if (m_sep_extradata)
+    return 0;
+  return get_omx_extradata_size();
+}
+
+OMX_U32 omx_vdec::get_omx_extradata_size()
+{
+  OMX_U32 extra_data_size = 0;
+  if (client_extradata & OMX_FRAMEINFO_EXTRADATA)
+  {
+    DEBUG_PRINT_HIGH("Frame info extra data enabled!");
+    extra_data_size += OMX_FRAMEINFO_EXTRADATA_SIZE;
+  }
+  if (client_extradata & OMX_INTERLACE_EXTRADATA)
+  {
+    DEBUG_PRINT_HIGH("Interlace extra data enabled!");
+    extra_data_size += OMX_INTERLACE_EXTRADATA_SIZE;
+  }
+  if (client_extradata & OMX_PORTDEF_EXTRADATA)
+  {
+     extra_data_size += OMX_PORTDEF_EXTRADATA_SIZE;
+     DEBUG_PRINT_HIGH("Smooth streaming enabled extra_data_size=%d\n",
+       extra_data_size);
+  }
+  if (extra_data_size)
+  {
+    extra_data_size += sizeof(OMX_OTHER_EXTRADATATYPE); //Space for terminator
+  }
+  return extra_data_size;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::get_separate_extradata
+
+DESCRIPTION
+  Looks up the side buffer holding the OMX extradata of an output
+  buffer in separate extradata mode.
+
+PARAMETERS
+  buffer - output buffer header owned by this component.
+
+RETURN VALUE
+  Start of the extradata list, NULL if the mode is off or the header
+  is not one of ours.
+
+========================================================================== */
+OMX_OTHER_EXTRADATATYPE *omx_vdec::get_separate_extradata(OMX_BUFFERHEADERTYPE *buffer)
+{
+  unsigned index;
+  if (!m_out_extradata || !m_out_mem_ptr || buffer < m_out_mem_ptr)
+    return NULL;
+  index = buffer - m_out_mem_ptr;
+  if (index >= drv_ctx.op_buf.actualcount)
+    return NULL;
+  return (OMX_OTHER_EXTRADATATYPE *)(m_out_extradata +
+                                     index * m_out_extradata_stride);
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::update_output_mem_stats
+
+DESCRIPTION
+  Accounts one component allocated output buffer in the session memory
+  statistics. The tail reserved for extradata is reported separately
+  from the frame area. The split is recorded per buffer at allocation so
+  the free releases the same amounts even if a port reconfig changed
+  op_buf.buffer_size in between.
+
+PARAMETERS
+  index - output buffer index.
+  alloc - true when the buffer was allocated, false when freed.
+
+RETURN VALUE
+  None.
+
+========================================================================== */
+void omx_vdec::update_output_mem_stats(unsigned index, bool alloc)
+{
+  if (index >= MAX_NUM_INPUT_OUTPUT_BUFFERS)
+    return;
+  if (alloc)
+  {
+    OMX_U32 size = drv_ctx.op_buf.buffer_size;
+    OMX_U32 extra = get_extradata_size();
+    if (extra > size)
+      extra = 0;
+    m_mem_out_size[index] = size - extra;
+    m_mem_out_extradata[index] = extra;
+    m_mem_stats.allocated(QOMX_VIDEO_MEM_OUTPUT, m_mem_out_size[index]);
+    m_mem_stats.allocated(QOMX_VIDEO_MEM_EXTRADATA, extra);
+    if (!secure_mode)
     {
-      DEBUG_PRINT_LOW("\n Free Driver Context pointer");
-      free (drv_ctx.ptr_inputbuffer);
-      drv_ctx.ptr_inputbuffer = NULL;
+      m_mem_stats.mapped(QOMX_VIDEO_MEM_OUTPUT, m_mem_out_size[index]);
+      m_mem_stats.mapped(QOMX_VIDEO_MEM_EXTRADATA, extra);
     }
-#ifdef USE_ION
-    if (drv_ctx.ip_buf_ion_info) {
-        DEBUG_PRINT_LOW("\n Free ion context");
-	free(drv_ctx.ip_buf_ion_info);
-        drv_ctx.ip_buf_ion_info = NULL;
+  }
+  else
+  {
+    if (!secure_mode)
+    {
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_OUTPUT, m_mem_out_size[index]);
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_EXTRADATA,
+                           m_mem_out_extradata[index]);
     }
-#endif
+    m_mem_stats.released(QOMX_VIDEO_MEM_OUTPUT, m_mem_out_size[index]);
+    m_mem_stats.released(QOMX_VIDEO_MEM_EXTRADATA,
+                         m_mem_out_extradata[index]);
+    m_mem_out_size[index] = 0;
+    m_mem_out_extradata[index] = 0;
+  }
 }
 
 OMX_ERRORTYPE omx_vdec::get_buffer_req(vdec_allocatorproperty *buffer_prop)
@@ -7458,25 +8009,9 @@ OMX_ERRORTYPE omx_vdec::get_buffer_req(vdec_allocatorproperty *buffer_prop)
   else
   {
     buf_size = buffer_prop->buffer_size;
-    if (client_extradata & OMX_FRAMEINFO_EXTRADATA)
-    {
-      DEBUG_PRINT_HIGH("Frame info extra data enabled!");
-      extra_data_size += OMX_FRAMEINFO_EXTRADATA_SIZE;
-    }
-    if (client_extradata & OMX_INTERLACE_EXTRADATA)
-    {
-      DEBUG_PRINT_HIGH("Interlace extra data enabled!");
-      extra_data_size += OMX_INTERLACE_EXTRADATA_SIZE;
-    }
-    if (client_extradata & OMX_PORTDEF_EXTRADATA)
-    {
-       extra_data_size += OMX_PORTDEF_EXTRADATA_SIZE;
-       DEBUG_PRINT_HIGH("Smooth streaming enabled extra_data_size=%d\n",
-         extra_data_size);
-    }
+    extra_data_size = get_extradata_size();
     if (extra_data_size)
     {
-      extra_data_size += sizeof(OMX_OTHER_EXTRADATATYPE); //Space for terminator
       buf_size = ((buf_size + 3)&(~3)); //Align extradata start address to 64Bit
     }
     buf_size += extra_data_size;
@@ -7550,6 +8085,8 @@ OMX_ERRORTYPE omx_vdec::start_port_reconfig()
         }
       }
       in_reconfig = true;
+      // Picture size and interlace records change with the new stream
+      m_extradata_tmpl_dirty = true;
       op_buf_rcnfg.buffer_type = VDEC_BUFFER_TYPE_OUTPUT;
       eRet = get_buffer_req(&op_buf_rcnfg);
     }
@@ -7656,152 +8193,32 @@ OMX_ERRORTYPE omx_vdec::update_portdef(OMX_PARAM_PORTDEFINITIONTYPE *portDefn)
 OMX_ERRORTYPE omx_vdec::allocate_output_headers()
 {
   OMX_ERRORTYPE eRet = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE *bufHdr = NULL;
-  unsigned i= 0;
 
   if(!m_out_mem_ptr) {
     DEBUG_PRINT_HIGH("\n Use o/p buffer case - Header List allocation");
-    int nBufHdrSize        = 0;
-    int nPlatformEntrySize = 0;
-    int nPlatformListSize  = 0;
-    int nPMEMInfoSize = 0;
-    OMX_QCOM_PLATFORM_PRIVATE_LIST      *pPlatformList;
-    OMX_QCOM_PLATFORM_PRIVATE_ENTRY     *pPlatformEntry;
-    OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *pPMEMInfo;
-
-    DEBUG_PRINT_LOW("Setting First Output Buffer(%d)\n",
-      drv_ctx.op_buf.actualcount);
-    nBufHdrSize        = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_BUFFERHEADERTYPE);
-
-    nPMEMInfoSize      = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO);
-    nPlatformListSize  = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_LIST);
-    nPlatformEntrySize = drv_ctx.op_buf.actualcount *
-                         sizeof(OMX_QCOM_PLATFORM_PRIVATE_ENTRY);
-
-    DEBUG_PRINT_LOW("TotalBufHdr %d BufHdrSize %d PMEM %d PL %d\n",nBufHdrSize,
-                         sizeof(OMX_BUFFERHEADERTYPE),
-                         nPMEMInfoSize,
-                         nPlatformListSize);
-    DEBUG_PRINT_LOW("PE %d bmSize %d \n",nPlatformEntrySize,
-                         m_out_bm_count);
-    m_out_mem_ptr = (OMX_BUFFERHEADERTYPE  *)calloc(nBufHdrSize,1);
-    // Alloc mem for platform specific info
-    char *pPtr=NULL;
-    pPtr = (char*) calloc(nPlatformListSize + nPlatformEntrySize +
-                                     nPMEMInfoSize,1);
-    drv_ctx.ptr_outputbuffer = (struct vdec_bufferpayload *) \
-      calloc (sizeof(struct vdec_bufferpayload),
-      drv_ctx.op_buf.actualcount);
-    drv_ctx.ptr_respbuffer = (struct vdec_output_frameinfo  *)\
-      calloc (sizeof (struct vdec_output_frameinfo),
-      drv_ctx.op_buf.actualcount);
-#ifdef USE_ION
-    drv_ctx.op_buf_ion_info = (struct vdec_ion * ) \
-      calloc (sizeof(struct vdec_ion),drv_ctx.op_buf.actualcount);
-#endif
-
-    if(m_out_mem_ptr && pPtr && drv_ctx.ptr_outputbuffer
-       && drv_ctx.ptr_respbuffer)
-    {
-      bufHdr          =  m_out_mem_ptr;
-      m_platform_list = (OMX_QCOM_PLATFORM_PRIVATE_LIST *)(pPtr);
-      m_platform_entry= (OMX_QCOM_PLATFORM_PRIVATE_ENTRY *)
-                        (((char *) m_platform_list)  + nPlatformListSize);
-      m_pmem_info     = (OMX_QCOM_PLATFORM_PRIVATE_PMEM_INFO *)
-                        (((char *) m_platform_entry) + nPlatformEntrySize);
-      pPlatformList   = m_platform_list;
-      pPlatformEntry  = m_platform_entry;
-      pPMEMInfo       = m_pmem_info;
-
-      DEBUG_PRINT_LOW("Memory Allocation Succeeded for OUT port%p\n",m_out_mem_ptr);
-
-      // Settting the entire storage nicely
-      DEBUG_PRINT_LOW("bHdr %p OutMem %p PE %p\n",bufHdr,
-                      m_out_mem_ptr,pPlatformEntry);
-      DEBUG_PRINT_LOW(" Pmem Info = %p \n",pPMEMInfo);
-      for(i=0; i < drv_ctx.op_buf.actualcount ; i++)
-      {
-        bufHdr->nSize              = sizeof(OMX_BUFFERHEADERTYPE);
-        bufHdr->nVersion.nVersion  = OMX_SPEC_VERSION;
-        // Set the values when we determine the right HxW param
-        bufHdr->nAllocLen          = 0;
-        bufHdr->nFilledLen         = 0;
-        bufHdr->pAppPrivate        = NULL;
-        bufHdr->nOutputPortIndex   = OMX_CORE_OUTPUT_PORT_INDEX;
-        pPlatformEntry->type       = OMX_QCOM_PLATFORM_PRIVATE_PMEM;
-        pPlatformEntry->entry      = pPMEMInfo;
-        // Initialize the Platform List
-        pPlatformList->nEntries    = 1;
-        pPlatformList->entryList   = pPlatformEntry;
-        // Keep pBuffer NULL till vdec is opened
-        bufHdr->pBuffer            = NULL;
-        pPMEMInfo->offset          =  0;
-        pPMEMInfo->pmem_fd = 0;
-        bufHdr->pPlatformPrivate = pPlatformList;
-        drv_ctx.ptr_outputbuffer[i].pmem_fd = -1;
-#ifdef USE_ION
-        drv_ctx.op_buf_ion_info[i].ion_device_fd =-1;
-#endif
-        /*Create a mapping between buffers*/
-        bufHdr->pOutputPortPrivate = &drv_ctx.ptr_respbuffer[i];
-        drv_ctx.ptr_respbuffer[i].client_data = (void *) \
-                                            &drv_ctx.ptr_outputbuffer[i];
-        // Move the buffer and buffer header pointers
-        bufHdr++;
-        pPMEMInfo++;
-        pPlatformEntry++;
-        pPlatformList++;
-      }
-    }
-    else
-    {
-      DEBUG_PRINT_ERROR("Output buf mem alloc failed[0x%x][0x%x]\n",\
-                                        m_out_mem_ptr, pPtr);
-      if(m_out_mem_ptr)
-      {
-        free(m_out_mem_ptr);
-        m_out_mem_ptr = NULL;
-      }
-      if(pPtr)
-      {
-        free(pPtr);
-        pPtr = NULL;
-      }
-      if(drv_ctx.ptr_outputbuffer)
-      {
-        free(drv_ctx.ptr_outputbuffer);
-        drv_ctx.ptr_outputbuffer = NULL;
-      }
-      if(drv_ctx.ptr_respbuffer)
-      {
-        free(drv_ctx.ptr_respbuffer);
-        drv_ctx.ptr_respbuffer = NULL;
-      }
-#ifdef USE_ION
-    if (drv_ctx.op_buf_ion_info) {
-        DEBUG_PRINT_LOW("\n Free o/p ion context");
-	free(drv_ctx.op_buf_ion_info);
-        drv_ctx.op_buf_ion_info = NULL;
-    }
-#endif
-      eRet =  OMX_ErrorInsufficientResources;
-    }
+    eRet = allocate_output_arena();
   } else {
     eRet =  OMX_ErrorInsufficientResources;
   }
   return eRet;
 }
 
+void omx_vdec::startup_state_reached(OMX_STATETYPE state)
+{
+  if (state == OMX_StateIdle)
+    m_startup.end(QOMX_VIDEO_STARTUP_LOADED_TO_IDLE);
+  else if (state == OMX_StateExecuting &&
+           m_startup.end(QOMX_VIDEO_STARTUP_IDLE_TO_EXECUTING))
+    m_startup.begin(QOMX_VIDEO_STARTUP_FIRST_ETB);
+}
+
 void omx_vdec::complete_pending_buffer_done_cbs()
 {
   unsigned p1;
   unsigned p2;
   unsigned ident;
   omx_cmd_queue tmp_q, pending_bd_q;
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
   // pop all pending GENERATE FDB from ftb queue
   while (m_ftb_q.m_size)
   {
@@ -7840,7 +8257,7 @@ void omx_vdec::complete_pending_buffer_done_cbs()
     tmp_q.pop_entry(&p1,&p2,&ident);
     m_etb_q.insert_entry(p1,p2,ident);
   }
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   // process all pending buffer dones
   while(pending_bd_q.m_size)
   {
@@ -7866,71 +8283,112 @@ void omx_vdec::complete_pending_buffer_done_cbs()
   }
 }
 
-void omx_vdec::set_frame_rate(OMX_S64 act_timestamp)
+void omx_vdec::update_driver_frame_rate()
 {
-  OMX_U32 new_frame_interval = 0;
   struct vdec_ioctl_msg ioctl_msg = {NULL, NULL};
-  if (VALID_TS(act_timestamp) && VALID_TS(prev_ts) && act_timestamp != prev_ts
-     && (((act_timestamp > prev_ts )? act_timestamp - prev_ts: prev_ts-act_timestamp)>2000))
-  {
-    new_frame_interval = (act_timestamp > prev_ts)?
-                          act_timestamp - prev_ts :
-                          prev_ts - act_timestamp;
-    if (new_frame_interval < frm_int || frm_int == 0)
-    {
-      frm_int = new_frame_interval;
-      if(frm_int)
-      {
-        drv_ctx.frame_rate.fps_numerator = 1e6;
-        drv_ctx.frame_rate.fps_denominator = frm_int;
-        DEBUG_PRINT_LOW("set_frame_rate: frm_int(%u) fps(%f)",
-                         frm_int, drv_ctx.frame_rate.fps_numerator /
-                         (float)drv_ctx.frame_rate.fps_denominator);
-        ioctl_msg.in = &drv_ctx.frame_rate;
-        if (ioctl (drv_ctx.video_driver_fd, VDEC_IOCTL_SET_FRAME_RATE,
-                  (void*)&ioctl_msg) < 0)
-        {
-          DEBUG_PRINT_ERROR("Setting frame rate failed");
-        }
-      }
+  OMX_U32 frm_int = m_pts.get_min_interval();
+  if (frm_int)
+  {
+    drv_ctx.frame_rate.fps_numerator = 1e6;
+    drv_ctx.frame_rate.fps_denominator = frm_int;
+    DEBUG_PRINT_LOW("set_frame_rate: frm_int(%lu) fps(%f)",
+                     frm_int, drv_ctx.frame_rate.fps_numerator /
+                     (float)drv_ctx.frame_rate.fps_denominator);
+    ioctl_msg.in = &drv_ctx.frame_rate;
+    if (ioctl (drv_ctx.video_driver_fd, VDEC_IOCTL_SET_FRAME_RATE,
+              (void*)&ioctl_msg) < 0)
+    {
+      DEBUG_PRINT_ERROR("Setting frame rate failed");
     }
   }
-  prev_ts = act_timestamp;
 }
 
-void omx_vdec::adjust_timestamp(OMX_S64 &act_timestamp)
+void omx_vdec::set_frame_rate(OMX_S64 act_timestamp)
 {
-  if (rst_prev_ts && VALID_TS(act_timestamp))
+  if (m_pts.observe(act_timestamp))
   {
-    prev_ts = act_timestamp;
-    rst_prev_ts = false;
+    m_pts.min_interval_changed();
+    update_driver_frame_rate();
   }
-  else if (VALID_TS(prev_ts))
-  {
-    bool codec_cond = (drv_ctx.timestamp_adjust)?
-                      (!VALID_TS(act_timestamp) || (((act_timestamp > prev_ts)?
-                      (act_timestamp - prev_ts):(prev_ts - act_timestamp)) <= 2000)):
-                      (!VALID_TS(act_timestamp) || act_timestamp == prev_ts);
-    if(frm_int > 0 && codec_cond)
-    {
-      DEBUG_PRINT_LOW("adjust_timestamp: original ts[%lld]", act_timestamp);
-      act_timestamp = prev_ts + frm_int;
-      DEBUG_PRINT_LOW("adjust_timestamp: predicted ts[%lld]", act_timestamp);
-      prev_ts = act_timestamp;
-    }
-    else
-      set_frame_rate(act_timestamp);
+}
+
+void omx_vdec::adjust_timestamp(OMX_S64 &act_timestamp)
+{
+  act_timestamp = m_pts.predict(act_timestamp, m_pts_fields,
+                                drv_ctx.timestamp_adjust);
+  m_pts_fields = 2;
+  // Keep min timestamp interval to handle corrupted bit stream scenario
+  if (m_pts.min_interval_changed())
+    update_driver_frame_rate();
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::parse_extradata_nal
+
+DESCRIPTION
+  Feeds an H.264 SEI or VUI extradata record to the stream parser, or
+  queues a copy of it for parse_deferred_extradata. Queued records are
+  flushed first when the queue is full, so the parser state always
+  matches eager parsing once the queue is drained. The caller holds
+  m_parser_lock.
+
+PARAMETERS
+  extra    - driver extradata record.
+  nal_type - NALU_TYPE_SEI or NALU_TYPE_VUI.
+  defer    - queue instead of parsing.
+
+RETURN VALUE
+  None.
+
+========================================================================== */
+void omx_vdec::parse_extradata_nal(OMX_OTHER_EXTRADATATYPE *extra,
+                                   OMX_U32 nal_type, bool defer)
+{
+  struct vdec_deferred_nal *entry;
+  OMX_U32 need = sizeof(struct vdec_deferred_nal) +
+                 ((extra->nDataSize + 3) & (~3));
+
+  if (defer && !m_deferred_nal)
+    m_deferred_nal = (OMX_U8 *)calloc(VDEC_DEFERRED_NAL_SIZE, 1);
+  if (defer && m_deferred_nal_len + need > VDEC_DEFERRED_NAL_SIZE)
+    parse_deferred_extradata();
+  if (!defer || !m_deferred_nal || need > VDEC_DEFERRED_NAL_SIZE)
+  {
+    parse_deferred_extradata();
+    h264_parser->parse_nal((OMX_U8*)extra->data, extra->nDataSize, nal_type,
+                           nal_type != NALU_TYPE_VUI);
+    return;
   }
-  else if (frm_int > 0)           // In this case the frame rate was set along
-  {                               // with the port definition, start ts with 0
-    act_timestamp = prev_ts = 0;  // and correct if a valid ts is received.
-    rst_prev_ts = true;
+  entry = (struct vdec_deferred_nal *)(m_deferred_nal + m_deferred_nal_len);
+  entry->nal_type = nal_type;
+  entry->size = extra->nDataSize;
+  memcpy(entry + 1, extra->data, extra->nDataSize);
+  m_deferred_nal_len += need;
+}
+
+void omx_vdec::parse_deferred_extradata()
+{
+  struct vdec_deferred_nal *entry;
+  OMX_U32 offset = 0;
+
+  while (offset < m_deferred_nal_len)
+  {
+    entry = (struct vdec_deferred_nal *)(m_deferred_nal + offset);
+    h264_parser->parse_nal((OMX_U8*)(entry + 1), entry->size, entry->nal_type,
+                           entry->nal_type != NALU_TYPE_VUI);
+    offset += sizeof(struct vdec_deferred_nal) + ((entry->size + 3) & (~3));
   }
+  m_deferred_nal_len = 0;
 }
 
 void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
 {
   OMX_OTHER_EXTRADATATYPE *p_extra = NULL, *p_sei = NULL, *p_vui = NULL;
+  OMX_OTHER_EXTRADATATYPE *p_mb = NULL;
+  OMX_U8 *p_end = p_buf_hdr->pBuffer + p_buf_hdr->nAllocLen;
+  // In separate mode the frame is only read, never written
+  bool separate = (m_out_extradata != NULL);
   OMX_U32 num_conceal_MB = 0;
   OMX_S64 ts_in_sei = 0;
   OMX_U32 frame_rate = 0;
@@ -7958,9 +8416,11 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       }
       if (p_extra->eType == VDEC_EXTRADATA_MB_ERROR_MAP)
       {
-        if (client_extradata & OMX_FRAMEINFO_EXTRADATA)
-          num_conceal_MB = count_MB_in_extradata(p_extra);
-        if (client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP)
+        num_conceal_MB = count_MB_in_extradata(p_extra);
+        if (separate)
+          // Copied to the side buffer below
+          p_mb = (client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP) ? p_extra : NULL;
+        else if (client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP)
           // Map driver extradata to corresponding OMX type
           p_extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataConcealMB;
         else
@@ -7972,18 +8432,14 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
       else if (p_extra->eType == VDEC_EXTRADATA_SEI)
       {
         p_sei = p_extra;
-#ifdef MAX_RES_1080P
-        h264_parser->parse_nal((OMX_U8*)p_sei->data, p_sei->nDataSize, NALU_TYPE_SEI);
-#endif
-        p_extra->eType = OMX_ExtraDataMax; // Invalid type to avoid expose this extradata to OMX client
+        if (!separate)
+          p_extra->eType = OMX_ExtraDataMax; // Invalid type to avoid expose this extradata to OMX client
       }
       else if (p_extra->eType == VDEC_EXTRADATA_VUI)
       {
         p_vui = p_extra;
-#ifdef MAX_RES_1080P
-        h264_parser->parse_nal((OMX_U8*)p_vui->data, p_vui->nDataSize, NALU_TYPE_VUI, false);
-#endif
-        p_extra->eType = OMX_ExtraDataMax; // Invalid type to avoid expose this extradata to OMX client
+        if (!separate)
+          p_extra->eType = OMX_ExtraDataMax; // Invalid type to avoid expose this extradata to OMX client
       }
       print_debug_extradata(p_extra);
       p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
@@ -7991,7 +8447,7 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
           p_extra->nDataSize == 0 || p_extra->nSize == 0)
         p_extra = NULL;
     }
-    if (!(client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP))
+    if (!separate && !(client_extradata & VDEC_EXTRADATA_MB_ERROR_MAP))
     {
       // Driver extradata is only exposed if MB map is requested by client,
       // otherwise can be overwritten by omx extradata.
@@ -8005,24 +8461,74 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
 #ifdef PROCESS_EXTRADATA_IN_OUTPUT_PORT
   if (drv_ctx.decoder_format == VDEC_CODECTYPE_H264)
   {
+    // Each record is parsed once, right away only if a record emitted
+    // for this frame depends on it
+    if (p_vui)
+      parse_extradata_nal(p_vui, NALU_TYPE_VUI, !(client_extradata &
+        (OMX_TIMEINFO_EXTRADATA | OMX_FRAMEINFO_EXTRADATA | OMX_INTERLACE_EXTRADATA)));
+    if (p_sei)
+      parse_extradata_nal(p_sei, NALU_TYPE_SEI, !(client_extradata &
+        (OMX_TIMEINFO_EXTRADATA | OMX_FRAMEINFO_EXTRADATA)));
     if (client_extradata & OMX_TIMEINFO_EXTRADATA)
     {
-      if (p_vui)
-        h264_parser->parse_nal((OMX_U8*)p_vui->data, p_vui->nDataSize, NALU_TYPE_VUI, false);
-      if (p_sei)
-        h264_parser->parse_nal((OMX_U8*)p_sei->data, p_sei->nDataSize, NALU_TYPE_SEI);
       ts_in_sei = h264_parser->process_ts_with_sei_vui(p_buf_hdr->nTimeStamp);
       if (!VALID_TS(p_buf_hdr->nTimeStamp))
         p_buf_hdr->nTimeStamp = ts_in_sei;
+      m_pts_fields = h264_parser->get_field_count();
     }
-    else if ((client_extradata & OMX_FRAMEINFO_EXTRADATA) && p_sei)
-      // If timeinfo is present frame info from SEI is already processed
-      h264_parser->parse_nal((OMX_U8*)p_sei->data, p_sei->nDataSize, NALU_TYPE_SEI);
   }
 #endif
-   if ((client_extradata & OMX_INTERLACE_EXTRADATA) && p_extra &&
+  if (separate)
+  {
+    p_extra = get_separate_extradata(p_buf_hdr);
+    p_end = (OMX_U8 *)p_extra + m_out_extradata_stride;
+    p_buf_hdr->nFlags &= ~OMX_BUFFERFLAG_EXTRADATA;
+    if (p_mb && ((OMX_U8*)p_extra + p_mb->nSize) < p_end)
+    {
+      p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
+      memcpy(p_extra, p_mb, p_mb->nSize);
+      p_extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataConcealMB;
+      p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
+    }
+  }
+  if (m_extradata_tmpl_dirty)
+    build_extradata_template();
+  if (m_extradata_tmpl_len && p_extra &&
+      ((OMX_U8*)p_extra + m_extradata_tmpl_len + OMX_FRAMEINFO_EXTRADATA_SIZE) < p_end)
+  {
+    // Every record fits, refresh the per frame fields and copy the
+    // records with their terminator in one go
+    if (m_tmpl_interlace_off >= 0)
+      fill_interlace_format((OMX_STREAMINTERLACEFORMAT *)
+        ((OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + m_tmpl_interlace_off))->data,
+        ((struct vdec_output_frameinfo *)p_buf_hdr->pOutputPortPrivate)->interlaced_format);
+    if (m_tmpl_frameinfo_off >= 0)
+    {
+      if (h264_parser)
+        h264_parser->get_frame_rate(&frame_rate);
+      fill_frame_info((OMX_QCOM_EXTRADATA_FRAMEINFO *)
+        ((OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + m_tmpl_frameinfo_off))->data,
+        num_conceal_MB,
+        ((struct vdec_output_frameinfo *)p_buf_hdr->pOutputPortPrivate)->pic_type,
+        p_buf_hdr->nTimeStamp, frame_rate);
+    }
+    memcpy(p_extra, m_extradata_tmpl,
+           m_extradata_tmpl_len + sizeof(OMX_OTHER_EXTRADATATYPE));
+    p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
+    if (m_debug_extradata)
+    {
+      while (p_extra->eType != OMX_ExtraDataNone)
+      {
+        print_debug_extradata(p_extra);
+        p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
+      }
+      print_debug_extradata(p_extra);
+    }
+    return;
+  }
+  if ((client_extradata & OMX_INTERLACE_EXTRADATA) && p_extra &&
       ((OMX_U8*)p_extra + OMX_INTERLACE_EXTRADATA_SIZE) <
-       (p_buf_hdr->pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     append_interlace_extradata(p_extra,
@@ -8031,7 +8537,7 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
   }
   if (client_extradata & OMX_FRAMEINFO_EXTRADATA && p_extra &&
       ((OMX_U8*)p_extra + OMX_FRAMEINFO_EXTRADATA_SIZE) <
-       (p_buf_hdr->pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     /* vui extra data (frame_rate) information */
@@ -8045,22 +8551,26 @@ void omx_vdec::handle_extradata(OMX_BUFFERHEADERTYPE *p_buf_hdr)
   if ((client_extradata & OMX_PORTDEF_EXTRADATA) &&
        p_extra != NULL &&
       ((OMX_U8*)p_extra + OMX_PORTDEF_EXTRADATA_SIZE) <
-       (p_buf_hdr->pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
   {
     p_buf_hdr->nFlags |= OMX_BUFFERFLAG_EXTRADATA;
     append_portdef_extradata(p_extra);
     p_extra = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_extra) + p_extra->nSize);
   }
   if (p_buf_hdr->nFlags & OMX_BUFFERFLAG_EXTRADATA)
+  {
     if (p_extra &&
       ((OMX_U8*)p_extra + OMX_FRAMEINFO_EXTRADATA_SIZE) <
-       (p_buf_hdr->pBuffer + p_buf_hdr->nAllocLen))
+       p_end)
       append_terminator_extradata(p_extra);
     else
     {
       DEBUG_PRINT_ERROR("ERROR: Terminator extradata cannot be added");
       p_buf_hdr->nFlags &= ~OMX_BUFFERFLAG_EXTRADATA;
     }
+  }
+  else if (separate)
+    append_terminator_extradata(p_extra); // Drop records of the last use
 }
 
 OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enable)
@@ -8102,9 +8612,12 @@ OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enabl
                           VDEC_EXTRADATA_SEI : 0); // Required for pan scan frame info
     driver_extradata |= ((requested_extradata & OMX_TIMEINFO_EXTRADATA)?
                           VDEC_EXTRADATA_VUI | VDEC_EXTRADATA_SEI : 0); //Required for time info
+    driver_extradata |= ((requested_extradata & OMX_STREAMINFO_EXTRADATA)?
+                          VDEC_EXTRADATA_VUI | VDEC_EXTRADATA_SEI : 0); //Parsed on read
   }
 
 #endif
+  m_extradata_tmpl_dirty = true;
   if (driver_extradata != drv_ctx.extradata)
   {
     client_extradata = requested_extradata;
@@ -8123,6 +8636,8 @@ OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enabl
   else if ((client_extradata & ~DRIVER_EXTRADATA_MASK) != (requested_extradata & ~DRIVER_EXTRADATA_MASK))
   {
     client_extradata = requested_extradata;
+    if (m_sep_extradata) // OMX extradata does not take frame space
+      return ret;
     drv_ctx.op_buf.buffer_size += extradata_size;
     // align the buffer size
     drv_ctx.op_buf.buffer_size = (drv_ctx.op_buf.buffer_size + drv_ctx.op_buf.alignment - 1)&(~(drv_ctx.op_buf.alignment - 1));
@@ -8134,24 +8649,167 @@ OMX_ERRORTYPE omx_vdec::enable_extradata(OMX_U32 requested_extradata, bool enabl
   return ret;
 }
 
+static inline OMX_U32 vdec_popcount32(OMX_U32 x)
+{
+  x = x - ((x >> 1) & 0x55555555);
+  x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+  return (((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::count_MB_in_extradata
+
+DESCRIPTION
+  Counts the concealed MBs in a driver MB error map (one bit per MB) and
+  updates the concealment statistics. Error free maps, the common case,
+  are recognised with a single OR pass; otherwise the bits are counted a
+  word (or with NEON sixteen bytes) at a time.
+
+PARAMETERS
+  extra - VDEC_EXTRADATA_MB_ERROR_MAP record.
+
+RETURN VALUE
+  Percentage of the frame MBs that were concealed.
+
+========================================================================== */
 OMX_U32 omx_vdec::count_MB_in_extradata(OMX_OTHER_EXTRADATATYPE *extra)
 {
-  OMX_U32 num_MB = 0, byte_count = 0, num_MB_in_frame = 0;
-  OMX_U8 *data_ptr = extra->data, data = 0;
-  while (byte_count < extra->nDataSize)
-  {
-    data = *data_ptr;
-    while (data)
-    {
-      num_MB += (data&0x01);
-      data >>= 1;
-    }
-    data_ptr++;
-    byte_count++;
+  OMX_U32 num_MB = 0, byte_count = 0, num_MB_in_frame = 0, percent = 0;
+  OMX_U32 size = extra->nDataSize, any = 0;
+  const OMX_U8 *data_ptr = extra->data;
+  const OMX_U32 *word_ptr;
+
+  // Bytes up to the first word boundary, records are normally aligned
+  for (; byte_count < size && ((unsigned long)(data_ptr + byte_count) & 3); byte_count++)
+    num_MB += vdec_popcount32(data_ptr[byte_count]);
+  word_ptr = (const OMX_U32 *)(data_ptr + byte_count);
+  any = num_MB;
+  for (OMX_U32 i = 0; i < ((size - byte_count) >> 2) && !any; i++)
+    any = word_ptr[i];
+  for (OMX_U32 i = byte_count + ((size - byte_count) & ~3); i < size && !any; i++)
+    any = data_ptr[i];
+  if (any)
+  {
+#ifdef __ARM_NEON__
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; byte_count + 16 <= size; byte_count += 16)
+      acc = vpadalq_u16(acc, vpaddlq_u8(vcntq_u8(vld1q_u8(data_ptr + byte_count))));
+    num_MB += vgetq_lane_u32(acc, 0) + vgetq_lane_u32(acc, 1) +
+              vgetq_lane_u32(acc, 2) + vgetq_lane_u32(acc, 3);
+    word_ptr = (const OMX_U32 *)(data_ptr + byte_count);
+#endif
+    for (; byte_count + 4 <= size; byte_count += 4, word_ptr++)
+      if (*word_ptr)
+        num_MB += vdec_popcount32(*word_ptr);
+    for (; byte_count < size; byte_count++)
+      num_MB += vdec_popcount32(data_ptr[byte_count]);
   }
   num_MB_in_frame = ((drv_ctx.video_resolution.frame_width + 15) *
                      (drv_ctx.video_resolution.frame_height + 15)) >> 8;
-  return ((num_MB_in_frame > 0)?(num_MB * 100 / num_MB_in_frame) : 0);
+  percent = (num_MB_in_frame > 0)?(num_MB * 100 / num_MB_in_frame) : 0;
+  m_conceal_stats.nLastConcealedMBs = num_MB;
+  m_conceal_stats.nLastConcealPercent = percent;
+  m_conceal_stats.nFrames++;
+  if (num_MB)
+    m_conceal_stats.nFramesWithErrors++;
+  m_conceal_stats.nConcealedMBs += num_MB;
+  return percent;
+}
+
+/*
+ * Opens the dumps asked for at build time or through properties. The
+ * sampling properties apply to all three files:
+ *   vidc.dec.debug.dump.input      bitstream file
+ *   vidc.dec.debug.dump.output     YUV file
+ *   vidc.dec.debug.dump.extradata  extradata file
+ *   vidc.dec.debug.dump.interval   keep every Nth buffer (1)
+ *   vidc.dec.debug.dump.errors     keep only corrupt/concealed buffers
+ *   vidc.dec.debug.dump.ring       ring size per file in MB (8)
+ * The OMX call recording for mm-video-omx-replay is separate:
+ *   vidc.dec.debug.record          recording file, rewritten per session
+ *   vidc.dec.debug.record.ring     ring size in MB (32)
+ */
+void omx_vdec::init_dumps()
+{
+  OMX_U32 interval = 1, ring = 0;
+  bool errors_only = false;
+#ifdef _ANDROID_
+  char property_value[PROPERTY_VALUE_MAX] = {0};
+
+  property_get("vidc.dec.debug.dump.interval", property_value, "1");
+  interval = atoi(property_value);
+  property_get("vidc.dec.debug.dump.errors", property_value, "0");
+  errors_only = atoi(property_value) != 0;
+  property_get("vidc.dec.debug.dump.ring", property_value, "0");
+  ring = atoi(property_value) << 20;
+#endif
+  m_input_dump.set_sampling(interval, errors_only);
+  m_output_dump.set_sampling(interval, errors_only);
+  m_extradata_dump.set_sampling(interval, errors_only);
+#ifdef INPUT_BUFFER_LOG
+  m_input_dump.open(inputfilename, ring);
+#endif
+#ifdef OUTPUT_BUFFER_LOG
+  m_output_dump.open(outputfilename, ring);
+#endif
+#ifdef OUTPUT_EXTRADATA_LOG
+  m_extradata_dump.open(ouputextradatafilename, ring);
+#endif
+#ifdef _ANDROID_
+  if (property_get("vidc.dec.debug.dump.input", property_value, NULL) > 0)
+    m_input_dump.open(property_value, ring);
+  if (property_get("vidc.dec.debug.dump.output", property_value, NULL) > 0)
+    m_output_dump.open(property_value, ring);
+  if (property_get("vidc.dec.debug.dump.extradata", property_value, NULL) > 0)
+    m_extradata_dump.open(property_value, ring);
+  if (property_get("vidc.dec.debug.record", property_value, NULL) > 0)
+  {
+    char record_ring[PROPERTY_VALUE_MAX] = {0};
+    property_get("vidc.dec.debug.record.ring", record_ring, "0");
+    m_recorder.open(property_value, drv_ctx.kind, atoi(record_ring) << 20);
+  }
+#endif
+}
+
+/*
+ * Queues a decoded frame and its extradata chain to the dump writers.
+ * Both dumps see every frame with the same error flag, so with equal
+ * sampling they keep the same frames.
+ */
+void omx_vdec::dump_output(OMX_BUFFERHEADERTYPE *buffer, bool error)
+{
+  OMX_OTHER_EXTRADATATYPE *p_extra, *p_last;
+  OMX_U8 *p_end = buffer->pBuffer + buffer->nAllocLen;
+  OMX_U32 len = 0;
+
+  m_output_dump.write(buffer->pBuffer + buffer->nOffset,
+                      buffer->nFilledLen, error);
+  if (!m_extradata_dump.sample(error))
+    return;
+  p_extra = (OMX_OTHER_EXTRADATATYPE *)
+         ((unsigned)(buffer->pBuffer + buffer->nOffset +
+          buffer->nFilledLen + 3)&(~3));
+  if (m_out_extradata)
+  {
+    p_extra = get_separate_extradata(buffer);
+    p_end = (OMX_U8 *)p_extra + m_out_extradata_stride;
+  }
+  // The chain is contiguous, size it and queue it as one piece
+  p_last = p_extra;
+  while (p_last && (OMX_U8 *)p_last < p_end && p_last->nSize &&
+         (OMX_U8 *)p_last + p_last->nSize <= p_end)
+  {
+    len += p_last->nSize;
+    if (p_last->eType == OMX_ExtraDataNone)
+      break;
+    p_last = (OMX_OTHER_EXTRADATATYPE *) (((OMX_U8 *) p_last) + p_last->nSize);
+  }
+  if (len && m_extradata_dump.begin(len))
+  {
+    m_extradata_dump.append(p_extra, len);
+    m_extradata_dump.commit();
+  }
 }
 
 void omx_vdec::print_debug_extradata(OMX_OTHER_EXTRADATATYPE *extra)
@@ -8233,7 +8891,6 @@ void omx_vdec::append_interlace_extradata(OMX_OTHER_EXTRADATATYPE *extra,
                                           OMX_U32 interlaced_format_type)
 {
   OMX_STREAMINTERLACEFORMAT *interlace_format;
-  OMX_U32 mbaff = 0;
   extra->nSize = OMX_INTERLACE_EXTRADATA_SIZE;
   extra->nVersion.nVersion = OMX_SPEC_VERSION;
   extra->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
@@ -8243,6 +8900,15 @@ void omx_vdec::append_interlace_extradata(OMX_OTHER_EXTRADATATYPE *extra,
   interlace_format->nSize = sizeof(OMX_STREAMINTERLACEFORMAT);
   interlace_format->nVersion.nVersion = OMX_SPEC_VERSION;
   interlace_format->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+  fill_interlace_format(interlace_format, interlaced_format_type);
+  print_debug_extradata(extra);
+}
+
+/* Per frame part of the interlace extradata */
+void omx_vdec::fill_interlace_format(OMX_STREAMINTERLACEFORMAT *interlace_format,
+                                     OMX_U32 interlaced_format_type)
+{
+  OMX_U32 mbaff = 0;
   mbaff = (h264_parser)? (h264_parser->is_mbaff()): false;
   if ((interlaced_format_type == VDEC_InterlaceFrameProgressive)  && !mbaff)
   {
@@ -8256,7 +8922,6 @@ void omx_vdec::append_interlace_extradata(OMX_OTHER_EXTRADATATYPE *extra,
     interlace_format->nInterlaceFormats = OMX_InterlaceInterleaveFrameTopFieldFirst;
     drv_ctx.interlace = VDEC_InterlaceInterleaveFrameTopFieldFirst;
   }
-  print_debug_extradata(extra);
 }
 
 void omx_vdec::append_frame_info_extradata(OMX_OTHER_EXTRADATATYPE *extra,
@@ -8269,6 +8934,14 @@ void omx_vdec::append_frame_info_extradata(OMX_OTHER_EXTRADATATYPE *extra,
   extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataFrameInfo;
   extra->nDataSize = sizeof(OMX_QCOM_EXTRADATA_FRAMEINFO);
   frame_info = (OMX_QCOM_EXTRADATA_FRAMEINFO *)extra->data;
+  fill_frame_info(frame_info, num_conceal_mb, picture_type, timestamp, frame_rate);
+  print_debug_extradata(extra);
+}
+
+/* Per frame part of the frame info extradata */
+void omx_vdec::fill_frame_info(OMX_QCOM_EXTRADATA_FRAMEINFO *frame_info,
+    OMX_U32 num_conceal_mb, OMX_U32 picture_type, OMX_S64 timestamp, OMX_U32 frame_rate)
+{
   switch (picture_type)
   {
     case PICTURE_TYPE_I:
@@ -8298,7 +8971,6 @@ void omx_vdec::append_frame_info_extradata(OMX_OTHER_EXTRADATATYPE *extra,
   }
   frame_info->nConcealedMacroblocks = num_conceal_mb;
   frame_info->nFrameRate = frame_rate;
-  print_debug_extradata(extra);
 }
 
 void omx_vdec::append_portdef_extradata(OMX_OTHER_EXTRADATATYPE *extra)
@@ -8318,6 +8990,81 @@ void omx_vdec::append_portdef_extradata(OMX_OTHER_EXTRADATATYPE *extra)
      portDefn->format.video.nSliceHeight);
 }
 
+/* ======================================================================
+FUNCTION
+  omx_vdec::build_extradata_template
+
+DESCRIPTION
+  Lays out the enabled OMX extradata records (interlace, frame info,
+  port definition and terminator) once, in the order handle_extradata
+  appends them. Per frame only the interlace and frame info payloads
+  are refreshed before the whole block is copied to the buffer.
+
+PARAMETERS
+  None.
+
+RETURN VALUE
+  None. Leaves an empty template if allocation fails, in which case
+  records are appended one by one.
+
+========================================================================== */
+void omx_vdec::build_extradata_template()
+{
+  OMX_U32 size = 0, offset = 0;
+  OMX_OTHER_EXTRADATATYPE *extra;
+
+  m_extradata_tmpl_dirty = false;
+  m_extradata_tmpl_len = 0;
+  m_tmpl_interlace_off = m_tmpl_frameinfo_off = -1;
+  if (client_extradata & (OMX_INTERLACE_EXTRADATA | OMX_FRAMEINFO_EXTRADATA |
+                          OMX_PORTDEF_EXTRADATA))
+    size = get_omx_extradata_size();
+  if (m_extradata_tmpl)
+    free(m_extradata_tmpl);
+  m_extradata_tmpl = size ? (OMX_U8 *)calloc(size, 1) : NULL;
+  if (!m_extradata_tmpl)
+    return;
+
+  // Headers only, the payloads are filled per frame; filling them here
+  // would consume pan scan state and reset drv_ctx.interlace
+  if (client_extradata & OMX_INTERLACE_EXTRADATA)
+  {
+    OMX_STREAMINTERLACEFORMAT *interlace_format;
+    extra = (OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + offset);
+    extra->nSize = OMX_INTERLACE_EXTRADATA_SIZE;
+    extra->nVersion.nVersion = OMX_SPEC_VERSION;
+    extra->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+    extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataInterlaceFormat;
+    extra->nDataSize = sizeof(OMX_STREAMINTERLACEFORMAT);
+    interlace_format = (OMX_STREAMINTERLACEFORMAT *)extra->data;
+    interlace_format->nSize = sizeof(OMX_STREAMINTERLACEFORMAT);
+    interlace_format->nVersion.nVersion = OMX_SPEC_VERSION;
+    interlace_format->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+    m_tmpl_interlace_off = offset;
+    offset += extra->nSize;
+  }
+  if (client_extradata & OMX_FRAMEINFO_EXTRADATA)
+  {
+    extra = (OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + offset);
+    extra->nSize = OMX_FRAMEINFO_EXTRADATA_SIZE;
+    extra->nVersion.nVersion = OMX_SPEC_VERSION;
+    extra->nPortIndex = OMX_CORE_OUTPUT_PORT_INDEX;
+    extra->eType = (OMX_EXTRADATATYPE)OMX_ExtraDataFrameInfo;
+    extra->nDataSize = sizeof(OMX_QCOM_EXTRADATA_FRAMEINFO);
+    m_tmpl_frameinfo_off = offset;
+    offset += extra->nSize;
+  }
+  if (client_extradata & OMX_PORTDEF_EXTRADATA)
+  {
+    extra = (OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + offset);
+    append_portdef_extradata(extra);
+    offset += extra->nSize;
+  }
+  append_terminator_extradata((OMX_OTHER_EXTRADATATYPE *)(m_extradata_tmpl + offset));
+  m_extradata_tmpl_len = offset;
+  DEBUG_PRINT_LOW("Extradata template: %u bytes", m_extradata_tmpl_len);
+}
+
 void omx_vdec::append_terminator_extradata(OMX_OTHER_EXTRADATATYPE *extra)
 {
   extra->nSize = sizeof(OMX_OTHER_EXTRADATATYPE);
@@ -8355,18 +9102,126 @@ OMX_ERRORTYPE  omx_vdec::allocate_desc_buffer(OMX_U32 index)
     DEBUG_PRINT_ERROR("\ndesc buffer Allocation failed ");
     return OMX_ErrorInsufficientResources;
   }
+  m_desc_buffer_ptr[index].alloc_size = DESC_BUFFER_SIZE;
+  m_desc_buffer_ptr[index].desc_data_size = 0;
+  m_mem_stats.allocated(QOMX_VIDEO_MEM_DESC, DESC_BUFFER_SIZE);
+  m_mem_stats.mapped(QOMX_VIDEO_MEM_DESC, DESC_BUFFER_SIZE);
 
   return eRet;
 }
 
-void omx_vdec::insert_demux_addr_offset(OMX_U32 address_offset)
+/* ======================================================================
+FUNCTION
+  omx_vdec::grow_desc_buffer
+
+DESCRIPTION
+  Doubles the desc buffer of an input buffer until it holds at least
+  size bytes. Entries already written are preserved.
+
+PARAMETERS
+  index - input buffer index.
+  size  - minimum number of bytes required.
+
+RETURN VALUE
+  OMX_ErrorNone on success, OMX_ErrorInsufficientResources otherwise.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::grow_desc_buffer(OMX_U32 index, OMX_U32 size)
+{
+  OMX_U32 new_size = m_desc_buffer_ptr[index].alloc_size;
+  OMX_U8 *new_addr = NULL;
+
+  if (!new_size)
+    new_size = DESC_BUFFER_SIZE;
+  while (new_size < size)
+    new_size <<= 1;
+  new_addr = (OMX_U8 *)realloc(m_desc_buffer_ptr[index].buf_addr, new_size);
+  if (new_addr == NULL)
+  {
+    DEBUG_PRINT_ERROR("\n desc buffer grow to %d bytes failed", new_size);
+    return OMX_ErrorInsufficientResources;
+  }
+  DEBUG_PRINT_HIGH("\n desc buffer[%d] grown %d -> %d bytes", index,
+                   m_desc_buffer_ptr[index].alloc_size, new_size);
+  m_mem_stats.allocated(QOMX_VIDEO_MEM_DESC,
+                        new_size - m_desc_buffer_ptr[index].alloc_size);
+  m_mem_stats.mapped(QOMX_VIDEO_MEM_DESC,
+                     new_size - m_desc_buffer_ptr[index].alloc_size);
+  m_desc_buffer_ptr[index].buf_addr = new_addr;
+  m_desc_buffer_ptr[index].alloc_size = new_size;
+  return OMX_ErrorNone;
+}
+
+/* ======================================================================
+FUNCTION
+  omx_vdec::insert_demux_addr_offset
+
+DESCRIPTION
+  Appends the descriptor of the NAL starting at address_offset straight
+  into the desc buffer of buf_hdr. The size of the previous NAL is
+  completed now that its end is known; the new entry is sized up to the
+  end of the filled data until the next start code is found.
+
+PARAMETERS
+  buf_hdr        - input buffer being demuxed.
+  address_offset - offset of the start code.
+
+RETURN VALUE
+  OMX_ErrorNone on success, error otherwise.
+
+========================================================================== */
+OMX_ERRORTYPE omx_vdec::insert_demux_addr_offset(OMX_BUFFERHEADERTYPE *buf_hdr,
+                                                 OMX_U32 address_offset)
 {
+  OMX_U32 buffer_index = buf_hdr - m_inp_mem_ptr;
+  OMX_U32 *entry = NULL;
+  OMX_U32 desc_data = 0;
+  OMX_U32 suffix_byte = 0;
+
+  if (!m_desc_buffer_ptr || buffer_index >= drv_ctx.ip_buf.actualcount ||
+      !m_desc_buffer_ptr[buffer_index].buf_addr)
+  {
+    DEBUG_PRINT_ERROR("insert_demux_addr_offset: no desc buffer (%d)", buffer_index);
+    return OMX_ErrorBadParameter;
+  }
+  // Keep room for this entry, a VC1 terminator entry and the end word
+  if (((m_demux_entries + 2) * DESC_ENTRY_SIZE + sizeof(OMX_U32)) >
+      m_desc_buffer_ptr[buffer_index].alloc_size &&
+      grow_desc_buffer(buffer_index, (m_demux_entries + 2) * DESC_ENTRY_SIZE +
+                       sizeof(OMX_U32)) != OMX_ErrorNone)
+  {
+    return OMX_ErrorInsufficientResources;
+  }
   DEBUG_PRINT_LOW("Inserting address offset (%d) at idx (%d)", address_offset,m_demux_entries);
-  if (m_demux_entries < 8192)
+
+  entry = (OMX_U32 *)(m_desc_buffer_ptr[buffer_index].buf_addr +
+                      m_demux_entries * DESC_ENTRY_SIZE);
+  if (m_demux_entries)
   {
-    m_demux_offsets[m_demux_entries++] = address_offset;
+    // nal_size of the previous entry
+    entry[1 - (DESC_ENTRY_SIZE / sizeof(OMX_U32))] =
+      address_offset - m_demux_last_offset - 2;
   }
-  return;
+  if (buf_hdr->pBuffer[address_offset + 2] == 0x01)
+  {
+    suffix_byte = buf_hdr->pBuffer[address_offset + 3];
+  }
+  else
+  {
+    suffix_byte = buf_hdr->pBuffer[address_offset + 4];
+  }
+  desc_data = (address_offset >> 3) << 1;
+  desc_data |= (address_offset & 7) << 21;
+  desc_data |= suffix_byte << 24;
+
+  entry[0] = desc_data;
+  entry[1] = buf_hdr->nFilledLen - address_offset - 2;
+  entry[2] = 0;
+  entry[3] = 0;
+
+  m_demux_last_offset = address_offset;
+  m_demux_entries++;
+  return OMX_ErrorNone;
 }
 
 void omx_vdec::extract_demux_addr_offsets(OMX_BUFFERHEADERTYPE *buf_hdr)
@@ -8385,7 +9240,11 @@ void omx_vdec::extract_demux_addr_offsets(OMX_BUFFERHEADERTYPE *buf_hdr)
           (buf[index+2] == 0x01)) )
     {
       //Found start code, insert address offset
-      insert_demux_addr_offset(index);
+      if (insert_demux_addr_offset(buf_hdr, index) != OMX_ErrorNone)
+      {
+        DEBUG_PRINT_ERROR("Demux table truncated at (%d) entries",m_demux_entries);
+        break;
+      }
       if (buf[index+2] == 0x01) // 3 byte start code
         index += 3;
       else                      //4 byte start code
@@ -8400,93 +9259,52 @@ void omx_vdec::extract_demux_addr_offsets(OMX_BUFFERHEADERTYPE *buf_hdr)
 
 OMX_ERRORTYPE omx_vdec::handle_demux_data(OMX_BUFFERHEADERTYPE *p_buf_hdr)
 {
-  //fix this, handle 3 byte start code, vc1 terminator entry
+  // NAL entries are already in place, written by insert_demux_addr_offset.
+  // Only the VC1 terminator entry and the end of table word are added here.
   OMX_U8 *p_demux_data = NULL;
   OMX_U32 desc_data = 0;
-  OMX_U32 start_addr = 0;
-  OMX_U32 nal_size = 0;
-  OMX_U32 suffix_byte = 0;
-  OMX_U32 demux_index = 0;
   OMX_U32 buffer_index = 0;
 
   if (m_desc_buffer_ptr == NULL)
   {
     DEBUG_PRINT_ERROR("m_desc_buffer_ptr is NULL. Cannot append demux entries.");
+    m_demux_entries = 0;
     return OMX_ErrorBadParameter;
   }
 
   buffer_index = p_buf_hdr - ((OMX_BUFFERHEADERTYPE *)m_inp_mem_ptr);
-  if (buffer_index > drv_ctx.ip_buf.actualcount)
+  if (buffer_index >= drv_ctx.ip_buf.actualcount)
   {
     DEBUG_PRINT_ERROR("handle_demux_data:Buffer index is incorrect (%d)", buffer_index);
+    m_demux_entries = 0;
     return OMX_ErrorBadParameter;
   }
 
   p_demux_data = (OMX_U8 *) m_desc_buffer_ptr[buffer_index].buf_addr;
-
-  if ( ((OMX_U8*)p_demux_data == NULL) ||
-      ((m_demux_entries * 16) + 1) > DESC_BUFFER_SIZE)
+  if (p_demux_data == NULL)
   {
     DEBUG_PRINT_ERROR("Insufficient buffer. Cannot append demux entries.");
+    m_demux_entries = 0;
     return OMX_ErrorBadParameter;
   }
-  else
+  // insert_demux_addr_offset keeps room for the entries below, an empty
+  // table still fits in the initial allocation
+  p_demux_data += m_demux_entries * DESC_ENTRY_SIZE;
+  if (codec_type_parse == CODEC_TYPE_VC1)
   {
-    for (; demux_index < m_demux_entries; demux_index++)
-    {
-      desc_data = 0;
-      start_addr = m_demux_offsets[demux_index];
-      if (p_buf_hdr->pBuffer[m_demux_offsets[demux_index] + 2] == 0x01)
-      {
-        suffix_byte = p_buf_hdr->pBuffer[m_demux_offsets[demux_index] + 3];
-      }
-      else
-      {
-        suffix_byte = p_buf_hdr->pBuffer[m_demux_offsets[demux_index] + 4];
-      }
-      if (demux_index < (m_demux_entries - 1))
-      {
-        nal_size = m_demux_offsets[demux_index + 1] - m_demux_offsets[demux_index] - 2;
-      }
-      else
-      {
-        nal_size = p_buf_hdr->nFilledLen - m_demux_offsets[demux_index] - 2;
-      }
-      DEBUG_PRINT_LOW("Start_addr(%p), suffix_byte(0x%x),nal_size(%d),demux_index(%d)",
-                        start_addr,
-                        suffix_byte,
-                        nal_size,
-                        demux_index);
-      desc_data = (start_addr >> 3) << 1;
-      desc_data |= (start_addr & 7) << 21;
-      desc_data |= suffix_byte << 24;
-
-      memcpy(p_demux_data, &desc_data, sizeof(OMX_U32));
-      memcpy(p_demux_data + 4, &nal_size, sizeof(OMX_U32));
-      memset(p_demux_data + 8, 0, sizeof(OMX_U32));
-      memset(p_demux_data + 12, 0, sizeof(OMX_U32));
-
-      p_demux_data += 16;
-    }
-    if (codec_type_parse == CODEC_TYPE_VC1)
-    {
-      DEBUG_PRINT_LOW("VC1 terminator entry");
-      desc_data = 0;
-      desc_data = 0x82 << 24;
-      memcpy(p_demux_data, &desc_data, sizeof(OMX_U32));
-      memset(p_demux_data + 4, 0, sizeof(OMX_U32));
-      memset(p_demux_data + 8, 0, sizeof(OMX_U32));
-      memset(p_demux_data + 12, 0, sizeof(OMX_U32));
-      p_demux_data += 16;
-      m_demux_entries++;
-    }
-    //Add zero word to indicate end of descriptors
-    memset(p_demux_data, 0, sizeof(OMX_U32));
-
-    m_desc_buffer_ptr[buffer_index].desc_data_size = (m_demux_entries * 16) + sizeof(OMX_U32);
-    DEBUG_PRINT_LOW("desc table data size=%d", m_desc_buffer_ptr[buffer_index].desc_data_size);
+    DEBUG_PRINT_LOW("VC1 terminator entry");
+    desc_data = 0x82 << 24;
+    memcpy(p_demux_data, &desc_data, sizeof(OMX_U32));
+    memset(p_demux_data + 4, 0, 3 * sizeof(OMX_U32));
+    p_demux_data += DESC_ENTRY_SIZE;
+    m_demux_entries++;
   }
-  memset(m_demux_offsets, 0, ( sizeof(OMX_U32) * 8192) );
+  //Add zero word to indicate end of descriptors
+  memset(p_demux_data, 0, sizeof(OMX_U32));
+
+  m_desc_buffer_ptr[buffer_index].desc_data_size = (m_demux_entries * DESC_ENTRY_SIZE) +
+                                                   sizeof(OMX_U32);
+  DEBUG_PRINT_LOW("desc table data size=%d", m_desc_buffer_ptr[buffer_index].desc_data_size);
   m_demux_entries = 0;
   DEBUG_PRINT_LOW("Demux table complete!");
   return OMX_ErrorNone;
@@ -8586,6 +9404,9 @@ OMX_ERRORTYPE omx_vdec::vdec_alloc_h264_mv()
     return OMX_ErrorInsufficientResources;
   }
 
+  m_mem_stats.allocated(QOMX_VIDEO_MEM_H264_MV, size);
+  if (!secure_mode)
+    m_mem_stats.mapped(QOMX_VIDEO_MEM_H264_MV, size);
   h264_mv_buff.buffer = (unsigned char *) buf_addr;
   h264_mv_buff.size = size;
   h264_mv_buff.count = drv_ctx.op_buf.actualcount;
@@ -8603,7 +9424,11 @@ void omx_vdec::vdec_dealloc_h264_mv()
       if(ioctl(drv_ctx.video_driver_fd, VDEC_IOCTL_FREE_H264_MV_BUFFER,NULL) < 0)
         DEBUG_PRINT_ERROR("VDEC_IOCTL_FREE_H264_MV_BUFFER failed");
       if(!secure_mode)
+      {
           munmap(h264_mv_buff.buffer, h264_mv_buff.size);
+          m_mem_stats.unmapped(QOMX_VIDEO_MEM_H264_MV, h264_mv_buff.size);
+      }
+      m_mem_stats.released(QOMX_VIDEO_MEM_H264_MV, h264_mv_buff.size);
       close(h264_mv_buff.pmem_fd);
 #ifdef USE_ION
       free_ion_memory(&drv_ctx.h264_mv);
@@ -0,0 +1,203 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+#include <limits.h>
+#include "pts_predictor.h"
+#include "omx_vdec.h"
+
+#define PTS_ABS(x) (((x) < 0) ? -(x) : (x))
+
+pts_predictor::pts_predictor()
+{
+  m_interval = 0;
+  m_min_interval = 0;
+  reset();
+}
+
+void pts_predictor::reset()
+{
+  m_prev_in = LLONG_MAX;
+  m_prev_src = LLONG_MAX;
+  m_prev_out = LLONG_MAX;
+  m_prev_fields = 2;
+  m_prev_real = false;
+  m_restart = true;
+  m_min_changed = false;
+  m_outliers = 0;
+}
+
+/* Nominal interval from the port definition, 0 to learn it */
+void pts_predictor::set_frame_interval(OMX_U32 frame_interval)
+{
+  m_interval = frame_interval;
+  m_min_interval = frame_interval;
+  m_outliers = 0;
+}
+
+bool pts_predictor::min_interval_changed()
+{
+  bool changed = m_min_changed;
+  m_min_changed = false;
+  return changed;
+}
+
+/* ======================================================================
+FUNCTION
+  pts_predictor::observe
+
+DESCRIPTION
+  Tracks the smallest interval between consecutive timestamps, used as
+  the decoder frame rate. Intervals under PTS_DUPLICATE_WINDOW are
+  ignored.
+
+PARAMETERS
+  timestamp - input or output timestamp in microseconds.
+
+RETURN VALUE
+  true if the smallest interval went down.
+
+========================================================================== */
+bool pts_predictor::observe(OMX_S64 timestamp)
+{
+  bool changed = false;
+  if (VALID_TS(timestamp) && VALID_TS(m_prev_in))
+    changed = update_min_interval(PTS_ABS(timestamp - m_prev_in));
+  m_prev_in = timestamp;
+  return changed;
+}
+
+bool pts_predictor::update_min_interval(OMX_S64 delta)
+{
+  if (delta <= PTS_DUPLICATE_WINDOW ||
+      (m_min_interval && delta >= (OMX_S64)m_min_interval))
+    return false;
+  m_min_interval = (OMX_U32)delta;
+  m_min_changed = true;
+  DEBUG_PRINT_LOW("pts_predictor: min interval %lu", m_min_interval);
+  return true;
+}
+
+void pts_predictor::learn_cadence(OMX_S64 delta, OMX_U32 num_fields)
+{
+  OMX_S64 frame_delta;
+  if (delta <= PTS_DUPLICATE_WINDOW)
+    return;
+  frame_delta = delta * 2 / num_fields;
+  if (!m_interval)
+  {
+    m_interval = (OMX_U32)frame_delta;
+    return;
+  }
+  if (frame_delta > 2 * (OMX_S64)m_interval ||
+      2 * frame_delta < (OMX_S64)m_interval)
+  {
+    // Skipped frames, seeks and rate changes; relearn only when persistent
+    if (++m_outliers < PTS_CADENCE_RELOCK)
+      return;
+    m_interval = (OMX_U32)frame_delta;
+  }
+  else
+    m_interval = (OMX_U32)((7 * (OMX_S64)m_interval + frame_delta) >> 3);
+  m_outliers = 0;
+}
+
+/* ======================================================================
+FUNCTION
+  pts_predictor::predict
+
+DESCRIPTION
+  Produces the output timestamp of the next frame.
+
+PARAMETERS
+  timestamp  - timestamp after DTS reordering and SEI substitution,
+               LLONG_MAX if none.
+  num_fields - fields this frame is displayed for (2 for a frame, 3
+               for a repeated field, 1 for a single field). The next
+               prediction advances by this much.
+  tolerant   - treat timestamps within PTS_DUPLICATE_WINDOW of the
+               previous one as repeats.
+
+RETURN VALUE
+  Output timestamp. A valid timestamp that is not a repeat is returned
+  unchanged; only missing or repeated ones are predicted.
+
+========================================================================== */
+OMX_S64 pts_predictor::predict(OMX_S64 timestamp, OMX_U32 num_fields, bool tolerant)
+{
+  OMX_S64 predicted;
+  OMX_U32 fields = m_prev_fields;
+  bool repeat, prev_real = m_prev_real;
+
+  m_prev_fields = num_fields ? num_fields : 2;
+  m_prev_real = false;
+  if ((m_restart || !VALID_TS(m_prev_out)) && VALID_TS(timestamp))
+  {
+    m_prev_src = m_prev_out = timestamp;
+    m_prev_real = true;
+    m_restart = false;
+    return timestamp;
+  }
+  if (!VALID_TS(m_prev_out))
+  {
+    if (m_interval)
+    {
+      // Rate known from the port definition, start at 0 and
+      // correct when a valid timestamp arrives
+      m_prev_out = 0;
+      m_restart = true;
+      return 0;
+    }
+    return timestamp;
+  }
+
+  predicted = m_prev_out + (OMX_S64)m_interval * fields / 2;
+  // Repeats are judged against the stream, not against filled-in values
+  repeat = !VALID_TS(timestamp) || (VALID_TS(m_prev_src) &&
+           (tolerant ? PTS_ABS(timestamp - m_prev_src) <= PTS_DUPLICATE_WINDOW :
+                       timestamp == m_prev_src));
+  if (repeat)
+  {
+    if (!m_interval)
+    {
+      m_prev_out = timestamp;
+      return timestamp;
+    }
+    DEBUG_PRINT_LOW("pts_predictor: original ts[%lld] predicted ts[%lld]",
+                     timestamp, predicted);
+    m_prev_out = predicted;
+    return predicted;
+  }
+
+  // Valid stream timestamps are passed through as they are; only the
+  // interval between two of them counts as an observed frame interval
+  if (prev_real)
+    update_min_interval(PTS_ABS(timestamp - m_prev_src));
+  learn_cadence(timestamp - m_prev_out, fields);
+  m_prev_src = m_prev_out = timestamp;
+  m_prev_real = true;
+  return timestamp;
+}
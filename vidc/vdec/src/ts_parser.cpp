@@ -40,139 +40,113 @@ void omx_time_stamp_reorder::enable_debug_print(bool flag)
 
 omx_time_stamp_reorder::~omx_time_stamp_reorder()
 {
-	delete_list();
+	free(heap);
 }
 
 omx_time_stamp_reorder::omx_time_stamp_reorder()
 {
 	reorder_ts = false;
-	phead = pcurrent = NULL;
+	heap = NULL;
+	heap_count = heap_size = cur_segment = 0;
 	error = false;
         print_debug = false;
 }
 
-void omx_time_stamp_reorder::delete_list()
+/* Makes room for depth outstanding timestamps, never shrinks */
+bool omx_time_stamp_reorder::set_depth(unsigned int depth)
 {
-	time_stamp_list *ptemp;
-	if (!phead) return;
-	while(phead->next != phead) {
-		ptemp = phead;
-		phead = phead->next;
-		phead->prev = ptemp->prev;
-		ptemp->prev->next = phead;
-		delete ptemp;
+	timestamp *grown;
+	if (depth <= heap_size)
+		return true;
+	grown = (timestamp *)realloc(heap, depth * sizeof(timestamp));
+	if (!grown) {
+		DEBUG("\n Failed to grow timestamp heap to %u", depth);
+		return false;
 	}
-	delete phead;
-	phead = NULL;
+	heap = grown;
+	heap_size = depth;
+	return true;
 }
 
-bool omx_time_stamp_reorder::get_current_list()
+void omx_time_stamp_reorder::sift_up(unsigned int idx, timestamp entry)
 {
-	if (!phead) {
-		if(!add_new_list()) {
-			handle_error();
-			return false;
-		}
-	}
-	pcurrent = phead->prev;
-	return true;
+	unsigned int parent;
+	while (idx) {
+		parent = (idx - 1) >> 1;
+		if (!before(entry, heap[parent]))
+			break;
+		heap[idx] = heap[parent];
+		idx = parent;
+	}
+	heap[idx] = entry;
 }
 
-bool omx_time_stamp_reorder::update_head()
+void omx_time_stamp_reorder::sift_down(unsigned int idx, timestamp entry)
 {
-	time_stamp_list *ptemp;
-	if(!phead) return false;
-	if (phead->next != phead) {
-		ptemp = phead;
-		phead = ptemp->next;
-		phead->prev = ptemp->prev;
-		ptemp->prev->next = phead;
-		delete ptemp;
-	}
-	return true;
+	unsigned int child;
+	while ((child = 2 * idx + 1) < heap_count) {
+		if (child + 1 < heap_count && before(heap[child + 1], heap[child]))
+			child++;
+		if (!before(heap[child], entry))
+			break;
+		heap[idx] = heap[child];
+		idx = child;
+	}
+	heap[idx] = entry;
 }
 
-bool omx_time_stamp_reorder::add_new_list()
+void omx_time_stamp_reorder::remove_at(unsigned int idx)
 {
-	bool status = true;
-	time_stamp_list *ptemp = NULL;
-	if (!phead) {
-		ptemp = phead = new time_stamp_list;
-		if (!phead) {
-			handle_error();
-			status = false;
-			return status;
-		}
-		phead->prev = phead->next = phead;
-	} else {
-		ptemp = new time_stamp_list;
-		if (!ptemp) {
-			handle_error();
-			status = false;
-			return status;
-		}
-		ptemp->prev = phead->prev;
-		ptemp->next = phead;
-		phead->prev->next = ptemp;
-		phead->prev = ptemp;
-	}
-	ptemp->entries_filled = 0;
-	for(int i=0; i < TIME_SZ; i++) {
-		ptemp->input_timestamps[i].in_use = false;
-		ptemp->input_timestamps[i].timestamps = -1;
-	}
-	return status;
+	timestamp last = heap[--heap_count];
+	if (idx == heap_count)
+		return;
+	if (idx && before(last, heap[(idx - 1) >> 1]))
+		sift_up(idx, last);
+	else
+		sift_down(idx, last);
+}
+
+/* Index of an entry equal to (segment, ts), -1 if there is none. Only
+ * used when the driver drops a frame, so a scan is good enough */
+int omx_time_stamp_reorder::find(unsigned int segment, OMX_TICKS ts)
+{
+	unsigned int i;
+	for (i = 0; i < heap_count; i++)
+		if (heap[i].segment == segment && heap[i].timestamps == ts)
+			return (int)i;
+	return -1;
 }
 
 bool omx_time_stamp_reorder::insert_timestamp(OMX_BUFFERHEADERTYPE *header)
 {
-	OMX_TICKS *table_entry = NULL;
+	timestamp entry;
 	if (!reorder_ts || error || !header) {
 		if (error || !header)
 			DEBUG("\n Invalid condition in insert_timestamp %p", header);
 		return false;
 	}
-	if(!get_current_list()) {
-		handle_error();
-		return false;
-	}
-	if (pcurrent->entries_filled > (TIME_SZ - 1)) {
-		DEBUG("\n Table full return error");
-		handle_error();
-		return false;
-	}
 	if (header->nFlags & OMX_BUFFERFLAG_CODECCONFIG) {
 		return true;
 	}
 	if ((header->nFlags & OMX_BUFFERFLAG_EOS) && !header->nFilledLen)
 	{
 		DEBUG("\n EOS with zero length recieved");
-		if (!add_new_list()) {
-			handle_error();
-			return false;
-		}
+		cur_segment++;
 		return true;
 	}
-	for(int i = 0; i < TIME_SZ && !table_entry; i++) {
-		if (!pcurrent->input_timestamps[i].in_use) {
-			table_entry = &pcurrent->input_timestamps[i].timestamps;
-			pcurrent->input_timestamps[i].in_use = true;
-			pcurrent->entries_filled++;
-		}
-	}
-	if (!table_entry) {
-		DEBUG("\n All entries in use");
+	if (heap_count == heap_size &&
+	    !set_depth(heap_size ? heap_size * 2 : TIME_SZ)) {
+		DEBUG("\n Table full return error");
 		handle_error();
 		return false;
 	}
-	*table_entry = header->nTimeStamp;
+	entry.timestamps = header->nTimeStamp;
+	entry.segment = cur_segment;
+	sift_up(heap_count++, entry);
         if (print_debug)
 	        DEBUG("Time stamp inserted %lld", header->nTimeStamp);
 	if (header->nFlags & OMX_BUFFERFLAG_EOS) {
-		if (!add_new_list()) {
-			handle_error();
-			return false;
-		}
+		cur_segment++;
 	}
 	return true;
 }
@@ -180,74 +154,45 @@ bool omx_time_stamp_reorder::insert_timestamp(OMX_BUFFERHEADERTYPE *header)
 bool omx_time_stamp_reorder::remove_time_stamp(OMX_TICKS ts, bool is_interlaced = false)
 {
 	unsigned int num_ent_remove = (is_interlaced)?2:1;
+	unsigned int segment;
+	int pos;
 	if (!reorder_ts || error) {
 		DEBUG("\n not in avi mode");
 		return false;
 	}
-	if (!phead || !phead->entries_filled) return false;
-	for(int i=0; i < TIME_SZ && num_ent_remove; i++) {
-		if (phead->input_timestamps[i].in_use && phead->input_timestamps[i].timestamps == ts) {
-				phead->input_timestamps[i].in_use = false;
-				phead->entries_filled--;
-				num_ent_remove--;
-                                if (print_debug)
-		                       DEBUG("Removed TS %lld", ts);
-		}
-	}
-	if (!phead->entries_filled) {
-		if (!update_head()) {
-			handle_error();
-			return false;
-		}
+	if (!heap_count) return false;
+	segment = heap[0].segment;
+	while (num_ent_remove && (pos = find(segment, ts)) >= 0) {
+		remove_at((unsigned int)pos);
+		num_ent_remove--;
+                if (print_debug)
+		       DEBUG("Removed TS %lld", ts);
 	}
 	return true;
 }
 
 void omx_time_stamp_reorder::flush_timestamp()
 {
-	delete_list();
+	heap_count = 0;
 }
 
 bool omx_time_stamp_reorder::get_next_timestamp(OMX_BUFFERHEADERTYPE *header, bool is_interlaced)
 {
-	timestamp *element = NULL,*duplicate = NULL;
-	bool status = false;
+	unsigned int segment;
 	if (!reorder_ts || error || !header) {
 		if (error || !header)
 			DEBUG("\n Invalid condition in insert_timestamp %p", header);
 		return false;
 	}
-	if(!phead || !phead->entries_filled) return false;
-	for(int i=0; i < TIME_SZ; i++) {
-		if (phead->input_timestamps[i].in_use) {
-			status = true;
-			if (!element)
-				element = &phead->input_timestamps[i];
-			else {
-				if (element->timestamps > phead->input_timestamps[i].timestamps){
-					element = &phead->input_timestamps[i];
-					duplicate = NULL;
-				} else if(element->timestamps == phead->input_timestamps[i].timestamps)
-					duplicate = &phead->input_timestamps[i];
-			}
-		}
-	}
-	if (element) {
-		phead->entries_filled--;
-		header->nTimeStamp = element->timestamps;
-                if (print_debug)
-		     DEBUG("Getnext Time stamp %lld", header->nTimeStamp);
-		element->in_use = false;
-	}
-	if(is_interlaced && duplicate) {
-		phead->entries_filled--;
-		duplicate->in_use = false;
-	}
-	if (!phead->entries_filled) {
-		if (!update_head()) {
-			handle_error();
-			return false;
-		}
-	}
-	return status;
+	if (!heap_count) return false;
+	segment = heap[0].segment;
+	header->nTimeStamp = heap[0].timestamps;
+        if (print_debug)
+	     DEBUG("Getnext Time stamp %lld", header->nTimeStamp);
+	remove_at(0);
+	if (is_interlaced && heap_count &&
+	    heap[0].segment == segment &&
+	    heap[0].timestamps == header->nTimeStamp)
+		remove_at(0);
+	return true;
 }
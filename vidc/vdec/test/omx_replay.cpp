@@ -0,0 +1,662 @@
+/*--------------------------------------------------------------------------
+Copyright (c) 2010-2012, Code Aurora Forum. All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright
+      notice, this list of conditions and the following disclaimer in the
+      documentation and/or other materials provided with the distribution.
+    * Neither the name of Code Aurora nor
+      the names of its contributors may be used to endorse or promote
+      products derived from this software without specific prior written
+      permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NON-INFRINGEMENT ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+--------------------------------------------------------------------------*/
+/*
+    Replays a recording taken with vidc.dec.debug.record or
+    vidc.venc.debug.record against the same component, and reports where
+    the callbacks and their timing diverge from the recorded session.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef _ANDROID_
+extern "C"{
+#include<utils/Log.h>
+}
+#define LOG_TAG "OMX-REPLAY"
+#define DEBUG_PRINT_ERROR LOGE
+#else
+#define DEBUG_PRINT_ERROR printf
+#endif /* _ANDROID_ */
+
+#include "OMX_Core.h"
+#include "OMX_Component.h"
+#include "vidc_record.h"
+
+#define REPLAY_MAX_BUFFERS 64
+#define REPLAY_MAX_REPORT  8
+
+struct replay_record {
+  vidc_record_entry entry;
+  const OMX_U8 *payload;
+};
+
+struct replay_buffer {
+  uint64_t id;                  /* header address in the recording */
+  OMX_BUFFERHEADERTYPE *hdr;
+  OMX_U32 port;
+  bool owned;                   /* with the client, free to queue */
+};
+
+/* A callback as seen in either session, kept for the comparison */
+struct replay_callback {
+  uint32_t type;
+  uint64_t time_us;
+  uint32_t param0;              /* event, or filled length */
+  uint32_t param1;              /* data1, or flags */
+  uint32_t param2;              /* data2 */
+  int64_t timestamp;
+};
+
+struct replay_list {
+  replay_callback *items;
+  unsigned count;
+  unsigned size;
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+static OMX_U32 seen[VIDC_RECORD_CB_MAX];
+static replay_buffer buffers[REPLAY_MAX_BUFFERS];
+static unsigned buffer_count;
+static replay_list replayed, recorded;
+static uint64_t start_us;
+static unsigned timeout_ms = 5000;
+static unsigned stalls;
+
+static uint64_t now_us()
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void list_add(replay_list *list, const replay_callback *cb)
+{
+  if (list->count == list->size)
+  {
+    unsigned size = list->size ? list->size * 2 : 256;
+    replay_callback *items = (replay_callback *)
+      realloc(list->items, size * sizeof(*items));
+    if (!items)
+      return;
+    list->items = items;
+    list->size = size;
+  }
+  list->items[list->count++] = *cb;
+}
+
+static replay_buffer *find_buffer(uint64_t id)
+{
+  for (unsigned i = 0; i < buffer_count; i++)
+    if (buffers[i].id == id)
+      return &buffers[i];
+  return NULL;
+}
+
+static replay_buffer *find_header(OMX_BUFFERHEADERTYPE *hdr)
+{
+  for (unsigned i = 0; i < buffer_count; i++)
+    if (buffers[i].hdr == hdr)
+      return &buffers[i];
+  return NULL;
+}
+
+static void returned(uint32_t type, OMX_BUFFERHEADERTYPE *hdr)
+{
+  replay_callback cb;
+  replay_buffer *buf;
+
+  memset(&cb, 0, sizeof(cb));
+  cb.type = type;
+  cb.time_us = now_us() - start_us;
+  cb.param0 = hdr->nFilledLen;
+  cb.param1 = hdr->nFlags;
+  cb.timestamp = hdr->nTimeStamp;
+  pthread_mutex_lock(&lock);
+  buf = find_header(hdr);
+  if (buf)
+    buf->owned = true;
+  list_add(&replayed, &cb);
+  seen[type == VIDC_RECORD_EBD ? VIDC_RECORD_CB_EBD : VIDC_RECORD_CB_FBD]++;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+}
+
+static OMX_ERRORTYPE event_handler(OMX_HANDLETYPE comp, OMX_PTR app_data,
+                                   OMX_EVENTTYPE event, OMX_U32 data1,
+                                   OMX_U32 data2, OMX_PTR event_data)
+{
+  replay_callback cb;
+
+  memset(&cb, 0, sizeof(cb));
+  cb.type = VIDC_RECORD_EVENT;
+  cb.time_us = now_us() - start_us;
+  cb.param0 = event;
+  cb.param1 = data1;
+  cb.param2 = data2;
+  pthread_mutex_lock(&lock);
+  list_add(&replayed, &cb);
+  seen[VIDC_RECORD_CB_EVENT]++;
+  pthread_cond_broadcast(&cond);
+  pthread_mutex_unlock(&lock);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE empty_buffer_done(OMX_HANDLETYPE comp, OMX_PTR app_data,
+                                       OMX_BUFFERHEADERTYPE *hdr)
+{
+  returned(VIDC_RECORD_EBD, hdr);
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE fill_buffer_done(OMX_HANDLETYPE comp, OMX_PTR app_data,
+                                      OMX_BUFFERHEADERTYPE *hdr)
+{
+  returned(VIDC_RECORD_FBD, hdr);
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE callbacks = {event_handler, empty_buffer_done,
+                                     fill_buffer_done};
+
+/* Waits with lock held until pred() holds, false on timeout */
+static bool wait_for(bool (*pred)(const void *), const void *arg)
+{
+  struct timespec ts;
+  int ret = 0;
+
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += timeout_ms / 1000;
+  ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+  if (ts.tv_nsec >= 1000000000)
+  {
+    ts.tv_sec++;
+    ts.tv_nsec -= 1000000000;
+  }
+  while (!pred(arg) && ret != ETIMEDOUT)
+    ret = pthread_cond_timedwait(&cond, &lock, &ts);
+  return pred(arg);
+}
+
+static bool callbacks_caught_up(const void *arg)
+{
+  const vidc_record_entry *entry = (const vidc_record_entry *) arg;
+
+  for (int i = 0; i < VIDC_RECORD_CB_MAX; i++)
+    if (seen[i] < entry->seen[i])
+      return false;
+  return true;
+}
+
+static bool buffer_owned(const void *arg)
+{
+  return ((const replay_buffer *) arg)->owned;
+}
+
+static const char *type_name(uint32_t type)
+{
+  static const char *names[] = {"?", "SendCommand", "SetParameter",
+    "SetConfig", "UseBuffer", "AllocateBuffer", "FreeBuffer",
+    "EmptyThisBuffer", "FillThisBuffer", "Event", "EBD", "FBD"};
+  return type < VIDC_RECORD_TYPE_MAX ? names[type] : names[0];
+}
+
+/*
+ * Reads the whole recording, checks the header and indexes the
+ * records. A gap in seq means the recorder ring overflowed.
+ */
+static replay_record *load(const char *path, vidc_record_file *header,
+                           unsigned *count, OMX_U8 **data)
+{
+  FILE *fp = fopen(path, "rb");
+  long size, pos;
+  unsigned n = 0, size_n = 0, gaps = 0;
+  replay_record *records = NULL;
+
+  if (!fp)
+  {
+    DEBUG_PRINT_ERROR("Cannot open %s\n", path);
+    return NULL;
+  }
+  fseek(fp, 0, SEEK_END);
+  size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  *data = (OMX_U8 *) malloc(size > 0 ? size : 1);
+  if (!*data || size < (long) sizeof(*header) ||
+      fread(*data, 1, size, fp) != (size_t) size)
+  {
+    DEBUG_PRINT_ERROR("Cannot read %s\n", path);
+    fclose(fp);
+    return NULL;
+  }
+  fclose(fp);
+  memcpy(header, *data, sizeof(*header));
+  if (header->magic != VIDC_RECORD_MAGIC ||
+      header->version != VIDC_RECORD_VERSION ||
+      header->entry_size != sizeof(vidc_record_entry))
+  {
+    DEBUG_PRINT_ERROR("%s is not a version %d recording\n", path,
+                      VIDC_RECORD_VERSION);
+    return NULL;
+  }
+  header->component[VIDC_RECORD_NAME_MAX - 1] = 0;
+  pos = sizeof(*header);
+  while (pos + (long) sizeof(vidc_record_entry) <= size)
+  {
+    replay_record rec;
+    memcpy(&rec.entry, *data + pos, sizeof(rec.entry));
+    pos += sizeof(rec.entry);
+    if (pos + (long) rec.entry.payload_len > size)
+      break;
+    rec.payload = *data + pos;
+    pos += rec.entry.payload_len;
+    if (n && rec.entry.seq != records[n - 1].entry.seq + 1)
+      gaps++;
+    if (n == size_n)
+    {
+      size_n = size_n ? size_n * 2 : 1024;
+      records = (replay_record *) realloc(records, size_n * sizeof(*records));
+      if (!records)
+        return NULL;
+    }
+    records[n++] = rec;
+  }
+  if (gaps)
+    printf("Warning: %u gaps in the recording, records were dropped and "
+           "the replay may stall\n", gaps);
+  *count = n;
+  return records;
+}
+
+static void replay_call(OMX_HANDLETYPE handle, const replay_record *rec,
+                        uint64_t *call_us)
+{
+  const vidc_record_entry *e = &rec->entry;
+  replay_buffer *buf = NULL;
+  OMX_ERRORTYPE ret = OMX_ErrorNone;
+  OMX_PTR param;
+  replay_callback cb;
+  uint64_t begin;
+
+  // A recorded NULL header never matches, so it is skipped like any
+  // other unknown buffer
+  if (e->type == VIDC_RECORD_FREE_BUFFER || e->type == VIDC_RECORD_ETB ||
+      e->type == VIDC_RECORD_FTB)
+  {
+    pthread_mutex_lock(&lock);
+    buf = e->buffer ? find_buffer(e->buffer) : NULL;
+    if (buf && (e->type == VIDC_RECORD_ETB || e->type == VIDC_RECORD_FTB))
+    {
+      if (!wait_for(buffer_owned, buf))
+      {
+        printf("#%u %s: buffer still with the component\n", e->seq,
+               type_name(e->type));
+        stalls++;
+      }
+      buf->owned = false;
+    }
+    pthread_mutex_unlock(&lock);
+    if (!buf)
+    {
+      printf("#%u %s: unknown buffer 0x%llx, skipped\n", e->seq,
+             type_name(e->type), (unsigned long long) e->buffer);
+      return;
+    }
+  }
+  begin = now_us();
+  switch (e->type)
+  {
+    case VIDC_RECORD_SEND_COMMAND:
+      ret = OMX_SendCommand(handle, (OMX_COMMANDTYPE) e->port, e->param1,
+                            NULL);
+      break;
+    case VIDC_RECORD_SET_PARAMETER:
+    case VIDC_RECORD_SET_CONFIG:
+      // The component may write back, so hand it a private copy
+      param = malloc(e->payload_len ? e->payload_len : 1);
+      if (!param)
+        return;
+      memcpy(param, rec->payload, e->payload_len);
+      if (e->type == VIDC_RECORD_SET_PARAMETER)
+        ret = OMX_SetParameter(handle, (OMX_INDEXTYPE) e->param1, param);
+      else
+        ret = OMX_SetConfig(handle, (OMX_INDEXTYPE) e->param1, param);
+      free(param);
+      break;
+    case VIDC_RECORD_USE_BUFFER:
+    case VIDC_RECORD_ALLOCATE_BUFFER:
+      if (buffer_count == REPLAY_MAX_BUFFERS)
+      {
+        printf("#%u: more than %d buffers\n", e->seq, REPLAY_MAX_BUFFERS);
+        return;
+      }
+      buf = &buffers[buffer_count];
+      ret = OMX_AllocateBuffer(handle, &buf->hdr, e->port, NULL,
+                               e->alloc_len);
+      if (ret == OMX_ErrorNone)
+      {
+        pthread_mutex_lock(&lock);
+        buf->id = e->buffer;
+        buf->port = e->port;
+        buf->owned = true;
+        buffer_count++;
+        pthread_mutex_unlock(&lock);
+      }
+      break;
+    case VIDC_RECORD_FREE_BUFFER:
+      ret = OMX_FreeBuffer(handle, e->port, buf->hdr);
+      pthread_mutex_lock(&lock);
+      *buf = buffers[--buffer_count];
+      pthread_mutex_unlock(&lock);
+      break;
+    case VIDC_RECORD_ETB:
+      if (e->payload_len > buf->hdr->nAllocLen)
+        printf("#%u: %u byte ETB cut to %lu\n", e->seq, e->payload_len,
+               buf->hdr->nAllocLen);
+      buf->hdr->nOffset = 0;
+      buf->hdr->nFilledLen = e->payload_len < buf->hdr->nAllocLen ?
+        e->payload_len : buf->hdr->nAllocLen;
+      memcpy(buf->hdr->pBuffer, rec->payload, buf->hdr->nFilledLen);
+      buf->hdr->nFlags = e->flags;
+      buf->hdr->nTimeStamp = e->timestamp;
+      memset(&cb, 0, sizeof(cb));
+      cb.type = VIDC_RECORD_ETB;
+      cb.time_us = begin - start_us;
+      cb.timestamp = e->timestamp;
+      pthread_mutex_lock(&lock);
+      list_add(&replayed, &cb);
+      pthread_mutex_unlock(&lock);
+      ret = OMX_EmptyThisBuffer(handle, buf->hdr);
+      break;
+    case VIDC_RECORD_FTB:
+      buf->hdr->nFlags = 0;
+      buf->hdr->nFilledLen = 0;
+      ret = OMX_FillThisBuffer(handle, buf->hdr);
+      break;
+  }
+  call_us[e->type] += now_us() - begin;
+  if (ret != OMX_ErrorNone)
+    printf("#%u %s returned 0x%x\n", e->seq, type_name(e->type), ret);
+}
+
+/* Mean time from an ETB to the first later FBD with its timestamp */
+static uint64_t mean_latency(const replay_list *list, unsigned *matched)
+{
+  uint64_t total = 0;
+
+  *matched = 0;
+  for (unsigned i = 0; i < list->count; i++)
+  {
+    if (list->items[i].type != VIDC_RECORD_ETB)
+      continue;
+    for (unsigned k = i + 1; k < list->count; k++)
+      if (list->items[k].type == VIDC_RECORD_FBD &&
+          list->items[k].timestamp == list->items[i].timestamp)
+      {
+        total += list->items[k].time_us - list->items[i].time_us;
+        (*matched)++;
+        break;
+      }
+  }
+  return *matched ? total / *matched : 0;
+}
+
+static bool report_count(const char *name, OMX_U32 recorded_n,
+                         OMX_U32 replayed_n)
+{
+  printf("  %-10s recorded %6lu  replayed %6lu%s\n", name,
+         (unsigned long) recorded_n, (unsigned long) replayed_n,
+         recorded_n != replayed_n ? "  <-- differs" : "");
+  return recorded_n != replayed_n;
+}
+
+/*
+ * Lines up the n-th callback of each kind in both sessions and prints
+ * the first differences, then the time to first frame and the mean
+ * ETB to FBD latency matched by timestamp. Returns the number of
+ * differences.
+ */
+static unsigned report(const replay_record *records, unsigned count,
+                   const uint64_t *call_us, const unsigned *calls)
+{
+  unsigned shown = 0;
+  uint32_t types[] = {VIDC_RECORD_EVENT, VIDC_RECORD_EBD, VIDC_RECORD_FBD};
+  OMX_U32 n_rec[3] = {0, 0, 0}, n_rep[3] = {0, 0, 0};
+  uint64_t first_fbd[2] = {0, 0};
+
+  for (int t = 0; t < 3; t++)
+  {
+    unsigned i = 0, j = 0;
+    while (1)
+    {
+      while (i < recorded.count && recorded.items[i].type != types[t])
+        i++;
+      while (j < replayed.count && replayed.items[j].type != types[t])
+        j++;
+      if (i == recorded.count || j == replayed.count)
+        break;
+      const replay_callback *a = &recorded.items[i++];
+      const replay_callback *b = &replayed.items[j++];
+      n_rec[t]++;
+      n_rep[t]++;
+      if (types[t] == VIDC_RECORD_FBD && n_rec[t] == 1)
+      {
+        first_fbd[0] = a->time_us;
+        first_fbd[1] = b->time_us;
+      }
+      if ((a->param0 != b->param0 || a->param1 != b->param1 ||
+           a->param2 != b->param2 || a->timestamp != b->timestamp) &&
+          shown++ < REPLAY_MAX_REPORT)
+        printf("%s #%lu differs: recorded %u/0x%x/0x%x ts %lld, "
+               "replayed %u/0x%x/0x%x ts %lld\n", type_name(types[t]),
+               (unsigned long) n_rec[t], a->param0, a->param1, a->param2,
+               (long long) a->timestamp, b->param0, b->param1, b->param2,
+               (long long) b->timestamp);
+    }
+    for (; i < recorded.count; i++)
+      n_rec[t] += recorded.items[i].type == types[t];
+    for (; j < replayed.count; j++)
+      n_rep[t] += replayed.items[j].type == types[t];
+  }
+  if (shown > REPLAY_MAX_REPORT)
+    printf("... %u more differences\n", shown - REPLAY_MAX_REPORT);
+  printf("Callbacks:\n");
+  shown += report_count("events", n_rec[0], n_rep[0]);
+  shown += report_count("EBD", n_rec[1], n_rep[1]);
+  shown += report_count("FBD", n_rec[2], n_rep[2]);
+
+  unsigned matched[2];
+  uint64_t lat[2] = {mean_latency(&recorded, &matched[0]),
+                     mean_latency(&replayed, &matched[1])};
+  printf("Timing (recorded / replayed):\n");
+  printf("  first FBD     %8llu / %8llu us\n",
+         (unsigned long long) first_fbd[0],
+         (unsigned long long) first_fbd[1]);
+  printf("  session       %8llu / %8llu us\n",
+         (unsigned long long) (count ? records[count - 1].entry.time_us : 0),
+         (unsigned long long) (replayed.count ?
+            replayed.items[replayed.count - 1].time_us : 0));
+  printf("  ETB to FBD    %8llu / %8llu us mean over %u / %u frames\n",
+         (unsigned long long) lat[0], (unsigned long long) lat[1],
+         matched[0], matched[1]);
+  printf("Client call time in the replay:\n");
+  for (uint32_t t = VIDC_RECORD_SEND_COMMAND; t < VIDC_RECORD_EVENT; t++)
+    if (calls[t])
+      printf("  %-16s %6u calls %8llu us mean\n", type_name(t), calls[t],
+             (unsigned long long) (call_us[t] / calls[t]));
+  if (stalls)
+    printf("%u stalls waiting on callbacks or buffers\n", stalls);
+  return shown;
+}
+
+static void usage(const char *name)
+{
+  printf("usage: %s [-a] [-t timeout_ms] [-c component] recording\n"
+         "  -a  issue calls as soon as the callbacks allow, ignoring the\n"
+         "      recorded timing\n"
+         "  -t  how long to wait for a callback or buffer (5000)\n"
+         "  -c  replay against another component than the recorded one\n",
+         name);
+}
+
+int main(int argc, char **argv)
+{
+  vidc_record_file header;
+  replay_record *records;
+  OMX_U8 *data = NULL;
+  unsigned count = 0, diverged, calls[VIDC_RECORD_TYPE_MAX];
+  uint64_t call_us[VIDC_RECORD_TYPE_MAX];
+  const char *component = NULL;
+  bool asap = false;
+  OMX_HANDLETYPE handle = NULL;
+  OMX_ERRORTYPE ret;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "at:c:")) != -1)
+  {
+    switch (opt)
+    {
+      case 'a':
+        asap = true;
+        break;
+      case 't':
+        timeout_ms = atoi(optarg);
+        break;
+      case 'c':
+        component = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return -1;
+    }
+  }
+  if (optind >= argc)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+  records = load(argv[optind], &header, &count, &data);
+  if (!records)
+    return -1;
+  if (!component)
+    component = header.component;
+  printf("Replaying %u records against %s\n", count, component);
+
+  ret = OMX_Init();
+  if (ret == OMX_ErrorNone)
+    ret = OMX_GetHandle(&handle, (OMX_STRING) component, NULL, &callbacks);
+  if (ret != OMX_ErrorNone || !handle)
+  {
+    DEBUG_PRINT_ERROR("Cannot load %s: 0x%x\n", component, ret);
+    return -1;
+  }
+
+  memset(calls, 0, sizeof(calls));
+  memset(call_us, 0, sizeof(call_us));
+  start_us = now_us();
+  for (unsigned i = 0; i < count; i++)
+  {
+    const vidc_record_entry *e = &records[i].entry;
+    replay_callback cb;
+
+    if (e->type >= VIDC_RECORD_EVENT || e->type == VIDC_RECORD_ETB)
+    {
+      memset(&cb, 0, sizeof(cb));
+      cb.type = e->type;
+      cb.time_us = e->time_us;
+      cb.param0 = e->type == VIDC_RECORD_EVENT ? e->port : e->filled_len;
+      cb.param1 = e->type == VIDC_RECORD_EVENT ? e->param1 : e->flags;
+      cb.param2 = e->type == VIDC_RECORD_EVENT ? e->param2 : 0;
+      cb.timestamp = e->timestamp;
+      list_add(&recorded, &cb);
+      if (e->type >= VIDC_RECORD_EVENT)
+        continue;
+    }
+    if (e->type == 0 || e->type >= VIDC_RECORD_TYPE_MAX)
+      continue;
+    // Issue the call only once the component has said as much as it had
+    pthread_mutex_lock(&lock);
+    if (!wait_for(callbacks_caught_up, e))
+    {
+      printf("#%u %s: callbacks behind the recording "
+             "(events %lu/%u EBD %lu/%u FBD %lu/%u)\n", e->seq,
+             type_name(e->type),
+             (unsigned long) seen[0], e->seen[0],
+             (unsigned long) seen[1], e->seen[1],
+             (unsigned long) seen[2], e->seen[2]);
+      stalls++;
+    }
+    pthread_mutex_unlock(&lock);
+    if (!asap)
+    {
+      uint64_t now = now_us() - start_us;
+      if (now < e->time_us)
+        usleep(e->time_us - now);
+    }
+    replay_call(handle, &records[i], call_us);
+    calls[e->type]++;
+  }
+
+  // Let the callbacks of the last calls arrive before comparing
+  if (count)
+  {
+    vidc_record_entry last;
+    memset(&last, 0, sizeof(last));
+    for (unsigned i = 0; i < recorded.count; i++)
+    {
+      if (recorded.items[i].type == VIDC_RECORD_EVENT)
+        last.seen[VIDC_RECORD_CB_EVENT]++;
+      else if (recorded.items[i].type == VIDC_RECORD_EBD)
+        last.seen[VIDC_RECORD_CB_EBD]++;
+      else if (recorded.items[i].type == VIDC_RECORD_FBD)
+        last.seen[VIDC_RECORD_CB_FBD]++;
+    }
+    pthread_mutex_lock(&lock);
+    wait_for(callbacks_caught_up, &last);
+    pthread_mutex_unlock(&lock);
+  }
+
+  pthread_mutex_lock(&lock);
+  diverged = report(records, count, call_us, calls);
+  pthread_mutex_unlock(&lock);
+
+  OMX_FreeHandle(handle);
+  OMX_Deinit();
+  free(records);
+  free(data);
+  free(recorded.items);
+  free(replayed.items);
+  return stalls || diverged ? 1 : 0;
+}
@@ -71,6 +71,9 @@ extern "C"{
 #include "OMX_Core.h"
 #include "OMX_Component.h"
 #include "OMX_QCOMExtns.h"
+#include "vidc_trace.h"
+#include "vidc_stats.h"
+#include "vidc_dump.h"
 extern "C" {
 #include "queue.h"
 }
@@ -184,7 +187,8 @@ static int (*Read_Buffer)(OMX_BUFFERHEADERTYPE  *pBufHdr );
 
 int inputBufferFileFd;
 
-FILE * outputBufferFile;
+// Written by a background thread so fbd_thread returns buffers on time
+vidc_dump outputBufferDump;
 FILE * seqFile;
 int takeYuvLog = 0;
 int displayYuv = 0;
@@ -277,6 +281,8 @@ int sent_disabled = 0;
 int waitForPortSettingsChanged = 1;
 test_status currentStatus = GOOD_STATE;
 struct timeval t_start = {0, 0}, t_end = {0, 0};
+static char trace_file[QOMX_VIDEO_TRACE_PATH_MAX];
+static int perf_counters = 0;
 
 //* OMX Spec Version supported by the wrappers. Version = 1.1 */
 const OMX_U32 CURRENT_OMX_SPEC_VERSION = 0x00000101;
@@ -314,6 +320,10 @@ int run_tests();
 /**************************************************************************/
 static int video_playback_count = 1;
 static int open_video_file ();
+static void configure_trace(OMX_BOOL enable, const char *dump_file);
+static void configure_perf(void);
+static void print_perf(void);
+static void print_startup(void);
 static int Read_Buffer_From_DAT_File(OMX_BUFFERHEADERTYPE  *pBufHdr );
 static int Read_Buffer_ArbitraryBytes(OMX_BUFFERHEADERTYPE  *pBufHdr);
 static int Read_Buffer_From_Vop_Start_Code_File(OMX_BUFFERHEADERTYPE  *pBufHdr);
@@ -519,6 +529,127 @@ int process_current_command(const char *seq_command)
     return 0;
 }
 
+static void configure_trace(OMX_BOOL enable, const char *dump_file)
+{
+    OMX_INDEXTYPE index;
+    QOMX_VIDEO_TRACE trace;
+
+    if (OMX_GetExtensionIndex(dec_handle,
+            (OMX_STRING)OMX_QCOM_INDEX_CONFIG_VIDEO_TRACE, &index) != OMX_ErrorNone)
+    {
+        DEBUG_PRINT_ERROR("Trace: extension not supported\n");
+        return;
+    }
+    memset(&trace, 0, sizeof(trace));
+    CONFIG_VERSION_SIZE(trace);
+    trace.nPortIndex = OMX_ALL;
+    trace.bEnable = enable;
+    trace.nEvents = VIDC_TRACE_DEFAULT_EVENTS;
+    if (dump_file)
+        strlcpy((char *)trace.cDumpFile, dump_file, sizeof(trace.cDumpFile));
+    if (OMX_SetConfig(dec_handle, index, &trace) != OMX_ErrorNone)
+        DEBUG_PRINT_ERROR("Trace: failed to %s trace\n",
+                          dump_file ? "dump" : "enable");
+    else if (dump_file)
+        printf("Trace written to %s in the component debug directory\n", dump_file);
+}
+
+static void configure_perf(void)
+{
+    OMX_INDEXTYPE index;
+    QOMX_VIDEO_PERF_STATS perf;
+
+    if (OMX_GetExtensionIndex(dec_handle,
+            (OMX_STRING)OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS, &index) != OMX_ErrorNone)
+    {
+        printf("Perf counters: extension not supported\n");
+        perf_counters = 0;
+        return;
+    }
+    memset(&perf, 0, sizeof(perf));
+    CONFIG_VERSION_SIZE(perf);
+    perf.nPortIndex = OMX_ALL;
+    perf.bEnable = OMX_TRUE;
+    if (OMX_SetConfig(dec_handle, index, &perf) != OMX_ErrorNone)
+    {
+        printf("Perf counters: unavailable on this device\n");
+        perf_counters = 0;
+    }
+}
+
+static void print_startup(void)
+{
+    static const char *phases[QOMX_VIDEO_STARTUP_PHASE_MAX] =
+        { "device open", "device setup", "loaded->idle", "buffer alloc",
+          "idle->executing", "first etb", "header parse", "port reconfig",
+          "first fbd" };
+    OMX_INDEXTYPE index;
+    QOMX_VIDEO_STARTUP_STATS startup;
+    int i;
+
+    if (OMX_GetExtensionIndex(dec_handle,
+            (OMX_STRING)OMX_QCOM_INDEX_CONFIG_VIDEO_STARTUP_STATS, &index) != OMX_ErrorNone)
+        return;
+    memset(&startup, 0, sizeof(startup));
+    CONFIG_VERSION_SIZE(startup);
+    startup.nPortIndex = OMX_ALL;
+    if (OMX_GetConfig(dec_handle, index, &startup) != OMX_ErrorNone ||
+        !startup.bComplete)
+        return;
+    printf("\nStartup: first frame %.2f ms after GetHandle\n",
+           startup.nFirstFrameUs / 1e3);
+    for (i = 0; i < QOMX_VIDEO_STARTUP_PHASE_MAX; i++)
+    {
+        QOMX_VIDEO_STARTUP_TIME *t = &startup.sPhase[i];
+        if (!t->nCount)
+            continue;
+        printf("  %-16s %9.2f ms at +%.2f ms", phases[i],
+               t->nDurationUs / 1e3, t->nStartUs / 1e3);
+        if (i == QOMX_VIDEO_STARTUP_BUFFER_ALLOC)
+            printf(" (%lu buffers)", (unsigned long)t->nCount);
+        printf("\n");
+    }
+}
+
+static void print_perf(void)
+{
+    static const char *stages[QOMX_VIDEO_PERF_STAGE_MAX] =
+        { "parser", "event", "etb", "fbd" };
+    OMX_INDEXTYPE index;
+    QOMX_VIDEO_PERF_STATS perf;
+    int i;
+
+    if (OMX_GetExtensionIndex(dec_handle,
+            (OMX_STRING)OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS, &index) != OMX_ErrorNone)
+        return;
+    memset(&perf, 0, sizeof(perf));
+    CONFIG_VERSION_SIZE(perf);
+    perf.nPortIndex = OMX_ALL;
+    if (OMX_GetConfig(dec_handle, index, &perf) != OMX_ErrorNone)
+        return;
+    printf("\nPerf counters (%s, %lu threads, %llu frames):\n",
+           perf.bUserOnly ? "user only" : "user+kernel",
+           (unsigned long)perf.nThreads, (unsigned long long)perf.nFrames);
+    if (perf.nRunningPermille < 1000)
+        printf("  multiplexed: on the PMU %lu.%lu%% of the time, counts scaled\n",
+               (unsigned long)perf.nRunningPermille / 10,
+               (unsigned long)perf.nRunningPermille % 10);
+    printf("  %-8s %10s %14s %14s %12s %12s %12s\n", "stage", "calls",
+           "cycles", "instructions", "cache-miss", "branch-miss", "cyc/frame");
+    for (i = 0; i < QOMX_VIDEO_PERF_STAGE_MAX; i++)
+    {
+        QOMX_VIDEO_PERF_COUNTS *c = &perf.sSession[i];
+        printf("  %-8s %10llu %14llu %14llu %12llu %12llu %12llu\n", stages[i],
+               (unsigned long long)c->nCalls,
+               (unsigned long long)c->nCount[QOMX_VIDEO_PERF_CYCLES],
+               (unsigned long long)c->nCount[QOMX_VIDEO_PERF_INSTRUCTIONS],
+               (unsigned long long)c->nCount[QOMX_VIDEO_PERF_CACHE_MISSES],
+               (unsigned long long)c->nCount[QOMX_VIDEO_PERF_BRANCH_MISSES],
+               perf.nFrames ? (unsigned long long)
+                   (c->nCount[QOMX_VIDEO_PERF_CYCLES] / perf.nFrames) : 0ULL);
+    }
+}
+
 void PrintFramePackArrangement(OMX_QCOM_FRAME_PACK_ARRANGEMENT framePackingArrangement)
 {
    printf("id (%d)\n",
@@ -609,7 +740,7 @@ void* fbd_thread(void* pArg)
   long unsigned act_time = 0, display_time = 0, render_time = 5e3, lipsync = 15e3;
   struct timeval t_avsync = {0, 0}, base_avsync = {0, 0};
   float total_time = 0;
-  int canDisplay = 1, contigous_drop_frame = 0, bytes_written = 0, ret = 0;
+  int canDisplay = 1, contigous_drop_frame = 0, ret = 0;
   OMX_S64 base_timestamp = 0, lastTimestamp = 0;
   OMX_BUFFERHEADERTYPE *pBuffer = NULL, *pPrevBuff = NULL;
   pthread_mutex_lock(&eos_lock);
@@ -719,15 +850,9 @@ void* fbd_thread(void* pArg)
 
       if (takeYuvLog)
       {
-          bytes_written = fwrite((const char *)pBuffer->pBuffer,
-                                  pBuffer->nFilledLen,1,outputBufferFile);
-          if (bytes_written < 0) {
-              DEBUG_PRINT("\nFillBufferDone: Failed to write to the file\n");
-          }
-          else {
-              DEBUG_PRINT("\nFillBufferDone: Wrote %d YUV bytes to the file\n",
-                            bytes_written);
-          }
+          outputBufferDump.write(pBuffer->pBuffer, pBuffer->nFilledLen, false);
+          DEBUG_PRINT("\nFillBufferDone: Queued %lu YUV bytes to the file\n",
+                        pBuffer->nFilledLen);
       }
       if (pBuffer->nFlags & OMX_BUFFERFLAG_EXTRADATA)
       {
@@ -831,6 +956,11 @@ void* fbd_thread(void* pArg)
                    (OMX_INDEXTYPE)OMX_QcomIndexConfigVideoFramePackingArrangement,
                     &framePackingArrangement);
       PrintFramePackArrangement(framePackingArrangement);
+      if (trace_file[0])
+        configure_trace(OMX_TRUE, trace_file);
+      if (perf_counters)
+        print_perf();
+      print_startup();
 
       gettimeofday(&t_end, NULL);
       total_time = ((float) ((t_end.tv_sec - t_start.tv_sec) * 1e6
@@ -1090,9 +1220,27 @@ int main(int argc, char **argv)
     sliceheight = height = 144;
     stride = width = 176;
 
+    // --trace=<name> and --perf may appear anywhere; strip them before
+    // the positional args
+    for (i = 1; i < argc; )
+    {
+      if (!strncmp(argv[i], "--trace=", 8))
+        strlcpy(trace_file, argv[i] + 8, sizeof(trace_file));
+      else if (!strcmp(argv[i], "--perf"))
+        perf_counters = 1;
+      else
+      {
+        i++;
+        continue;
+      }
+      memmove(&argv[i], &argv[i + 1], (argc - i) * sizeof(argv[0]));
+      argc--;
+    }
+    i = 0;
+
     if (argc < 2)
     {
-      printf("To use it: ./mm-vdec-omx-test <clip location> \n");
+      printf("To use it: ./mm-vdec-omx-test <clip location> [--trace=<name>] [--perf]\n");
       printf("Command line argument is also available\n");
       return -1;
     }
@@ -1701,6 +1849,10 @@ int Init_Decoder()
     {
         DEBUG_PRINT("\nComponent %s is in LOADED state\n", vdecCompNames);
     }
+    if (trace_file[0])
+        configure_trace(OMX_TRUE, NULL);
+    if (perf_counters)
+        configure_perf();
 
     QOMX_VIDEO_QUERY_DECODER_INSTANCES decoder_instances;
     omxresult = OMX_GetConfig(dec_handle,
@@ -2542,9 +2694,8 @@ static void do_freeHandle_and_clean_up(bool isDueToError)
 
     DEBUG_PRINT("[OMX Vdec Test] - after free inputfile\n");
 
-    if (takeYuvLog && outputBufferFile) {
-        fclose(outputBufferFile);
-        outputBufferFile = NULL;
+    if (takeYuvLog) {
+        outputBufferDump.close();
     }
     DEBUG_PRINT("[OMX Vdec Test] - after free outputfile\n");
 
@@ -3260,8 +3411,8 @@ static int open_video_file ()
 
     if (takeYuvLog) {
         strlcpy(outputfilename, "yuvframes.yuv", 14);
-        outputBufferFile = fopen (outputfilename, "ab");
-        if (outputBufferFile == NULL)
+        // Blocks instead of dropping frames once the ring is full
+        if (!outputBufferDump.open(outputfilename, 32 * 1024 * 1024, true))
         {
           DEBUG_PRINT_ERROR("ERROR - o/p file %s could NOT be opened\n", outputfilename);
           error_code = -1;
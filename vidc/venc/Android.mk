@@ -15,7 +15,7 @@ libmm-venc-def += -D__alignx\(x\)=__attribute__\(\(__aligned__\(x\)\)\)
 libmm-venc-def += -DT_ARM
 libmm-venc-def += -Dinline=__inline
 libmm-venc-def += -D_ANDROID_
-libmm-venc-def += -UENABLE_DEBUG_LOW
+libmm-venc-def += -DENABLE_DEBUG_LOW
 libmm-venc-def += -DENABLE_DEBUG_HIGH
 libmm-venc-def += -DENABLE_DEBUG_ERROR
 libmm-venc-def += -UINPUT_BUFFER_LOG
@@ -59,6 +59,10 @@ LOCAL_SRC_FILES   := src/omx_video_base.cpp
 LOCAL_SRC_FILES   += src/omx_video_encoder.cpp
 LOCAL_SRC_FILES   += src/video_encoder_device.cpp
 LOCAL_SRC_FILES   += ../common/src/extra_data_handler.cpp
+LOCAL_SRC_FILES   += ../common/src/vidc_stats.cpp
+LOCAL_SRC_FILES   += ../common/src/vidc_log.cpp
+LOCAL_SRC_FILES   += ../common/src/vidc_dump.cpp
+LOCAL_SRC_FILES   += ../common/src/vidc_record.cpp
 
 include $(BUILD_SHARED_LIBRARY)
 
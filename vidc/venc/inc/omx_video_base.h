@@ -58,6 +58,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "qc_omx_component.h"
 #include "omx_video_common.h"
 #include "extra_data_handler.h"
+#include "vidc_stats.h"
+#include "vidc_dump.h"
+#include "vidc_record.h"
 
 #ifdef _ANDROID_
 using namespace android;
@@ -71,27 +74,8 @@ public:
 
 #include <utils/Log.h>
 #define LOG_TAG "OMX-VENC-720p"
-#ifdef ENABLE_DEBUG_LOW
-#define DEBUG_PRINT_LOW LOGE
-#else
-#define DEBUG_PRINT_LOW
-#endif
-#ifdef ENABLE_DEBUG_HIGH
-#define DEBUG_PRINT_HIGH LOGE
-#else
-#define DEBUG_PRINT_HIGH
-#endif
-#ifdef ENABLE_DEBUG_ERROR
-#define DEBUG_PRINT_ERROR LOGE
-#else
-#define DEBUG_PRINT_ERROR
-#endif
-
-#else //_ANDROID_
-#define DEBUG_PRINT_LOW
-#define DEBUG_PRINT_HIGH
-#define DEBUG_PRINT_ERROR
 #endif // _ANDROID_
+#include "vidc_log.h"
 
 #ifdef USE_ION
     static const char* MEM_DEVICE = "/dev/ion";
@@ -183,6 +167,7 @@ public:
   virtual bool dev_empty_buf(void *, void *) = 0;
   virtual bool dev_fill_buf(void *buffer, void *) = 0;
   virtual bool dev_get_buf_req(OMX_U32 *,OMX_U32 *,OMX_U32 *,OMX_U32) = 0;
+  virtual void dev_get_pool_stats(QOMX_VIDEO_MEMORY_STATS *) = 0;
 #ifdef _ANDROID_ICS_
   void omx_release_meta_buffer(OMX_BUFFERHEADERTYPE *buffer);
 #endif
@@ -428,8 +413,12 @@ public:
 
   OMX_ERRORTYPE fill_buffer_done(OMX_HANDLETYPE hComp,
                                  OMX_BUFFERHEADERTYPE * buffer);
+  OMX_ERRORTYPE fill_buffer_done_internal(OMX_HANDLETYPE hComp,
+                                          OMX_BUFFERHEADERTYPE * buffer);
   OMX_ERRORTYPE empty_this_buffer_proxy(OMX_HANDLETYPE       hComp,
                                         OMX_BUFFERHEADERTYPE *buffer);
+  OMX_ERRORTYPE empty_this_buffer_proxy_internal(OMX_HANDLETYPE hComp,
+                                                 OMX_BUFFERHEADERTYPE *buffer);
 
   OMX_ERRORTYPE fill_this_buffer_proxy(OMX_HANDLETYPE       hComp,
                                        OMX_BUFFERHEADERTYPE *buffer);
@@ -463,7 +452,7 @@ public:
   //*******************MEMBER VARIABLES *************************
   //*************************************************************
 
-  pthread_mutex_t       m_lock;
+  vidc_mutex            m_lock;
   sem_t                 m_cmd_lock;
   bool              m_error_propogated;
 
@@ -506,6 +495,8 @@ public:
   OMX_VIDEO_PARAM_INTRAREFRESHTYPE m_sIntraRefresh;
   OMX_U32 m_sExtraData;
   OMX_U32 m_sDebugSliceinfo;
+  // Slice info extradata is built from the bitstream at FBD
+  bool m_host_sliceinfo;
 
   // fill this buffer queue
   omx_cmd_queue         m_ftb_q;
@@ -537,6 +528,18 @@ public:
   bool m_event_port_settings_sent;
   OMX_U8                m_cRole[OMX_MAX_STRINGNAME_SIZE];
   extra_data_handler extra_data_handle;
+  // Contiguous memory held by this session
+  vidc_mem_stats m_mem_stats;
+  // Rolling fps/latency/queue counters for QOMX_IndexConfigVideoLiveStats
+  vidc_live_stats m_live_stats;
+  // Hardware counters per stage for QOMX_IndexConfigVideoPerfStats
+  vidc_perf m_perf;
+  // CPU time and wakeups of the message and callback threads
+  vidc_thread_stats m_thread_stats;
+  // Bitstream dump, queued at FBD and written by a background thread
+  vidc_dump m_output_dump;
+  // Client calls and callbacks recorded for mm-video-omx-replay
+  vidc_recorder m_recorder;
 
 private:
 #ifdef USE_ION
@@ -33,6 +33,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "OMX_QCOMExtns.h"
 #include "qc_omx_component.h"
 #include "omx_video_common.h"
+#include "vidc_stats.h"
+#include "vidc_dump.h"
+#include <pthread.h>
 #include <linux/msm_vidc_enc.h>
 
 #define MAX_RECON_BUFFERS 4
@@ -86,6 +89,10 @@ public:
 
   recon_buffer recon_buff[MAX_RECON_BUFFERS];
   int recon_buffers_count;
+  // Owned by the OMX component, recon buffers are reported here
+  vidc_mem_stats *m_mem_stats;
+  // Owned by the OMX component, opened here once the codec is known
+  vidc_dump *m_output_dump;
   bool m_max_allowed_bitrate_check;
   int m_eProfile;
   int m_eLevel;
@@ -108,6 +115,7 @@ private:
   struct venc_intrarefresh        intra_refresh;
   struct venc_headerextension     hec;
   struct venc_voptimingcfg        voptimecfg;
+  vidc_dump                       m_input_dump;
 
   bool venc_set_profile_level(OMX_U32 eProfile,OMX_U32 eLevel);
   bool venc_set_intra_period(OMX_U32 nPFrames, OMX_U32 nBFrames);
@@ -126,6 +134,7 @@ private:
   bool venc_set_error_resilience(OMX_VIDEO_PARAM_ERRORCORRECTIONTYPE* error_resilience);
   bool venc_set_voptiming_cfg(OMX_U32 nTimeIncRes);
   void venc_config_print();
+  void venc_init_dumps();
 #ifdef MAX_RES_1080P
   OMX_U32 pmem_free();
   OMX_U32 pmem_allocate(OMX_U32 size, OMX_U32 alignment, OMX_U32 count);
@@ -143,4 +152,54 @@ private:
 #endif
 };
 
+#ifdef MAX_RES_1080P
+#define VENC_RECON_POOL_MAX_BUFFERS (2 * MAX_RECON_BUFFERS)
+#define VENC_RECON_POOL_MAX_BYTES   (32 * 1024 * 1024)
+
+struct venc_recon_pool_stats {
+  OMX_U32 hits;
+  OMX_U32 misses;
+  OMX_U32 retained_count;
+  OMX_U32 retained_bytes;
+};
+
+/*
+ * Process-wide pool of recon buffers. Sessions borrow buffers keyed by
+ * size and alignment in venc_start and return them in venc_stop or
+ * venc_close, so back-to-back short sessions skip the ION/pmem
+ * allocation and mmap. Idle buffers are evicted oldest first once the
+ * pool holds more than VENC_RECON_POOL_MAX_BUFFERS buffers or
+ * VENC_RECON_POOL_MAX_BYTES bytes, and all of them are dropped when a
+ * recon allocation fails. The idle bytes and the hit and miss counts
+ * are reported in QOMX_VIDEO_MEMORY_STATS.
+ */
+class venc_recon_pool
+{
+public:
+  static venc_recon_pool* get_instance();
+  bool acquire(OMX_U32 size, OMX_U32 alignment, venc_dev::recon_buffer *buf);
+  void release(venc_dev::recon_buffer *buf);
+  void trim(OMX_U32 max_bytes);
+  void get_stats(struct venc_recon_pool_stats *stats);
+  static int allocate_buffer(OMX_U32 size, OMX_U32 alignment,
+                             venc_dev::recon_buffer *buf);
+  static void free_buffer(venc_dev::recon_buffer *buf);
+private:
+  venc_recon_pool();
+  ~venc_recon_pool();
+  void trim_locked(OMX_U32 max_bytes, OMX_U32 max_count);
+  struct pool_entry {
+    venc_dev::recon_buffer buf;
+    unsigned long stamp;
+  };
+  pthread_mutex_t m_lock;
+  pool_entry m_idle[VENC_RECON_POOL_MAX_BUFFERS];
+  OMX_U32 m_idle_count;
+  OMX_U32 m_idle_bytes;
+  unsigned long m_stamp;
+  OMX_U32 m_hits;
+  OMX_U32 m_misses;
+};
+#endif
+
 #endif
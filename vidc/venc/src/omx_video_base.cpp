@@ -87,10 +87,6 @@ typedef struct OMXComponentCapabilityFlagsType
 } OMXComponentCapabilityFlagsType;
 #define OMX_COMPONENT_CAPABILITY_TYPE_INDEX 0xFF7A347
 
-#ifdef OUTPUT_BUFFER_LOG
-extern FILE *outputBufferFile1;
-#endif
-
 void* message_thread(void *input)
 {
   omx_video* omx = reinterpret_cast<omx_video*>(input);
@@ -99,9 +95,11 @@ void* message_thread(void *input)
 
   DEBUG_PRINT_LOW("omx_venc: message thread start\n");
   prctl(PR_SET_NAME, (unsigned long)"VideoEncMsgThread", 0, 0, 0);
+  omx->m_thread_stats.thread_start(QOMX_VIDEO_THREAD_MESSAGE);
   while(1)
   {
     n = read(omx->m_pipe_in, &id, 1);
+    omx->m_thread_stats.wakeup(QOMX_VIDEO_THREAD_MESSAGE);
     if(0 == n)
     {
       break;
@@ -117,6 +115,7 @@ void* message_thread(void *input)
     if((n < 0) && (errno != EINTR)) break;
 #endif
   }
+  omx->m_thread_stats.thread_exit(QOMX_VIDEO_THREAD_MESSAGE);
   DEBUG_PRINT_LOW("omx_venc: message thread stop\n");
   return 0;
 }
@@ -246,7 +245,6 @@ omx_video::omx_video(): m_state(OMX_StateInvalid),
   memset(&m_cmp,0,sizeof(m_cmp));
   memset(&m_pCallbacks,0,sizeof(m_pCallbacks));
 
-  pthread_mutex_init(&m_lock, NULL);
   sem_init(&m_cmd_lock,0,0);
 }
 
@@ -273,7 +271,7 @@ omx_video::~omx_video()
   pthread_join(msg_thread_id,NULL);
   DEBUG_PRINT_HIGH("omx_video: Waiting on Async Thread exit\n");
   pthread_join(async_thread_id,NULL);
-  pthread_mutex_destroy(&m_lock);
+  m_thread_stats.report((const char *) m_cRole);
   sem_destroy(&m_cmd_lock);
   DEBUG_PRINT_HIGH("\n m_etb_count = %u, m_fbd_count = %u\n", m_etb_count,
       m_fbd_count);
@@ -314,12 +312,13 @@ void omx_video::process_event_cb(void *ctxt, unsigned char id)
     return;
   }
 
+  pThis->m_perf.begin(QOMX_VIDEO_PERF_EVENT);
   // Protect the shared queue data structure
   do
   {
     /*Read the message id's from the queue*/
 
-    pthread_mutex_lock(&pThis->m_lock);
+    VIDC_MUTEX_LOCK(&pThis->m_lock);
     qsize = pThis->m_cmd_q.m_size;
     if(qsize)
     {
@@ -344,7 +343,7 @@ void omx_video::process_event_cb(void *ctxt, unsigned char id)
       }
     }
 
-    pthread_mutex_unlock(&pThis->m_lock);
+    VIDC_MUTEX_UNLOCK(&pThis->m_lock);
 
     /*process message if we have one*/
     if(qsize > 0)
@@ -610,14 +609,15 @@ void omx_video::process_event_cb(void *ctxt, unsigned char id)
       }
     }
 
-    pthread_mutex_lock(&pThis->m_lock);
+    VIDC_MUTEX_LOCK(&pThis->m_lock);
     qsize = pThis->m_cmd_q.m_size + pThis->m_ftb_q.m_size +\
             pThis->m_etb_q.m_size;
 
-    pthread_mutex_unlock(&pThis->m_lock);
+    VIDC_MUTEX_UNLOCK(&pThis->m_lock);
 
   }
   while(qsize>0);
+  pThis->m_perf.end();
   DEBUG_PRINT_LOW("\n exited the while loop\n");
 
 }
@@ -708,6 +708,7 @@ OMX_ERRORTYPE  omx_video::send_command(OMX_IN OMX_HANDLETYPE hComp,
     }
   }
 
+  m_recorder.command(cmd, param1);
   post_event((unsigned)cmd,(unsigned)param1,OMX_COMPONENT_GENERATE_COMMAND);
   sem_wait(&m_cmd_lock);
   return OMX_ErrorNone;
@@ -1278,7 +1279,8 @@ bool omx_video::execute_output_flush(void)
 
   /*Generate FBD for all Buffers in the FTBq*/
   DEBUG_PRINT_LOW("\n execute_output_flush\n");
-  pthread_mutex_lock(&m_lock);
+  m_live_stats.output_flushed();
+  VIDC_MUTEX_LOCK(&m_lock);
   while(m_ftb_q.m_size)
   {
     m_ftb_q.pop_entry(&p1,&p2,&ident);
@@ -1294,7 +1296,7 @@ bool omx_video::execute_output_flush(void)
     }
   }
 
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   /*Check if there are buffers with the Driver*/
   if(dev_flush(PORT_INDEX_OUT))
   {
@@ -1325,8 +1327,9 @@ bool omx_video::execute_input_flush(void)
 
   /*Generate EBD for all Buffers in the ETBq*/
   DEBUG_PRINT_LOW("\n execute_input_flush\n");
+  m_live_stats.input_flushed();
 
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
   while(m_etb_q.m_size)
   {
     m_etb_q.pop_entry(&p1,&p2,&ident);
@@ -1341,7 +1344,7 @@ bool omx_video::execute_input_flush(void)
     }
   }
 
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   /*Check if there are buffers with the Driver*/
   if(dev_flush(PORT_INDEX_IN))
   {
@@ -1375,27 +1378,30 @@ bool omx_video::post_event(unsigned int p1,
   bool bRet      =                      false;
 
 
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
 
   if( id == OMX_COMPONENT_GENERATE_FTB || \
       (id == OMX_COMPONENT_GENERATE_FRAME_DONE))
   {
     m_ftb_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_FTB, m_ftb_q.m_size);
   }
   else if((id == OMX_COMPONENT_GENERATE_ETB) \
           || (id == OMX_COMPONENT_GENERATE_EBD))
   {
     m_etb_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_ETB, m_etb_q.m_size);
   }
   else
   {
     m_cmd_q.insert_entry(p1,p2,id);
+    m_live_stats.queued(QOMX_VIDEO_QUEUE_CMD, m_cmd_q.m_size);
   }
 
   bRet = true;
   DEBUG_PRINT_LOW("\n Value of this pointer in post_event %p",this);
   post_message(this, id);
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
 
   return bRet;
 }
@@ -1750,6 +1756,11 @@ OMX_ERRORTYPE  omx_video::get_config(OMX_IN OMX_HANDLETYPE      hComp,
   // OMX_IndexConfigVideoBitrate      OMX_VIDEO_CONFIG_BITRATETYPE
   // OMX_IndexConfigVideoFramerate    OMX_CONFIG_FRAMERATETYPE
   // OMX_IndexConfigCommonRotate      OMX_CONFIG_ROTATIONTYPE
+  // QOMX_IndexConfigVideoMemoryStats QOMX_VIDEO_MEMORY_STATS
+  // QOMX_IndexConfigVideoLiveStats   QOMX_VIDEO_LIVE_STATS
+  // QOMX_IndexConfigVideoLockStats   QOMX_VIDEO_LOCK_STATS
+  // QOMX_IndexConfigVideoPerfStats   QOMX_VIDEO_PERF_STATS
+  // QOMX_IndexConfigVideoThreadStats QOMX_VIDEO_THREAD_STATS
   ////////////////////////////////////////////////////////////////
 
   if(configData == NULL)
@@ -1792,6 +1803,42 @@ OMX_ERRORTYPE  omx_video::get_config(OMX_IN OMX_HANDLETYPE      hComp,
       memcpy(pParam, &m_sIntraperiod, sizeof(m_sIntraperiod));
       break;
     }
+  case QOMX_IndexConfigVideoMemoryStats:
+    {
+      QOMX_VIDEO_MEMORY_STATS* pParam = reinterpret_cast<QOMX_VIDEO_MEMORY_STATS*>(configData);
+      if (m_mem_stats.get_stats(pParam) != OMX_ErrorNone)
+        return OMX_ErrorBadParameter;
+      dev_get_pool_stats(pParam);
+      break;
+    }
+  case QOMX_IndexConfigVideoLiveStats:
+    {
+      QOMX_VIDEO_LIVE_STATS* pParam = reinterpret_cast<QOMX_VIDEO_LIVE_STATS*>(configData);
+      if (m_live_stats.get_stats(pParam) != OMX_ErrorNone)
+        return OMX_ErrorBadParameter;
+      pParam->sQueue[QOMX_VIDEO_QUEUE_ETB].nCurrent = m_etb_q.m_size;
+      pParam->sQueue[QOMX_VIDEO_QUEUE_FTB].nCurrent = m_ftb_q.m_size;
+      pParam->sQueue[QOMX_VIDEO_QUEUE_CMD].nCurrent = m_cmd_q.m_size;
+      pParam->nPendingInputBuffers = pending_input_buffers;
+      pParam->nPendingOutputBuffers = pending_output_buffers;
+      pParam->nConcealedMBs = 0;
+      break;
+    }
+  case QOMX_IndexConfigVideoLockStats:
+    {
+      QOMX_VIDEO_LOCK_STATS* pParam = reinterpret_cast<QOMX_VIDEO_LOCK_STATS*>(configData);
+      return m_lock.get_stats(pParam);
+    }
+  case QOMX_IndexConfigVideoPerfStats:
+    {
+      QOMX_VIDEO_PERF_STATS* pParam = reinterpret_cast<QOMX_VIDEO_PERF_STATS*>(configData);
+      return m_perf.get_stats(pParam);
+    }
+  case QOMX_IndexConfigVideoThreadStats:
+    {
+      QOMX_VIDEO_THREAD_STATS* pParam = reinterpret_cast<QOMX_VIDEO_THREAD_STATS*>(configData);
+      return m_thread_stats.get_stats(pParam);
+    }
   default:
     DEBUG_PRINT_ERROR("ERROR: unsupported index %d", (int) configIndex);
     return OMX_ErrorUnsupportedIndex;
@@ -1829,6 +1876,26 @@ OMX_ERRORTYPE  omx_video::get_extension_index(OMX_IN OMX_HANDLETYPE      hComp,
         return OMX_ErrorNone;
   }
 #endif
+  if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_MEMORY_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_MEMORY_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoMemoryStats;
+        return OMX_ErrorNone;
+  }
+  if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_LIVE_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_LIVE_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoLiveStats;
+        return OMX_ErrorNone;
+  }
+  if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_LOCK_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_LOCK_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoLockStats;
+        return OMX_ErrorNone;
+  }
+  if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoPerfStats;
+        return OMX_ErrorNone;
+  }
+  if (!strncmp(paramName, OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS,sizeof(OMX_QCOM_INDEX_CONFIG_VIDEO_THREAD_STATS) - 1)) {
+        *indexType = (OMX_INDEXTYPE)QOMX_IndexConfigVideoThreadStats;
+        return OMX_ErrorNone;
+  }
   return OMX_ErrorNotImplemented;
 }
 
@@ -2009,6 +2076,8 @@ OMX_ERRORTYPE  omx_video::use_input_buffer(
 #endif
         return OMX_ErrorInsufficientResources;
       }
+      m_mem_stats.allocated(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[i].size);
+      m_mem_stats.mapped(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[i].size);
     }
     else
     {
@@ -2208,6 +2277,8 @@ OMX_ERRORTYPE  omx_video::use_output_buffer(
 #endif
           return OMX_ErrorInsufficientResources;
         }
+        m_mem_stats.allocated(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[i].size);
+        m_mem_stats.mapped(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[i].size);
       }
       else
       {
@@ -2293,6 +2364,7 @@ OMX_ERRORTYPE  omx_video::use_buffer(
 
   if(eRet == OMX_ErrorNone)
   {
+    m_recorder.buffer(VIDC_RECORD_USE_BUFFER, port, *bufferHdr);
     if(allocate_done())
     {
       if(BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
@@ -2365,6 +2437,8 @@ OMX_ERRORTYPE omx_video::free_input_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
     {
       DEBUG_PRINT_LOW("\n FreeBuffer:: i/p AllocateBuffer case");
       munmap (m_pInput_pmem[index].buffer,m_pInput_pmem[index].size);
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[index].size);
+      m_mem_stats.released(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[index].size);
       close (m_pInput_pmem[index].fd);
 #ifdef USE_ION
       free_ion_memory(&m_pInput_ion[index]);
@@ -2380,6 +2454,8 @@ OMX_ERRORTYPE omx_video::free_input_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
         DEBUG_PRINT_ERROR("\nERROR: dev_free_buf() Failed for i/p buf");
       }
       munmap (m_pInput_pmem[index].buffer,m_pInput_pmem[index].size);
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[index].size);
+      m_mem_stats.released(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[index].size);
       close (m_pInput_pmem[index].fd);
 #ifdef USE_ION
       free_ion_memory(&m_pInput_ion[index]);
@@ -2419,6 +2495,8 @@ OMX_ERRORTYPE omx_video::free_output_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
     {
       DEBUG_PRINT_LOW("\n FreeBuffer:: o/p AllocateBuffer case");
       munmap (m_pOutput_pmem[index].buffer,m_pOutput_pmem[index].size);
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[index].size);
+      m_mem_stats.released(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[index].size);
       close (m_pOutput_pmem[index].fd);
 #ifdef USE_ION
       free_ion_memory(&m_pOutput_ion[index]);
@@ -2434,6 +2512,8 @@ OMX_ERRORTYPE omx_video::free_output_buffer(OMX_BUFFERHEADERTYPE *bufferHdr)
         DEBUG_PRINT_ERROR("ERROR: dev_free_buf Failed for o/p buf");
       }
       munmap (m_pOutput_pmem[index].buffer,m_pOutput_pmem[index].size);
+      m_mem_stats.unmapped(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[index].size);
+      m_mem_stats.released(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[index].size);
       close (m_pOutput_pmem[index].fd);
 #ifdef USE_ION
       free_ion_memory(&m_pOutput_ion[index]);
@@ -2605,6 +2685,8 @@ OMX_ERRORTYPE  omx_video::allocate_input_buffer(
 #endif
       return OMX_ErrorInsufficientResources;
     }
+    m_mem_stats.allocated(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[i].size);
+    m_mem_stats.mapped(QOMX_VIDEO_MEM_INPUT, m_pInput_pmem[i].size);
 
     (*bufferHdr)->pBuffer           = (OMX_U8 *)m_pInput_pmem[i].buffer;
 
@@ -2760,6 +2842,8 @@ OMX_ERRORTYPE  omx_video::allocate_output_buffer(
 #endif
         return OMX_ErrorInsufficientResources;
       }
+      m_mem_stats.allocated(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[i].size);
+      m_mem_stats.mapped(QOMX_VIDEO_MEM_OUTPUT, m_pOutput_pmem[i].size);
 
       *bufferHdr = (m_out_mem_ptr + i );
       (*bufferHdr)->pBuffer = (OMX_U8 *)m_pOutput_pmem[i].buffer;
@@ -2837,6 +2921,7 @@ OMX_ERRORTYPE  omx_video::allocate_buffer(OMX_IN OMX_HANDLETYPE                h
   DEBUG_PRINT_LOW("Checking for Output Allocate buffer Done");
   if(eRet == OMX_ErrorNone)
   {
+    m_recorder.buffer(VIDC_RECORD_ALLOCATE_BUFFER, port, *bufferHdr);
     if(allocate_done())
     {
       if(BITMASK_PRESENT(&m_flags,OMX_COMPONENT_IDLE_PENDING))
@@ -2896,6 +2981,7 @@ OMX_ERRORTYPE  omx_video::free_buffer(OMX_IN OMX_HANDLETYPE         hComp,
   unsigned int nPortIndex;
 
   DEBUG_PRINT_LOW("In for decoder free_buffer \n");
+  m_recorder.buffer(VIDC_RECORD_FREE_BUFFER, port, buffer);
 
   if(m_state == OMX_StateIdle &&
      (BITMASK_PRESENT(&m_flags ,OMX_COMPONENT_LOADING_PENDING)))
@@ -3126,6 +3212,8 @@ OMX_ERRORTYPE  omx_video::empty_this_buffer(OMX_IN OMX_HANDLETYPE         hComp,
   }
 
   m_etb_count++;
+  m_recorder.etb(buffer);
+  m_live_stats.input_queued(buffer->nTimeStamp);
   DEBUG_PRINT_LOW("\n DBG: i/p nTimestamp = %u", (unsigned)buffer->nTimeStamp);
   post_event ((unsigned)hComp,(unsigned)buffer,OMX_COMPONENT_GENERATE_ETB);
   return OMX_ErrorNone;
@@ -3149,6 +3237,17 @@ RETURN VALUE
 ========================================================================== */
 OMX_ERRORTYPE  omx_video::empty_this_buffer_proxy(OMX_IN OMX_HANDLETYPE         hComp,
                                                   OMX_IN OMX_BUFFERHEADERTYPE* buffer)
+{
+  OMX_ERRORTYPE ret;
+
+  m_perf.begin(QOMX_VIDEO_PERF_ETB);
+  ret = empty_this_buffer_proxy_internal(hComp, buffer);
+  m_perf.end();
+  return ret;
+}
+
+OMX_ERRORTYPE  omx_video::empty_this_buffer_proxy_internal(OMX_IN OMX_HANDLETYPE         hComp,
+                                                           OMX_IN OMX_BUFFERHEADERTYPE* buffer)
 {
   OMX_U8 *pmem_data_buf = NULL;
   int push_cnt = 0;
@@ -3315,6 +3414,7 @@ OMX_ERRORTYPE  omx_video::fill_this_buffer(OMX_IN OMX_HANDLETYPE  hComp,
     return OMX_ErrorIncorrectStateOperation;
   }
 
+  m_recorder.buffer(VIDC_RECORD_FTB, PORT_INDEX_OUT, buffer);
   post_event((unsigned) hComp, (unsigned)buffer,OMX_COMPONENT_GENERATE_FTB);
   return OMX_ErrorNone;
 }
@@ -3399,6 +3499,7 @@ OMX_ERRORTYPE  omx_video::set_callbacks(OMX_IN OMX_HANDLETYPE        hComp,
   DEBUG_PRINT_LOW("\n Callbacks Set %p %p %p",m_pCallbacks.EmptyBufferDone,\
                m_pCallbacks.EventHandler,m_pCallbacks.FillBufferDone);
   m_app_data =    appData;
+  m_recorder.wrap_callbacks(&m_pCallbacks, &m_app_data);
   return OMX_ErrorNotImplemented;
 }
 
@@ -3778,6 +3879,17 @@ bool omx_video::release_input_done(void)
 
 OMX_ERRORTYPE omx_video::fill_buffer_done(OMX_HANDLETYPE hComp,
                                           OMX_BUFFERHEADERTYPE * buffer)
+{
+  OMX_ERRORTYPE ret;
+
+  m_perf.begin(QOMX_VIDEO_PERF_FBD);
+  ret = fill_buffer_done_internal(hComp, buffer);
+  m_perf.end();
+  return ret;
+}
+
+OMX_ERRORTYPE omx_video::fill_buffer_done_internal(OMX_HANDLETYPE hComp,
+                                                   OMX_BUFFERHEADERTYPE * buffer)
 {
   DEBUG_PRINT_LOW("\nfill_buffer_done: buffer->pBuffer[%p]\n", buffer->pBuffer);
   if(buffer == NULL || ((buffer - m_out_mem_ptr) > m_sOutPortDef.nBufferCountActual))
@@ -3787,8 +3899,23 @@ OMX_ERRORTYPE omx_video::fill_buffer_done(OMX_HANDLETYPE hComp,
 
   pending_output_buffers--;
 
+  if (!output_flush_progress)
+  {
+    m_live_stats.output_done(buffer->nTimeStamp, buffer->nFilledLen);
+    // Rate control skipped the frame the buffer was queued for
+    if (!buffer->nFilledLen && !(buffer->nFlags & OMX_BUFFERFLAG_EOS))
+      m_live_stats.frame_dropped();
+    else if (buffer->nFilledLen)
+      m_perf.frame_done();
+  }
+
   extra_data_handle.create_extra_data(buffer);
 
+  if (m_host_sliceinfo && buffer->nFilledLen &&
+      !(buffer->nFlags & OMX_BUFFERFLAG_EXTRADATA)) {
+    extra_data_handle.create_sliceinfo(buffer);
+  }
+
   if (m_sDebugSliceinfo) {
     if(buffer->nFlags & OMX_BUFFERFLAG_EXTRADATA) {
        DEBUG_PRINT_HIGH("parsing extradata");
@@ -3801,13 +3928,9 @@ OMX_ERRORTYPE omx_video::fill_buffer_done(OMX_HANDLETYPE hComp,
     if(buffer->nFilledLen > 0)
     {
       m_fbd_count++;
-
-#ifdef OUTPUT_BUFFER_LOG
-      if(outputBufferFile1)
-      {
-        fwrite((const char *)buffer->pBuffer, buffer->nFilledLen, 1, outputBufferFile1);
-      }
-#endif
+      m_output_dump.write(buffer->pBuffer + buffer->nOffset,
+                          buffer->nFilledLen,
+                          (buffer->nFlags & OMX_BUFFERFLAG_DATACORRUPT) != 0);
     }
     m_pCallbacks.FillBufferDone (hComp,m_app_data,buffer);
   }
@@ -3842,7 +3965,7 @@ void omx_video::complete_pending_buffer_done_cbs()
   unsigned p2;
   unsigned ident;
   omx_cmd_queue tmp_q, pending_bd_q;
-  pthread_mutex_lock(&m_lock);
+  VIDC_MUTEX_LOCK(&m_lock);
   // pop all pending GENERATE FDB from ftb queue
   while (m_ftb_q.m_size)
   {
@@ -3881,7 +4004,7 @@ void omx_video::complete_pending_buffer_done_cbs()
     tmp_q.pop_entry(&p1,&p2,&ident);
     m_etb_q.insert_entry(p1,p2,ident);
   }
-  pthread_mutex_unlock(&m_lock);
+  VIDC_MUTEX_UNLOCK(&m_lock);
   // process all pending buffer dones
   while(pending_bd_q.m_size)
   {
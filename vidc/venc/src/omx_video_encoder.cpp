@@ -57,6 +57,7 @@ void *get_omx_component_factory_fn(void)
 
 omx_venc::omx_venc()
 {
+  vidc_log_init();
 #ifdef _ANDROID_ICS_
   meta_mode_enable = false;
   memset(meta_buffer_hdr,0,sizeof(meta_buffer_hdr));
@@ -140,6 +141,8 @@ OMX_ERRORTYPE omx_venc::component_init(OMX_STRING role)
     DEBUG_PRINT_ERROR("\nERROR: handle is NULL");
     return OMX_ErrorInsufficientResources;
   }
+  handle->m_mem_stats = &m_mem_stats;
+  handle->m_output_dump = &m_output_dump;
 
   if(handle->venc_open(codec_type) != true)
   {
@@ -382,11 +385,26 @@ OMX_ERRORTYPE omx_venc::component_init(OMX_STRING role)
   m_state                   = OMX_StateLoaded;
   m_sExtraData = 0;
   m_sDebugSliceinfo = 0;
+  m_host_sliceinfo = false;
 #ifdef _ANDROID_
   char value[PROPERTY_VALUE_MAX] = {0};
   property_get("vidc.venc.debug.sliceinfo", value, "0");
   m_sDebugSliceinfo = (OMX_U32)atoi(value);
   DEBUG_PRINT_HIGH("vidc.venc.debug.sliceinfo value is %d", m_sDebugSliceinfo);
+  // Per call site wait/hold times of m_lock, reported at deinit
+  property_get("vidc.venc.debug.lockstats", value, "0");
+  m_lock.set_instrumented(atoi(value) != 0);
+  // Hardware counters per pipeline stage, also switchable at run time
+  property_get("vidc.venc.debug.perf", value, "0");
+  if (atoi(value))
+    m_perf.enable(true);
+  // Client calls and callbacks for mm-video-omx-replay
+  if (property_get("vidc.venc.debug.record", value, NULL) > 0)
+  {
+    char record_ring[PROPERTY_VALUE_MAX] = {0};
+    property_get("vidc.venc.debug.record.ring", record_ring, "0");
+    m_recorder.open(value, (const char *) m_nkind, atoi(record_ring) << 20);
+  }
 #endif
 
   if(eRet == OMX_ErrorNone)
@@ -464,6 +482,7 @@ OMX_ERRORTYPE  omx_venc::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
     DEBUG_PRINT_ERROR("ERROR: Get Param in Invalid paramData \n");
     return OMX_ErrorBadParameter;
   }
+  m_recorder.parameter(VIDC_RECORD_SET_PARAMETER, paramIndex, paramData);
 
   /*set_parameter can be called in loaded state
   or disabled port */
@@ -985,12 +1004,23 @@ OMX_ERRORTYPE  omx_venc::set_parameter(OMX_IN OMX_HANDLETYPE     hComp,
           else
             m_sExtraData &= ~VEN_EXTRADATA_SLICEINFO;
           DEBUG_PRINT_HIGH("set_param: m_sExtraData=%x", m_sExtraData);
+          m_host_sliceinfo = false;
           if(handle->venc_set_param(&m_sExtraData,
               (OMX_INDEXTYPE)OMX_ExtraDataVideoEncoderSliceInfo) != true)
           {
-            DEBUG_PRINT_ERROR("ERROR: Setting "
-               "OMX_QcomIndexParamIndexExtraDataType failed");
-            return OMX_ErrorUnsupportedSetting;
+            if(pParam->bEnabled == OMX_TRUE &&
+               m_sOutPortFormat.eCompressionFormat == OMX_VIDEO_CodingAVC)
+            {
+              // Driver can not report slices, index start codes at FBD
+              DEBUG_PRINT_HIGH("set_param: slice info built from bitstream");
+              m_host_sliceinfo = true;
+            }
+            else
+            {
+              DEBUG_PRINT_ERROR("ERROR: Setting "
+                 "OMX_QcomIndexParamIndexExtraDataType failed");
+              return OMX_ErrorUnsupportedSetting;
+            }
           }
           else
           {
@@ -1119,6 +1149,7 @@ OMX_ERRORTYPE  omx_venc::set_config(OMX_IN OMX_HANDLETYPE      hComp,
     DEBUG_PRINT_ERROR("ERROR: config called in Invalid state");
     return OMX_ErrorIncorrectStateOperation;
   }
+  m_recorder.parameter(VIDC_RECORD_SET_CONFIG, configIndex, configData);
 
   // params will be validated prior to venc_init
   switch(configIndex)
@@ -1314,6 +1345,14 @@ OMX_ERRORTYPE  omx_venc::set_config(OMX_IN OMX_HANDLETYPE      hComp,
       }
       break;
     }
+  case QOMX_IndexConfigVideoPerfStats:
+    {
+      QOMX_VIDEO_PERF_STATS* pParam = reinterpret_cast<QOMX_VIDEO_PERF_STATS*>(configData);
+      OMX_ERRORTYPE ret = m_perf.set_config(pParam);
+      if (ret != OMX_ErrorNone)
+        DEBUG_PRINT_ERROR("ERROR: perf counters unavailable %x", ret);
+      return ret;
+    }
   default:
     DEBUG_PRINT_ERROR("ERROR: unsupported index %d", (int) configIndex);
     break;
@@ -1392,6 +1431,10 @@ OMX_ERRORTYPE  omx_venc::component_deinit(OMX_IN OMX_HANDLETYPE hComp)
   DEBUG_PRINT_HIGH("Deleting HANDLE[%p]\n", handle);
   delete (handle);
   DEBUG_PRINT_HIGH("OMX_Venc:Component Deinit\n");
+  m_lock.report((const char *) m_cRole);
+  m_perf.report((const char *) m_cRole);
+  m_recorder.close();
+  vidc_log_flush();
   return OMX_ErrorNone;
 }
 
@@ -1466,6 +1509,18 @@ bool omx_venc::dev_set_buf_req(OMX_U32 *min_buff_count,
 
 }
 
+void omx_venc::dev_get_pool_stats(QOMX_VIDEO_MEMORY_STATS *mem_stats)
+{
+#ifdef MAX_RES_1080P
+  struct venc_recon_pool_stats stats;
+  venc_recon_pool::get_instance()->get_stats(&stats);
+  mem_stats->nPoolRetainedBytes = stats.retained_bytes;
+  mem_stats->nPoolRetainedBuffers = stats.retained_count;
+  mem_stats->nPoolHits = stats.hits;
+  mem_stats->nPoolMisses = stats.misses;
+#endif
+}
+
 int omx_venc::async_message_process (void *context, void* message)
 {
   omx_video* omx = NULL;
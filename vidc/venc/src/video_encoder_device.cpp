@@ -36,6 +36,9 @@ ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #ifdef USE_ION
 #include <linux/ion.h>
 #endif
+#ifdef _ANDROID_
+#include <cutils/properties.h>
+#endif
 
 #define MPEG4_SP_START 0
 #define MPEG4_ASP_START (MPEG4_SP_START + 8)
@@ -134,11 +137,9 @@ static const unsigned int h263_profile_level_table[][5]=
 #define Q16ToFraction(q,num,den) { OMX_U32 power; Log2(q,power);  num = q >> power; den = 0x1 << (16 - power); }
 
 #ifdef INPUT_BUFFER_LOG
-FILE *inputBufferFile1;
 char inputfilename [] = "/data/input.yuv";
 #endif
 #ifdef OUTPUT_BUFFER_LOG
-FILE *outputBufferFile1;
 char outputfilename [] = "/data/output-bitstream.\0\0\0\0";
 #endif
 //constructor
@@ -147,6 +148,11 @@ venc_dev::venc_dev()
   m_max_allowed_bitrate_check = false;
   m_eLevel = 0;
   m_eProfile = 0;
+  m_mem_stats = NULL;
+  m_output_dump = NULL;
+#ifdef MAX_RES_1080P
+  memset(recon_buff, 0, sizeof(recon_buff));
+#endif
 }
 
 venc_dev::~venc_dev()
@@ -163,6 +169,7 @@ void* async_venc_message_thread (void *input)
   omx_venc *omx = reinterpret_cast<omx_venc*>(input);
 
   prctl(PR_SET_NAME, (unsigned long)"VideoEncCallBackThread", 0, 0, 0);
+  omx->m_thread_stats.thread_start(QOMX_VIDEO_THREAD_CALLBACK);
   timeout.millisec = VEN_TIMEOUT_INFINITE;
   while(1)
   {
@@ -171,6 +178,7 @@ void* async_venc_message_thread (void *input)
 
     /*Wait for a message from the video decoder driver*/
     error_code = ioctl(omx->handle->m_nDriver_fd,VEN_IOCTL_CMD_READ_NEXT_MSG,(void *)&ioctl_msg);
+    omx->m_thread_stats.wakeup(QOMX_VIDEO_THREAD_CALLBACK);
     if (error_code == -512)  // ERESTARTSYS
     {
         DEBUG_PRINT_ERROR("\n ERESTARTSYS received in ioctl read next msg!");
@@ -186,6 +194,7 @@ void* async_venc_message_thread (void *input)
         break;
     }
   }
+  omx->m_thread_stats.thread_exit(QOMX_VIDEO_THREAD_CALLBACK);
   DEBUG_PRINT_HIGH("omx_venc: Async Thread exit\n");
   return NULL;
 }
@@ -272,12 +281,7 @@ bool venc_dev::venc_open(OMX_U32 codec)
     DEBUG_PRINT_ERROR("\nERROR: Request for setting base configuration failed");
     return false;
   }
-#ifdef INPUT_BUFFER_LOG
-  inputBufferFile1 = fopen (inputfilename, "ab");
-#endif
-#ifdef OUTPUT_BUFFER_LOG
-  outputBufferFile1 = fopen (outputfilename, "ab");
-#endif
+  venc_init_dumps();
   // Get the I/P and O/P buffer requirements
   ioctl_msg.in = NULL;
   ioctl_msg.out = (void*)&m_sInput_buff_property;
@@ -310,6 +314,10 @@ void venc_dev::venc_close()
   DEBUG_PRINT_LOW("\nvenc_close: fd = %d", m_nDriver_fd);
   if((int)m_nDriver_fd >= 0)
   {
+#ifdef MAX_RES_1080P
+    // Hand back recon buffers of a session closed without venc_stop
+    pmem_free();
+#endif
     DEBUG_PRINT_HIGH("\n venc_close(): Calling VEN_IOCTL_CMD_STOP_READ_MSG");
     (void)ioctl(m_nDriver_fd, VEN_IOCTL_CMD_STOP_READ_MSG,
         NULL);
@@ -317,11 +325,51 @@ void venc_dev::venc_close()
     close(m_nDriver_fd);
     m_nDriver_fd = -1;
   }
+  // Flushes whatever the writers still hold
+  m_input_dump.close();
+  if (m_output_dump)
+    m_output_dump->close();
+}
+
+/*
+ * Opens the dumps asked for at build time or through properties:
+ *   vidc.venc.debug.dump.input     YUV file
+ *   vidc.venc.debug.dump.output    bitstream file
+ *   vidc.venc.debug.dump.interval  keep every Nth buffer (1)
+ *   vidc.venc.debug.dump.errors    keep only buffers flagged corrupt
+ *   vidc.venc.debug.dump.ring      ring size per file in MB (8)
+ */
+void venc_dev::venc_init_dumps()
+{
+  OMX_U32 interval = 1, ring = 0;
+  bool errors_only = false;
+#ifdef _ANDROID_
+  char property_value[PROPERTY_VALUE_MAX] = {0};
+
+  property_get("vidc.venc.debug.dump.interval", property_value, "1");
+  interval = atoi(property_value);
+  property_get("vidc.venc.debug.dump.errors", property_value, "0");
+  errors_only = atoi(property_value) != 0;
+  property_get("vidc.venc.debug.dump.ring", property_value, "0");
+  ring = atoi(property_value) << 20;
+#endif
+  m_input_dump.set_sampling(interval, errors_only);
 #ifdef INPUT_BUFFER_LOG
-  fclose (inputBufferFile1);
+  m_input_dump.open(inputfilename, ring);
 #endif
+#ifdef _ANDROID_
+  if (property_get("vidc.venc.debug.dump.input", property_value, NULL) > 0)
+    m_input_dump.open(property_value, ring);
+#endif
+  if (!m_output_dump)
+    return;
+  m_output_dump->set_sampling(interval, errors_only);
 #ifdef OUTPUT_BUFFER_LOG
-  fclose (outputBufferFile1);
+  m_output_dump->open(outputfilename, ring);
+#endif
+#ifdef _ANDROID_
+  if (property_get("vidc.venc.debug.dump.output", property_value, NULL) > 0)
+    m_output_dump->open(property_value, ring);
 #endif
 }
 
@@ -1094,63 +1142,291 @@ OMX_U32 venc_dev::venc_allocate_recon_buffers()
 }
 OMX_U32 venc_dev::pmem_allocate(OMX_U32 size, OMX_U32 alignment, OMX_U32 count)
 {
-  OMX_U32 pmem_fd = -1;
-  OMX_U32 width, height;
-  void *buf_addr = NULL;
   struct venc_ioctl_msg ioctl_msg;
-  struct pmem_allocation allocation;
   struct venc_recon_addr recon_addr;
-  int rc = 0;
+  venc_recon_pool *pool = venc_recon_pool::get_instance();
+  OMX_U32 align = clip2(alignment);
+
+  if (align != 8192)
+    align = 8192;
+
+  if (!pool->acquire(size, align, &recon_buff[count]) &&
+      venc_recon_pool::allocate_buffer(size, align, &recon_buff[count]))
+  {
+    // Idle buffers of other sizes may be what exhausted the heap
+    DEBUG_PRINT_HIGH("\n recon allocation failed, emptying the pool and retrying\n");
+    pool->trim(0);
+    if (venc_recon_pool::allocate_buffer(size, align, &recon_buff[count]))
+    {
+      DEBUG_PRINT_ERROR("Error returned in allocating recon buffers\n");
+      return -1;
+    }
+  }
+
+  recon_addr.buffer_size = size;
+  recon_addr.pmem_fd = recon_buff[count].pmem_fd;
+  recon_addr.offset = 0;
+  recon_addr.pbuffer = recon_buff[count].virtual_address;
+
+  ioctl_msg.in = (void*)&recon_addr;
+  ioctl_msg.out = NULL;
+
+  if (ioctl (m_nDriver_fd,VEN_IOCTL_SET_RECON_BUFFER, (void*)&ioctl_msg) < 0)
+  {
+    DEBUG_PRINT_ERROR("Failed to set the Recon_buffers\n");
+    pool->release(&recon_buff[count]);
+    memset(&recon_buff[count], 0, sizeof(recon_buff[count]));
+    return -1;
+  }
+
+  if (m_mem_stats)
+  {
+    m_mem_stats->allocated(QOMX_VIDEO_MEM_RECON, size);
+    m_mem_stats->mapped(QOMX_VIDEO_MEM_RECON, size);
+  }
+
+  DEBUG_PRINT_HIGH("\n Allocated virt:%p, FD: %d of size %d at index: %d\n", recon_buff[count].virtual_address,
+                     recon_buff[count].pmem_fd, recon_buff[count].size, count);
+  return 0;
+}
+
+OMX_U32 venc_dev::pmem_free()
+{
+  int cnt = 0;
+  struct venc_ioctl_msg ioctl_msg;
+  struct venc_recon_addr recon_addr;
+  for (cnt = 0; cnt < MAX_RECON_BUFFERS; cnt++)
+  {
+    if(recon_buff[cnt].virtual_address)
+    {
+      recon_addr.pbuffer = recon_buff[cnt].virtual_address;
+      recon_addr.offset = recon_buff[cnt].offset;
+      recon_addr.pmem_fd = recon_buff[cnt].pmem_fd;
+      recon_addr.buffer_size = recon_buff[cnt].size;
+      ioctl_msg.in = (void*)&recon_addr;
+      ioctl_msg.out = NULL;
+      // The session gives the buffer up here; while the pool holds it,
+      // it shows in nPoolRetainedBytes of the memory stats instead
+      if (m_mem_stats)
+      {
+        m_mem_stats->unmapped(QOMX_VIDEO_MEM_RECON, recon_buff[cnt].size);
+        m_mem_stats->released(QOMX_VIDEO_MEM_RECON, recon_buff[cnt].size);
+      }
+      if(ioctl(m_nDriver_fd, VEN_IOCTL_FREE_RECON_BUFFER ,&ioctl_msg) < 0)
+      {
+        // The driver may still own it, so it must not reach another session
+        DEBUG_PRINT_ERROR("VEN_IOCTL_FREE_RECON_BUFFER failed, freeing Index %d",cnt);
+        venc_recon_pool::free_buffer(&recon_buff[cnt]);
+      }
+      else
+      {
+        DEBUG_PRINT_LOW("\n returning Index %d of size %d to the pool\n",cnt,recon_buff[cnt].size);
+        venc_recon_pool::get_instance()->release(&recon_buff[cnt]);
+      }
+      memset(&recon_buff[cnt], 0, sizeof(recon_buff[cnt]));
+    }
+  }
+  return 0;
+}
+
+venc_recon_pool* venc_recon_pool::get_instance()
+{
+  // Destroyed when the library is unloaded, which frees the idle buffers
+  static venc_recon_pool pool;
+  return &pool;
+}
+
+venc_recon_pool::venc_recon_pool()
+{
+  pthread_mutex_init(&m_lock, NULL);
+  memset(m_idle, 0, sizeof(m_idle));
+  m_idle_count = 0;
+  m_idle_bytes = 0;
+  m_stamp = 0;
+  m_hits = 0;
+  m_misses = 0;
+}
+
+venc_recon_pool::~venc_recon_pool()
+{
+  trim(0);
+  pthread_mutex_destroy(&m_lock);
+}
+
+/* ======================================================================
+FUNCTION
+  venc_recon_pool::acquire
+
+DESCRIPTION
+  Lends an idle buffer of exactly this size and alignment. The caller
+  allocates a new buffer when nothing matches.
+
+PARAMETERS
+  size      - buffer size reported by VEN_IOCTL_GET_RECON_BUFFER_SIZE.
+  alignment - effective allocation alignment.
+  buf       - filled with the pooled buffer on success.
 
+RETURN VALUE
+  true if a pooled buffer was handed out.
+
+========================================================================== */
+bool venc_recon_pool::acquire(OMX_U32 size, OMX_U32 alignment,
+                              venc_dev::recon_buffer *buf)
+{
+  OMX_U32 i, best = VENC_RECON_POOL_MAX_BUFFERS;
+
+  pthread_mutex_lock(&m_lock);
+  for (i = 0; i < m_idle_count; i++)
+  {
+    if ((OMX_U32)m_idle[i].buf.size == size &&
+        (OMX_U32)m_idle[i].buf.alignment == alignment &&
+        (best == VENC_RECON_POOL_MAX_BUFFERS ||
+         m_idle[i].stamp > m_idle[best].stamp))
+      best = i;
+  }
+  if (best == VENC_RECON_POOL_MAX_BUFFERS)
+  {
+    m_misses++;
+    pthread_mutex_unlock(&m_lock);
+    return false;
+  }
+  *buf = m_idle[best].buf;
+  m_idle_bytes -= size;
+  m_idle[best] = m_idle[--m_idle_count];
+  m_hits++;
+  pthread_mutex_unlock(&m_lock);
+  DEBUG_PRINT_LOW("\n recon pool hit: virt:%p size %u\n", buf->virtual_address, size);
+  return true;
+}
+
+/* ======================================================================
+FUNCTION
+  venc_recon_pool::release
+
+DESCRIPTION
+  Takes a buffer back from a session. The buffer must already be
+  unregistered from the driver. Older idle buffers are evicted to keep
+  the pool within its limits; a buffer larger than the byte limit is
+  freed right away.
+
+PARAMETERS
+  buf - buffer to return.
+
+RETURN VALUE
+  None.
+
+========================================================================== */
+void venc_recon_pool::release(venc_dev::recon_buffer *buf)
+{
+  OMX_U32 size = buf->size;
+
+  if (size > VENC_RECON_POOL_MAX_BYTES)
+  {
+    free_buffer(buf);
+    return;
+  }
+  pthread_mutex_lock(&m_lock);
+  trim_locked(VENC_RECON_POOL_MAX_BYTES - size, VENC_RECON_POOL_MAX_BUFFERS - 1);
+  m_idle[m_idle_count].buf = *buf;
+  m_idle[m_idle_count].stamp = ++m_stamp;
+  m_idle_count++;
+  m_idle_bytes += size;
+  pthread_mutex_unlock(&m_lock);
+}
+
+void venc_recon_pool::trim(OMX_U32 max_bytes)
+{
+  pthread_mutex_lock(&m_lock);
+  trim_locked(max_bytes, VENC_RECON_POOL_MAX_BUFFERS);
+  pthread_mutex_unlock(&m_lock);
+}
+
+void venc_recon_pool::trim_locked(OMX_U32 max_bytes, OMX_U32 max_count)
+{
+  OMX_U32 i, oldest;
+
+  while (m_idle_count && (m_idle_bytes > max_bytes || m_idle_count > max_count))
+  {
+    oldest = 0;
+    for (i = 1; i < m_idle_count; i++)
+    {
+      if (m_idle[i].stamp < m_idle[oldest].stamp)
+        oldest = i;
+    }
+    m_idle_bytes -= m_idle[oldest].buf.size;
+    free_buffer(&m_idle[oldest].buf);
+    m_idle[oldest] = m_idle[--m_idle_count];
+  }
+}
+
+void venc_recon_pool::get_stats(struct venc_recon_pool_stats *stats)
+{
+  pthread_mutex_lock(&m_lock);
+  stats->hits = m_hits;
+  stats->misses = m_misses;
+  stats->retained_count = m_idle_count;
+  stats->retained_bytes = m_idle_bytes;
+  pthread_mutex_unlock(&m_lock);
+}
+
+int venc_recon_pool::allocate_buffer(OMX_U32 size, OMX_U32 alignment,
+                                     venc_dev::recon_buffer *buf)
+{
+  int pmem_fd = -1;
+  void *buf_addr = NULL;
+  int rc = 0;
 #ifdef USE_ION
-  recon_buff[count].ion_device_fd = open (MEM_DEVICE,O_RDONLY|O_DSYNC);
-  if(recon_buff[count].ion_device_fd < 0)
+  buf->ion_device_fd = open (MEM_DEVICE,O_RDONLY|O_DSYNC);
+  if(buf->ion_device_fd < 0)
   {
       DEBUG_PRINT_ERROR("\nERROR: ION Device open() Failed");
       return -1;
   }
 
-  recon_buff[count].alloc_data.len = size;
-  recon_buff[count].alloc_data.flags = 0x1 << MEM_HEAP_ID;
-  recon_buff[count].alloc_data.align = clip2(alignment);
-  if (recon_buff[count].alloc_data.align != 8192)
-    recon_buff[count].alloc_data.align = 8192;
+  buf->alloc_data.len = size;
+  buf->alloc_data.flags = 0x1 << MEM_HEAP_ID;
+  buf->alloc_data.align = alignment;
 
-  rc = ioctl(recon_buff[count].ion_device_fd,ION_IOC_ALLOC,&recon_buff[count].alloc_data);
-  if(rc || !recon_buff[count].alloc_data.handle) {
+  rc = ioctl(buf->ion_device_fd,ION_IOC_ALLOC,&buf->alloc_data);
+  if(rc || !buf->alloc_data.handle) {
          DEBUG_PRINT_ERROR("\n ION ALLOC memory failed ");
-         recon_buff[count].alloc_data.handle=NULL;
+         buf->alloc_data.handle=NULL;
+         close(buf->ion_device_fd);
+         buf->ion_device_fd =-1;
          return -1;
   }
 
-  recon_buff[count].ion_alloc_fd.handle = recon_buff[count].alloc_data.handle;
-  rc = ioctl(recon_buff[count].ion_device_fd,ION_IOC_MAP,&recon_buff[count].ion_alloc_fd);
+  buf->ion_alloc_fd.handle = buf->alloc_data.handle;
+  rc = ioctl(buf->ion_device_fd,ION_IOC_MAP,&buf->ion_alloc_fd);
   if(rc) {
         DEBUG_PRINT_ERROR("\n ION MAP failed ");
-        recon_buff[count].ion_alloc_fd.fd =-1;
-        recon_buff[count].ion_alloc_fd.fd =-1;
+        buf->ion_alloc_fd.fd =-1;
+        ioctl(buf->ion_device_fd,ION_IOC_FREE,&buf->alloc_data.handle);
+        buf->alloc_data.handle = NULL;
+        close(buf->ion_device_fd);
+        buf->ion_device_fd =-1;
         return -1;
   }
-  pmem_fd = recon_buff[count].ion_alloc_fd.fd;
+  pmem_fd = buf->ion_alloc_fd.fd;
 #else
+  struct pmem_allocation allocation;
+
   pmem_fd = open(MEM_DEVICE, O_RDWR);
 
-  if ((int)(pmem_fd) < 0)
+  if (pmem_fd < 0)
   {
 	DEBUG_PRINT_ERROR("\n Failed to get an pmem handle");
 	return -1;
   }
 
   allocation.size = size;
-  allocation.align = clip2(alignment);
-
-  if (allocation.align != 8192)
-    allocation.align = 8192;
+  allocation.align = alignment;
 
   if (ioctl(pmem_fd, PMEM_ALLOCATE_ALIGNED, &allocation) < 0)
   {
     DEBUG_PRINT_ERROR("\n Aligment(%u) failed with pmem driver Sz(%lu)",
       allocation.align, allocation.size);
+    close(pmem_fd);
     return -1;
   }
 #endif
@@ -1164,82 +1440,46 @@ OMX_U32 venc_dev::pmem_allocate(OMX_U32 size, OMX_U32 alignment, OMX_U32 count)
     pmem_fd = -1;
     DEBUG_PRINT_ERROR("Error returned in allocating recon buffers buf_addr: %p\n",buf_addr);
 #ifdef USE_ION
-    if(ioctl(recon_buff[count].ion_device_fd,ION_IOC_FREE,
-       &recon_buff[count].alloc_data.handle)) {
+    if(ioctl(buf->ion_device_fd,ION_IOC_FREE,
+       &buf->alloc_data.handle)) {
       DEBUG_PRINT_ERROR("ion recon buffer free failed");
     }
-    recon_buff[count].alloc_data.handle = NULL;
-    recon_buff[count].ion_alloc_fd.fd =-1;
-    close(recon_buff[count].ion_device_fd);
-    recon_buff[count].ion_device_fd =-1;
+    buf->alloc_data.handle = NULL;
+    buf->ion_alloc_fd.fd =-1;
+    close(buf->ion_device_fd);
+    buf->ion_device_fd =-1;
 #endif
     return -1;
   }
 
   DEBUG_PRINT_HIGH("\n Allocated virt:%p, FD: %d of size %d \n", buf_addr, pmem_fd, size);
 
-  recon_addr.buffer_size = size;
-  recon_addr.pmem_fd = pmem_fd;
-  recon_addr.offset = 0;
-  recon_addr.pbuffer = (unsigned char *)buf_addr;
-
-  ioctl_msg.in = (void*)&recon_addr;
-  ioctl_msg.out = NULL;
-
-  if (ioctl (m_nDriver_fd,VEN_IOCTL_SET_RECON_BUFFER, (void*)&ioctl_msg) < 0)
-  {
-    DEBUG_PRINT_ERROR("Failed to set the Recon_buffers\n");
-    return -1;
-  }
-
-  recon_buff[count].virtual_address = (unsigned char *) buf_addr;
-  recon_buff[count].size = size;
-  recon_buff[count].offset = 0;
-  recon_buff[count].pmem_fd = pmem_fd;
-
-  DEBUG_PRINT_ERROR("\n Allocated virt:%p, FD: %d of size %d at index: %d\n", recon_buff[count].virtual_address,
-                     recon_buff[count].pmem_fd, recon_buff[count].size, count);
+  buf->virtual_address = (unsigned char *) buf_addr;
+  buf->size = size;
+  buf->alignment = alignment;
+  buf->offset = 0;
+  buf->pmem_fd = pmem_fd;
   return 0;
 }
 
-OMX_U32 venc_dev::pmem_free()
+void venc_recon_pool::free_buffer(venc_dev::recon_buffer *buf)
 {
-  int cnt = 0;
-  struct venc_ioctl_msg ioctl_msg;
-  struct venc_recon_addr recon_addr;
-  for (cnt = 0; cnt < recon_buffers_count; cnt++)
-  {
-    if(recon_buff[cnt].pmem_fd)
-    {
-      recon_addr.pbuffer = recon_buff[cnt].virtual_address;
-      recon_addr.offset = recon_buff[cnt].offset;
-      recon_addr.pmem_fd = recon_buff[cnt].pmem_fd;
-      recon_addr.buffer_size = recon_buff[cnt].size;
-      ioctl_msg.in = (void*)&recon_addr;
-      ioctl_msg.out = NULL;
-      if(ioctl(m_nDriver_fd, VEN_IOCTL_FREE_RECON_BUFFER ,&ioctl_msg) < 0)
-        DEBUG_PRINT_ERROR("VEN_IOCTL_FREE_RECON_BUFFER failed");
-      munmap(recon_buff[cnt].virtual_address, recon_buff[cnt].size);
-      close(recon_buff[cnt].pmem_fd);
+  munmap(buf->virtual_address, buf->size);
+  close(buf->pmem_fd);
 #ifdef USE_ION
-      if(ioctl(recon_buff[cnt].ion_device_fd,ION_IOC_FREE,
-         &recon_buff[cnt].alloc_data.handle)) {
-        DEBUG_PRINT_ERROR("ion recon buffer free failed");
-      }
-      recon_buff[cnt].alloc_data.handle = NULL;
-      recon_buff[cnt].ion_alloc_fd.fd =-1;
-      close(recon_buff[cnt].ion_device_fd);
-      recon_buff[cnt].ion_device_fd =-1;
+  if(ioctl(buf->ion_device_fd,ION_IOC_FREE,
+     &buf->alloc_data.handle)) {
+    DEBUG_PRINT_ERROR("ion recon buffer free failed");
+  }
+  buf->alloc_data.handle = NULL;
+  buf->ion_alloc_fd.fd =-1;
+  close(buf->ion_device_fd);
+  buf->ion_device_fd =-1;
 #endif
-      DEBUG_PRINT_LOW("\n cleaning Index %d of size %d \n",cnt,recon_buff[cnt].size);
-      recon_buff[cnt].pmem_fd = -1;
-      recon_buff[cnt].virtual_address = NULL;
-      recon_buff[cnt].offset = 0;
-      recon_buff[cnt].alignment = 0;
-      recon_buff[cnt].size = 0;
-    }
-  }
-  return 0;
+  DEBUG_PRINT_LOW("\n freed recon buffer of size %d \n",buf->size);
+  buf->pmem_fd = -1;
+  buf->virtual_address = NULL;
+  buf->size = 0;
 }
 #endif
 
@@ -1473,28 +1713,22 @@ bool venc_dev::venc_empty_buf(void *buffer, void *pmem_data_buf)
     /*Generate an async error and move to invalid state*/
     return false;
   }
-#ifdef INPUT_BUFFER_LOG
 #ifdef MAX_RES_1080P
-
-  int y_size = 0;
-  int c_offset = 0;
-
-  y_size = m_sVenc_cfg.input_width * m_sVenc_cfg.input_height;
-  //chroma offset is y_size aligned to the 2k boundary
-  c_offset= (y_size + 2047) & (~(2047));
-
-  if(inputBufferFile1)
+  if (frameinfo.len && m_input_dump.sample(false))
   {
-    fwrite((const char *)frameinfo.ptrbuffer, y_size, 1,inputBufferFile1);
-    fwrite((const char *)(frameinfo.ptrbuffer + c_offset), (y_size>>1), 1,inputBufferFile1);
+    // Luma then chroma, which starts at the next 2k boundary
+    OMX_U32 y_size = m_sVenc_cfg.input_width * m_sVenc_cfg.input_height;
+    OMX_U32 c_offset = (y_size + 2047) & (~(2047));
+
+    if (m_input_dump.begin(y_size + (y_size >> 1)))
+    {
+      m_input_dump.append(frameinfo.ptrbuffer, y_size);
+      m_input_dump.append(frameinfo.ptrbuffer + c_offset, y_size >> 1);
+      m_input_dump.commit();
+    }
   }
 #else
-  if(inputBufferFile1)
-  {
-    fwrite((const char *)frameinfo.ptrbuffer, frameinfo.len, 1,inputBufferFile1);
-  }
-#endif
-
+  m_input_dump.write(frameinfo.ptrbuffer, frameinfo.len, false);
 #endif
 
   return true;
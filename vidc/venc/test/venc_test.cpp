@@ -67,6 +67,7 @@ REFERENCES
 #include "fb_test.h"
 #include "venc_util.h"
 #include "extra_data_handler.h"
+#include "vidc_stats.h"
 #ifdef USE_ION
 #include <linux/ion.h>
 #endif
@@ -315,6 +316,7 @@ OMX_BOOL m_bInFrameFree[NUM_IN_BUFFERS];
 ProfileType m_sProfile;
 
 static int m_nFramePlay = 0;
+static int m_bPerfCounters = 0;
 static int m_eMode = MODE_PREVIEW;
 static int m_nInFd = -1;
 static int m_nOutFd = -1;
@@ -476,6 +478,60 @@ void PrintFramePackArrangement(OMX_QCOM_FRAME_PACK_ARRANGEMENT framePackingArran
    printf("extension_flag (%d)\n",
           framePackingArrangement.extension_flag);
 }
+////////////////////////////////////////////////////////////////////////////////
+void ConfigurePerf(OMX_BOOL bPrint)
+{
+   static const char* stages[QOMX_VIDEO_PERF_STAGE_MAX] =
+      { "parser", "event", "etb", "fbd" };
+   OMX_INDEXTYPE index;
+   QOMX_VIDEO_PERF_STATS perf;
+   int i;
+
+   if (OMX_GetExtensionIndex(m_hHandle,
+         (OMX_STRING) OMX_QCOM_INDEX_CONFIG_VIDEO_PERF_STATS, &index) != OMX_ErrorNone)
+   {
+      E("perf counters: extension not supported");
+      m_bPerfCounters = 0;
+      return;
+   }
+   memset(&perf, 0, sizeof(perf));
+   perf.nSize = sizeof(perf);
+   perf.nPortIndex = OMX_ALL;
+   if (!bPrint)
+   {
+      perf.bEnable = OMX_TRUE;
+      if (OMX_SetConfig(m_hHandle, index, &perf) != OMX_ErrorNone)
+      {
+         printf("perf counters: unavailable on this device\n");
+         m_bPerfCounters = 0;
+      }
+      return;
+   }
+   if (OMX_GetConfig(m_hHandle, index, &perf) != OMX_ErrorNone)
+      return;
+   printf("perf counters (%s, %lu threads, %llu frames):\n",
+          perf.bUserOnly ? "user only" : "user+kernel",
+          (unsigned long) perf.nThreads, (unsigned long long) perf.nFrames);
+   if (perf.nRunningPermille < 1000)
+      printf("  multiplexed: on the PMU %lu.%lu%% of the time, counts scaled\n",
+             (unsigned long) perf.nRunningPermille / 10,
+             (unsigned long) perf.nRunningPermille % 10);
+   printf("  %-8s %10s %14s %14s %12s %12s %12s\n", "stage", "calls",
+          "cycles", "instructions", "cache-miss", "branch-miss", "cyc/frame");
+   for (i = 0; i < QOMX_VIDEO_PERF_STAGE_MAX; i++)
+   {
+      QOMX_VIDEO_PERF_COUNTS* c = &perf.sSession[i];
+      printf("  %-8s %10llu %14llu %14llu %12llu %12llu %12llu\n", stages[i],
+             (unsigned long long) c->nCalls,
+             (unsigned long long) c->nCount[QOMX_VIDEO_PERF_CYCLES],
+             (unsigned long long) c->nCount[QOMX_VIDEO_PERF_INSTRUCTIONS],
+             (unsigned long long) c->nCount[QOMX_VIDEO_PERF_CACHE_MISSES],
+             (unsigned long long) c->nCount[QOMX_VIDEO_PERF_BRANCH_MISSES],
+             perf.nFrames ? (unsigned long long)
+                (c->nCount[QOMX_VIDEO_PERF_CYCLES] / perf.nFrames) : 0ULL);
+   }
+}
+
 void SetState(OMX_STATETYPE eState)
 {
 #define GOTO_STATE(eState)                      \
@@ -1185,6 +1241,9 @@ OMX_ERRORTYPE VencTest_Initialize()
    result = ConfigureEncoder();
    CHK(result);
 
+   if (m_bPerfCounters)
+      ConfigurePerf(OMX_FALSE);
+
    return result;
 }
 
@@ -1254,6 +1313,9 @@ OMX_ERRORTYPE VencTest_Exit(void)
    OMX_ERRORTYPE result = OMX_ErrorNone;
    D("trying to exit venc");
 
+   if (m_bPerfCounters)
+      ConfigurePerf(OMX_TRUE);
+
    D("going to idle state");
    SetState(OMX_StateIdle);
 
@@ -1572,6 +1634,7 @@ void usage(char* filename)
    fprintf(stderr, "       FPS - frames per second\n");
    fprintf(stderr, "       NFRAMES - number of frames to play, 0 for infinite\n");
    fprintf(stderr, "       RateControl (Values 0 - 4 for RC_OFF, RC_CBR_CFR, RC_CBR_VFR, RC_VBR_CFR, RC_VBR_VFR\n");
+   fprintf(stderr, "       --perf anywhere prints hardware counters per stage on exit\n");
    exit(1);
 }
 
@@ -1908,6 +1971,16 @@ int main(int argc, char** argv)
    m_nFrameOut = 0;
 
    memset(&m_sMsgQ, 0, sizeof(MsgQ));
+   for (int a = 1; a < argc; a++)
+   {
+      if (strcmp("--perf", argv[a]) == 0)
+      {
+         m_bPerfCounters = 1;
+         memmove(&argv[a], &argv[a + 1], (argc - a) * sizeof(argv[0]));
+         argc--;
+         break;
+      }
+   }
    parseArgs(argc, argv);
 
    D("fps=%d, bitrate=%d, width=%d, height=%d",